@@ -0,0 +1,153 @@
+#ifndef BURST_DETECT_H
+#define BURST_DETECT_H
+
+// Per-UE burst detection on UL throughput, one O(1) step per sample.
+//
+// A single sample over a threshold used to flip a UE into burst mode, so
+// one noisy indication cost two RC control rounds. Each UE now runs:
+//
+//  - an EWMA of the throughput, with hysteresis: it enters burst mode above
+//    enter_kbps and leaves below exit_kbps;
+//  - a one-sided CUSUM of the samples over cusum_ref_kbps, which enters
+//    burst mode once the excess adds up to cusum_h. A real burst trips it
+//    a sample or two before the EWMA catches up, a lone spike does not;
+//  - a dwell time: a UE stays at least min_dwell samples in a mode.
+//
+// State is kept as one array per field, indexed like the ue_table slab the
+// UEs live in, so burst_detect_step() updates all UEs in one branch-free
+// pass the compiler vectorizes. Keep the indices in step with the table:
+// burst_detect_reset() for a newly created record, burst_detect_remove()
+// when the table drops one.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    float alpha;  // EWMA weight of a new sample, (0, 1]
+    float enter_kbps;
+    float exit_kbps;
+    float cusum_ref_kbps;
+    float cusum_h;  // kbps summed over samples
+    uint32_t min_dwell;
+} burst_detect_cfg_t;
+
+typedef struct {
+    burst_detect_cfg_t cfg;
+    size_t cap;
+
+    // Per UE
+    float* x;  // Input, this indication's sample
+    uint32_t* valid;  // Input, 0: no sample, state is left alone
+    float* ewma;
+    float* cusum;
+    uint32_t* dwell;  // Samples since the last mode change, up to min_dwell
+    uint32_t* burst;  // Output, current mode
+} burst_detect_t;
+
+static inline void burst_detect_grow(burst_detect_t* d, size_t cap) {
+    d->x = realloc(d->x, cap * sizeof(float));
+    d->ewma = realloc(d->ewma, cap * sizeof(float));
+    d->cusum = realloc(d->cusum, cap * sizeof(float));
+    d->dwell = realloc(d->dwell, cap * sizeof(uint32_t));
+    d->valid = realloc(d->valid, cap * sizeof(uint32_t));
+    d->burst = realloc(d->burst, cap * sizeof(uint32_t));
+    assert(d->x != NULL && d->ewma != NULL && d->cusum != NULL && d->dwell != NULL && d->valid != NULL && d->burst != NULL
+           && "Memory exhausted");
+    d->cap = cap;
+}
+
+static inline void burst_detect_init(burst_detect_t* d, burst_detect_cfg_t const* cfg, size_t expected_ues) {
+    assert(cfg->alpha > 0 && cfg->alpha <= 1);
+    assert(cfg->exit_kbps <= cfg->enter_kbps && "Hysteresis band inverted");
+    memset(d, 0, sizeof(*d));
+    d->cfg = *cfg;
+    burst_detect_grow(d, expected_ues > 0 ? expected_ues : 1);
+}
+
+static inline void burst_detect_free(burst_detect_t* d) {
+    free(d->x);
+    free(d->ewma);
+    free(d->cusum);
+    free(d->dwell);
+    free(d->valid);
+    free(d->burst);
+    memset(d, 0, sizeof(*d));
+}
+
+// UE i starts out in normal mode, free to enter burst mode right away
+static inline void burst_detect_reset(burst_detect_t* d, size_t i) {
+    if (i >= d->cap) {
+        size_t cap = d->cap;
+        while (cap <= i)
+            cap *= 2;
+        burst_detect_grow(d, cap);
+    }
+    d->x[i] = 0;
+    d->valid[i] = 0;
+    d->ewma[i] = 0;
+    d->cusum[i] = 0;
+    d->dwell[i] = d->cfg.min_dwell;
+    d->burst[i] = 0;
+}
+
+// Mirrors a swap-remove: UE `last` moves into slot i
+static inline void burst_detect_remove(burst_detect_t* d, size_t i, size_t last) {
+    assert(i <= last && last < d->cap);
+    d->x[i] = d->x[last];
+    d->valid[i] = d->valid[last];
+    d->ewma[i] = d->ewma[last];
+    d->cusum[i] = d->cusum[last];
+    d->dwell[i] = d->dwell[last];
+    d->burst[i] = d->burst[last];
+}
+
+// Feeds x[i] of every UE i < n with valid[i] set. Returns the number of
+// UEs that changed mode.
+static inline size_t burst_detect_step(burst_detect_t* d, size_t n) {
+    assert(n <= d->cap);
+    burst_detect_cfg_t const c = d->cfg;
+    float const* restrict x = d->x;
+    uint32_t const* restrict valid = d->valid;
+    float* restrict ewma = d->ewma;
+    float* restrict cusum = d->cusum;
+    uint32_t* restrict dwell = d->dwell;
+    uint32_t* restrict burst = d->burst;
+
+    uint32_t changed = 0;
+    for (size_t i = 0; i < n; i++) {
+        // Flags are 32 bits wide like the floats, and UEs without a sample
+        // are left alone by arithmetic rather than by skipping the store,
+        // so the loop vectorizes without -ffast-math
+        uint32_t const v = valid[i];
+        uint32_t const keep = 0u - (v ^ 1);
+        float const fv = (float)(int32_t)v;
+        uint32_t const b = burst[i];
+        float const e = ewma[i];
+        float const cs = cusum[i];
+        uint32_t const dw0 = dwell[i];
+
+        float const m = e + fv * c.alpha * (x[i] - e);
+        float s = cs + (x[i] - c.cusum_ref_kbps);
+        s = s > 0 ? s : 0;
+        uint32_t const dw = dw0 + (dw0 < c.min_dwell);
+        uint32_t const can = dw >= c.min_dwell;
+        uint32_t const enter = (b ^ 1) & can & ((m > c.enter_kbps) | (s > c.cusum_h));
+        uint32_t const leave = b & can & (m < c.exit_kbps);
+        uint32_t const flip = (enter | leave) & v;
+
+        // The sum only looks for the next burst, it restarts on every change
+        float const s_next = (float)(int32_t)((b | flip) ^ 1) * s;
+
+        ewma[i] = m;
+        cusum[i] = fv * s_next + (1.0f - fv) * cs;
+        dwell[i] = (((0u - (flip ^ 1)) & dw) & ~keep) | (dw0 & keep);
+        burst[i] = (b ^ flip);
+        changed += flip;
+    }
+    return changed;
+}
+
+#endif
@@ -0,0 +1,318 @@
+#ifndef BURST_FORECAST_H
+#define BURST_FORECAST_H
+
+// Per-UE throughput forecast, to enter burst mode before the burst.
+//
+// traffic_gen_bursty.sh repeats the same cycle (50 s at 8 Mbps, 20 s at
+// 16 Mbps), so each UE runs an additive seasonal Holt-Winters model of its
+// UL throughput: level, trend and one seasonal term per sample of the
+// cycle. A UE is predicted to burst once the forecast `lead` samples ahead
+// crosses enter_kbps, and stops being so below exit_kbps. The first cycle
+// only learns the seasonal terms, nothing is predicted before it is over.
+//
+// Like burst_detect.h the state is one array per field, indexed like the
+// ue_table slab, and all UEs step in one vectorizable pass. The season
+// phase is shared: sample k of the cycle is the k-th indication of the
+// shard modulo the season, so seasonal terms are stored phase-major and a
+// step reads one contiguous row.
+//
+// burst_forecast_score() compares the predictions with what the detector
+// saw, burst_forecast_log() reports forecast error and lead time gained.
+
+#include "xlog.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    float alpha;  // Level smoothing
+    float beta;   // Trend smoothing
+    float gamma;  // Seasonal smoothing
+    uint32_t season;  // Samples per cycle
+    uint32_t lead;    // Samples ahead the prediction looks, < season
+    uint32_t period_ms;  // Between samples
+    float enter_kbps;
+    float exit_kbps;
+} burst_forecast_cfg_t;
+
+typedef struct {
+    burst_forecast_cfg_t cfg;
+    size_t cap;
+    uint32_t phase;  // Position in the cycle of the next sample
+    uint32_t ring_pos;
+
+    // Per UE
+    float* level;
+    float* trend;
+    uint32_t* n_obs;  // Samples seen, up to season + lead
+    float* fcst;      // Output, forecast for `lead` samples ahead
+    uint32_t* pred;   // Output, burst predicted within `lead`
+    float* err_abs;   // Sum of |forecast - sample| at the lead horizon
+    float* obs_abs;   // Sum of |sample| over the same samples
+    uint32_t* err_n;
+    float* seasonal;  // [phase * cap + ue]
+    float* ring;      // [k * cap + ue], the last `lead` forecasts
+
+    // Scoring, see burst_forecast_score()
+    uint64_t clock_ms;       // Advances period_ms per step
+    uint64_t* pred_since;  // clock_ms of a prediction not yet followed by a detection, 0 if none
+    uint8_t* detected;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t false_alarms;
+    uint64_t gain_sum_ms;
+} burst_forecast_t;
+
+// Keeps rows [0, rows) of a row-major [row * cap + ue] array across a
+// change of cap
+static inline float* burst_forecast_regrid(float* old, size_t rows, size_t old_cap, size_t cap) {
+    float* a = calloc(rows * cap, sizeof(float));
+    assert(a != NULL && "Memory exhausted");
+    for (size_t r = 0; r < rows && old != NULL; r++)
+        memcpy(a + r * cap, old + r * old_cap, old_cap * sizeof(float));
+    free(old);
+    return a;
+}
+
+static inline void burst_forecast_grow(burst_forecast_t* f, size_t cap) {
+    float** const fl[] = {&f->level, &f->trend, &f->fcst, &f->err_abs, &f->obs_abs};
+    for (size_t i = 0; i < sizeof(fl) / sizeof(fl[0]); i++) {
+        *fl[i] = realloc(*fl[i], cap * sizeof(float));
+        assert(*fl[i] != NULL && "Memory exhausted");
+    }
+    uint32_t** const u[] = {&f->n_obs, &f->pred, &f->err_n};
+    for (size_t i = 0; i < sizeof(u) / sizeof(u[0]); i++) {
+        *u[i] = realloc(*u[i], cap * sizeof(uint32_t));
+        assert(*u[i] != NULL && "Memory exhausted");
+    }
+    f->pred_since = realloc(f->pred_since, cap * sizeof(uint64_t));
+    f->detected = realloc(f->detected, cap);
+    assert(f->pred_since != NULL && f->detected != NULL && "Memory exhausted");
+    f->seasonal = burst_forecast_regrid(f->seasonal, f->cfg.season, f->cap, cap);
+    f->ring = burst_forecast_regrid(f->ring, f->cfg.lead, f->cap, cap);
+    f->cap = cap;
+}
+
+static inline void burst_forecast_init(burst_forecast_t* f, burst_forecast_cfg_t const* cfg, size_t expected_ues) {
+    assert(cfg->season > 1 && cfg->lead > 0 && cfg->lead < cfg->season && cfg->period_ms > 0);
+    assert(cfg->exit_kbps <= cfg->enter_kbps && "Hysteresis band inverted");
+    memset(f, 0, sizeof(*f));
+    f->cfg = *cfg;
+    burst_forecast_grow(f, expected_ues > 0 ? expected_ues : 1);
+}
+
+static inline void burst_forecast_free(burst_forecast_t* f) {
+    float* const fl[] = {f->level, f->trend, f->fcst, f->err_abs, f->obs_abs, f->seasonal, f->ring};
+    for (size_t i = 0; i < sizeof(fl) / sizeof(fl[0]); i++)
+        free(fl[i]);
+    free(f->n_obs);
+    free(f->pred);
+    free(f->err_n);
+    free(f->pred_since);
+    free(f->detected);
+    memset(f, 0, sizeof(*f));
+}
+
+static inline void burst_forecast_reset(burst_forecast_t* f, size_t i) {
+    if (i >= f->cap) {
+        size_t cap = f->cap;
+        while (cap <= i)
+            cap *= 2;
+        burst_forecast_grow(f, cap);
+    }
+    f->level[i] = 0;
+    f->trend[i] = 0;
+    f->n_obs[i] = 0;
+    f->fcst[i] = 0;
+    f->pred[i] = 0;
+    f->err_abs[i] = 0;
+    f->obs_abs[i] = 0;
+    f->err_n[i] = 0;
+    f->pred_since[i] = 0;
+    f->detected[i] = 0;
+    for (size_t k = 0; k < f->cfg.season; k++)
+        f->seasonal[k * f->cap + i] = 0;
+    for (size_t k = 0; k < f->cfg.lead; k++)
+        f->ring[k * f->cap + i] = 0;
+}
+
+// Mirrors a swap-remove: UE `last` moves into slot i
+static inline void burst_forecast_remove(burst_forecast_t* f, size_t i, size_t last) {
+    assert(i <= last && last < f->cap);
+    f->level[i] = f->level[last];
+    f->trend[i] = f->trend[last];
+    f->n_obs[i] = f->n_obs[last];
+    f->fcst[i] = f->fcst[last];
+    f->pred[i] = f->pred[last];
+    f->err_abs[i] = f->err_abs[last];
+    f->obs_abs[i] = f->obs_abs[last];
+    f->err_n[i] = f->err_n[last];
+    f->pred_since[i] = f->pred_since[last];
+    f->detected[i] = f->detected[last];
+    for (size_t k = 0; k < f->cfg.season; k++)
+        f->seasonal[k * f->cap + i] = f->seasonal[k * f->cap + last];
+    for (size_t k = 0; k < f->cfg.lead; k++)
+        f->ring[k * f->cap + i] = f->ring[k * f->cap + last];
+}
+
+// One step of UEs [0, n). restrict only reliably reaches the vectorizer
+// through parameters, hence the long list.
+static inline void burst_forecast_kernel(burst_forecast_cfg_t c, size_t n, float const* restrict x, uint32_t const* restrict valid,
+                                         float* restrict level, float* restrict trend, uint32_t* restrict n_obs, float* restrict fcst,
+                                         uint32_t* restrict pred, float* restrict err_abs, float* restrict obs_abs, uint32_t* restrict err_n,
+                                         float* restrict s_now, float const* restrict s_lead, float* restrict ring) {
+    uint32_t const warm = c.season;
+    for (size_t i = 0; i < n; i++) {
+        // Same blending as burst_detect_step(): 32-bit flags, no
+        // conditional stores
+        uint32_t const v = valid[i];
+        uint32_t const keep = 0u - (v ^ 1);
+        float const fv = (float)(int32_t)v;
+        uint32_t const n0 = n_obs[i];
+        uint32_t const learning = n0 < warm;
+        float const fl = (float)(int32_t)learning;
+        float const l0 = level[i];
+        float const t0 = trend[i];
+        float const s0 = s_now[i];
+
+        // First cycle: level is the running mean, the seasonal term the raw
+        // sample until burst_forecast_step() centres it at the end
+        float const l_learn = l0 + (x[i] - l0) / (float)(int32_t)(n0 + 1);
+        float const l_hw = c.alpha * (x[i] - s0) + (1.0f - c.alpha) * (l0 + t0);
+        float const t_hw = c.beta * (l_hw - l0) + (1.0f - c.beta) * t0;
+        float const s_hw = c.gamma * (x[i] - l_hw) + (1.0f - c.gamma) * s0;
+        float const l1 = fl * l_learn + (1.0f - fl) * l_hw;
+        float const t1 = (1.0f - fl) * t_hw;
+        float const s1 = fl * x[i] + (1.0f - fl) * s_hw;
+
+        // Error of the forecast made `lead` samples ago for this one
+        uint32_t const scored = n0 >= warm + c.lead;
+        float const e = x[i] - ring[i];
+        float const fs = fv * (float)(int32_t)scored;
+        err_abs[i] += fs * (e < 0 ? -e : e);
+        obs_abs[i] += fs * (x[i] < 0 ? -x[i] : x[i]);
+        err_n[i] += v & scored;
+
+        float const f1 = l1 + (float)c.lead * t1 + (1.0f - fl) * s_lead[i];
+        uint32_t const ready = learning ^ 1;
+        uint32_t const p0 = pred[i];
+        uint32_t const p1 = ready & ((p0 & (f1 > c.exit_kbps)) | (f1 > c.enter_kbps));
+
+        level[i] = fv * l1 + (1.0f - fv) * l0;
+        trend[i] = fv * t1 + (1.0f - fv) * t0;
+        s_now[i] = fv * s1 + (1.0f - fv) * s0;
+        fcst[i] = fv * f1 + (1.0f - fv) * fcst[i];
+        ring[i] = fv * f1 + (1.0f - fv) * ring[i];
+        pred[i] = (p1 & ~keep) | (p0 & keep);
+        n_obs[i] = n0 + (v & (n0 < warm + c.lead));
+    }
+}
+
+// Feeds x[i] of every UE i < n with valid[i] set, then advances the phase
+// for all of them.
+static inline void burst_forecast_step(burst_forecast_t* f, float const* x, uint32_t const* valid, size_t n) {
+    assert(n <= f->cap);
+    burst_forecast_cfg_t const c = f->cfg;
+    uint32_t const warm = c.season;
+    burst_forecast_kernel(c, n, x, valid, f->level, f->trend, f->n_obs, f->fcst, f->pred, f->err_abs, f->obs_abs, f->err_n,
+                          f->seasonal + (size_t)f->phase * f->cap, f->seasonal + (size_t)((f->phase + c.lead) % c.season) * f->cap,
+                          f->ring + (size_t)f->ring_pos * f->cap);
+
+    // UEs that just finished their first cycle: the seasonal terms become
+    // deviations from the mean
+    for (size_t i = 0; i < n; i++) {
+        if (valid[i] && f->n_obs[i] == warm) {
+            for (size_t k = 0; k < c.season; k++)
+                f->seasonal[k * f->cap + i] -= f->level[i];
+        }
+    }
+
+    f->clock_ms += c.period_ms;
+    f->phase = (f->phase + 1) % c.season;
+    f->ring_pos = (f->ring_pos + 1) % c.lead;
+}
+
+// New sample spacing, with season and lead in samples of it, for UEs
+// [0, n). The learned cycle is resampled onto the new grid, so a change of
+// report period costs no relearning. Forecasts in flight are dropped and
+// scoring resumes `lead` samples later.
+static inline void burst_forecast_retime(burst_forecast_t* f, uint32_t period_ms, uint32_t season, uint32_t lead, size_t n) {
+    assert(season > 1 && lead > 0 && lead < season && period_ms > 0);
+    burst_forecast_cfg_t const old = f->cfg;
+    if (old.period_ms == period_ms && old.season == season && old.lead == lead)
+        return;
+    float* seasonal = calloc((size_t)season * f->cap, sizeof(float));
+    assert(seasonal != NULL && "Memory exhausted");
+    // Nearest old sample of the same time in the cycle
+    for (size_t k = 0; k < season; k++) {
+        size_t const k_old = (size_t)(((uint64_t)k * old.season + season / 2) / season) % old.season;
+        memcpy(seasonal + k * f->cap, f->seasonal + k_old * f->cap, n * sizeof(float));
+    }
+    free(f->seasonal);
+    f->seasonal = seasonal;
+    free(f->ring);
+    f->ring = calloc((size_t)lead * f->cap, sizeof(float));
+    assert(f->ring != NULL && "Memory exhausted");
+
+    float const per_sample = (float)old.season / (float)season;
+    for (size_t i = 0; i < n; i++) {
+        f->trend[i] *= per_sample;
+        // Still learning: the same share of the new cycle. Warm: scored
+        // again once the ring has refilled.
+        uint32_t const seen = f->n_obs[i];
+        f->n_obs[i] = seen < old.season ? (uint32_t)((uint64_t)seen * season / old.season) : season;
+    }
+    f->phase = (uint32_t)(((uint64_t)f->phase * season + old.season / 2) / old.season) % season;
+    f->ring_pos = 0;
+    f->cfg.period_ms = period_ms;
+    f->cfg.season = season;
+    f->cfg.lead = lead;
+}
+
+// Call per UE after each step, with whether the detector has it in burst
+// mode. On the step the detector enters burst mode, returns how many ms
+// earlier the burst was predicted, 0 when it was not. -1 on every other
+// step.
+static inline int64_t burst_forecast_score(burst_forecast_t* f, size_t i, bool detected) {
+    int64_t gain = -1;
+    if (detected && !f->detected[i]) {
+        if (f->pred_since[i] != 0) {
+            gain = (int64_t)(f->clock_ms - f->pred_since[i]);
+            f->hits++;
+            f->gain_sum_ms += (uint64_t)gain;
+        } else {
+            gain = 0;
+            f->misses++;
+        }
+        f->pred_since[i] = 0;
+    } else if (!detected) {
+        if (f->pred[i] && f->pred_since[i] == 0) {
+            f->pred_since[i] = f->clock_ms;
+        } else if (!f->pred[i] && f->pred_since[i] != 0) {
+            f->false_alarms++;
+            f->pred_since[i] = 0;
+        }
+    }
+    f->detected[i] = detected;
+    return gain;
+}
+
+// Forecast error at the lead horizon over UEs [0, n), and the score so far
+static inline void burst_forecast_log(burst_forecast_t const* f, size_t shard, size_t n) {
+    double err = 0, obs = 0;
+    uint64_t cnt = 0;
+    for (size_t i = 0; i < n; i++) {
+        err += f->err_abs[i];
+        obs += f->obs_abs[i];
+        cnt += f->err_n[i];
+    }
+    if (cnt == 0)
+        return;
+    XLOG_INFO("[FORECAST %zu]: MAE %.0f kbps (%.1f%%) %u samples ahead over %lu samples; bursts predicted %lu, missed %lu, false alarms %lu; mean lead over detection %.0f [ms]\n",
+              shard, err / cnt, obs > 0 ? 100.0 * err / obs : 0.0, f->cfg.lead, cnt, f->hits, f->misses, f->false_alarms,
+              f->hits > 0 ? (double)f->gain_sum_ms / f->hits : 0.0);
+}
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef DRL_EXP_H
+#define DRL_EXP_H
+
+// Experience of the drl policy, (state, action, reward, next state) per UE
+// and indication, in a POSIX shared-memory ring for a trainer on the same
+// host (tools/drl_trainer.c).
+//
+// The xApp creates the segment, every shard writes to it and nothing in it
+// waits for the reader: a slot is claimed with one fetch-add on head and
+// the oldest entries are overwritten. Entries are written and read in
+// place. Entry i holds seq = i + 1 once written and 0 while being written,
+// so a reader checks seq before and after using it, as with a seqlock.
+//
+// Segment: drl_exp_hdr_t, then cap entries of entry_sz bytes.
+
+#include "xlog.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define DRL_EXP_MAGIC "DRLX"
+#define DRL_EXP_VERSION 1
+#define DRL_EXP_CAP (1u << 16)  // Entries, a power of two
+#define DRL_EXP_MAX_FEAT 16
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_sz;  // sizeof(drl_exp_t)
+    uint32_t num_feat;  // Of s and s2
+    uint64_t cap;
+    _Alignas(64) _Atomic uint64_t head;  // Entries claimed so far
+} drl_exp_hdr_t;
+
+typedef struct {
+    _Atomic uint64_t seq;
+    uint64_t ue_key;  // RAN UE ID, or AMF UE NGAP ID
+    int64_t t_us;     // Of the indication of s2
+    int64_t dt_us;    // Since the one of s
+    float s[DRL_EXP_MAX_FEAT];
+    float s2[DRL_EXP_MAX_FEAT];
+    float reward;
+    uint32_t action;  // 1: URLLC
+    uint32_t prb;     // PRBs allocated after the action
+} drl_exp_t;
+
+typedef struct {
+    drl_exp_hdr_t* hdr;
+    drl_exp_t* e;
+    size_t sz;
+    uint64_t mask;
+    ino_t ino;  // Of the segment, a new one means a restarted xApp
+} drl_exp_ring_t;
+
+static inline size_t drl_exp_entries_off(void) {
+    return (sizeof(drl_exp_hdr_t) + 63) / 64 * 64;
+}
+
+static inline void drl_exp_close(drl_exp_ring_t* r) {
+    if (r->hdr != NULL)
+        munmap(r->hdr, r->sz);
+    memset(r, 0, sizeof(*r));
+}
+
+// Writer side. A segment left by an earlier run is replaced, a trainer still
+// attached to it notices the new inode.
+static inline bool drl_exp_create(drl_exp_ring_t* r, char const* name, uint32_t num_feat) {
+    assert(num_feat <= DRL_EXP_MAX_FEAT);
+    memset(r, 0, sizeof(*r));
+    shm_unlink(name);
+    int const fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        XLOG_ERROR("[DRL]: shm_open %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    size_t const sz = drl_exp_entries_off() + (size_t)DRL_EXP_CAP * sizeof(drl_exp_t);
+    struct stat sb;
+    void* p = MAP_FAILED;
+    if (ftruncate(fd, (off_t)sz) == 0 && fstat(fd, &sb) == 0)
+        p = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        XLOG_ERROR("[DRL]: Experience ring %s: %s\n", name, strerror(errno));
+    close(fd);
+    if (p == MAP_FAILED) {
+        shm_unlink(name);
+        return false;
+    }
+    r->hdr = p;
+    r->e = (drl_exp_t*)((uint8_t*)p + drl_exp_entries_off());
+    r->sz = sz;
+    r->mask = DRL_EXP_CAP - 1;
+    r->ino = sb.st_ino;
+    // Fresh pages are zero: every seq is 0 already
+    r->hdr->version = DRL_EXP_VERSION;
+    r->hdr->entry_sz = sizeof(drl_exp_t);
+    r->hdr->num_feat = num_feat;
+    r->hdr->cap = DRL_EXP_CAP;
+    atomic_init(&r->hdr->head, 0);
+    atomic_thread_fence(memory_order_release);
+    memcpy(r->hdr->magic, DRL_EXP_MAGIC, 4);
+    return true;
+}
+
+// Reader side, read only. False while the xApp has not created name, or
+// when it is not a ring of this version.
+static inline bool drl_exp_attach(drl_exp_ring_t* r, char const* name) {
+    memset(r, 0, sizeof(*r));
+    int const fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return false;
+    struct stat sb;
+    void* p = MAP_FAILED;
+    if (fstat(fd, &sb) == 0 && (size_t)sb.st_size >= drl_exp_entries_off())
+        p = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+    drl_exp_hdr_t const* hdr = p;
+    atomic_thread_fence(memory_order_acquire);
+    if (memcmp(hdr->magic, DRL_EXP_MAGIC, 4) != 0 || hdr->version != DRL_EXP_VERSION || hdr->entry_sz != sizeof(drl_exp_t)
+        || hdr->num_feat > DRL_EXP_MAX_FEAT || hdr->cap == 0 || (hdr->cap & (hdr->cap - 1)) != 0
+        || drl_exp_entries_off() + hdr->cap * sizeof(drl_exp_t) > (size_t)sb.st_size) {
+        munmap(p, (size_t)sb.st_size);
+        return false;
+    }
+    r->hdr = p;
+    r->e = (drl_exp_t*)((uint8_t*)p + drl_exp_entries_off());
+    r->sz = (size_t)sb.st_size;
+    r->mask = hdr->cap - 1;
+    r->ino = sb.st_ino;
+    return true;
+}
+
+// True when name is no longer the segment r maps
+static inline bool drl_exp_replaced(drl_exp_ring_t const* r, char const* name) {
+    int const fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0)
+        return true;
+    struct stat sb;
+    bool const same = fstat(fd, &sb) == 0 && sb.st_ino == r->ino;
+    close(fd);
+    return !same;
+}
+
+// Writer side: an entry to fill, then drl_exp_publish() it. Any thread.
+static inline drl_exp_t* drl_exp_claim(drl_exp_ring_t* r, uint64_t* idx) {
+    *idx = atomic_fetch_add_explicit(&r->hdr->head, 1, memory_order_relaxed);
+    drl_exp_t* e = &r->e[*idx & r->mask];
+    atomic_store_explicit(&e->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return e;
+}
+
+static inline void drl_exp_publish(drl_exp_t* e, uint64_t idx) {
+    atomic_store_explicit(&e->seq, idx + 1, memory_order_release);
+}
+
+static inline uint64_t drl_exp_head(drl_exp_ring_t const* r) {
+    return atomic_load_explicit(&r->hdr->head, memory_order_acquire);
+}
+
+// Reader side: entry idx in place, or NULL when it is not written yet or
+// already overwritten. Whatever was read from it only counts if
+// drl_exp_intact() holds afterwards.
+static inline drl_exp_t const* drl_exp_get(drl_exp_ring_t const* r, uint64_t idx) {
+    drl_exp_t const* e = &r->e[idx & r->mask];
+    return atomic_load_explicit(&e->seq, memory_order_acquire) == idx + 1 ? e : NULL;
+}
+
+static inline bool drl_exp_intact(drl_exp_t const* e, uint64_t idx) {
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&e->seq, memory_order_relaxed) == idx + 1;
+}
+
+#endif
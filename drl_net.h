@@ -0,0 +1,280 @@
+#ifndef DRL_NET_H
+#define DRL_NET_H
+
+// Inference of a small policy network trained offline, see policy_drl.c:
+// a stack of dense layers, evaluated for every UE of an indication in one
+// pass. No runtime: the weights are a plain file.
+//
+// File, little endian:
+//   char magic[4] "DRLN", u32 version (1), u32 inputs, u32 layers
+//   f32 mean[inputs], f32 scale[inputs]  x' = (x - mean) * scale
+//   per layer: u32 in, u32 out, u32 act (drl_act_e),
+//              f32 w[out][in], f32 b[out]
+//
+// Activations are stored a row per neuron, UEs along the row, padded to
+// DRL_NET_BLOCK. A dense layer then broadcasts each weight against a block
+// of UEs held in vector registers, one FMA per weight and 8 UEs. On x86 the
+// kernel is also built for AVX2+FMA and picked at load time.
+
+#include "xlog.h"
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define DRL_NET_MAGIC "DRLN"
+#define DRL_NET_VERSION 1
+#define DRL_NET_MAX_LAYERS 16
+#define DRL_NET_MAX_WIDTH 1024
+#define DRL_NET_BLOCK 32  // UEs one kernel pass keeps in registers
+
+// x86-64-v3 is picked on CPU features (AVX2, FMA), arch=haswell would be on
+// the CPU model
+#if defined(__x86_64__) && !defined(__AVX2__) && !defined(__clang__) && defined(__GNUC__) && __GNUC__ >= 12
+#define DRL_NET_CLONES __attribute__((target_clones("arch=x86-64-v3", "default")))
+#endif
+#ifndef DRL_NET_CLONES
+#define DRL_NET_CLONES
+#endif
+
+typedef enum {
+    DRL_ACT_LINEAR = 0,
+    DRL_ACT_RELU = 1,
+    DRL_ACT_TANH = 2,
+} drl_act_e;
+
+typedef struct {
+    uint32_t in;
+    uint32_t out;
+    uint32_t act;  // drl_act_e
+    float* w;      // [out][in]
+    float* b;
+} drl_layer_t;
+
+typedef struct {
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t num_layers;
+    uint32_t max_width;
+    float* mean;
+    float* scale;
+    drl_layer_t layer[DRL_NET_MAX_LAYERS];
+    float* act[2];  // [max_width][stride], layers alternate between them
+    size_t stride;  // Row length, a multiple of DRL_NET_BLOCK
+} drl_net_t;
+
+typedef float drl_v8_t __attribute__((vector_size(8 * sizeof(float))));
+typedef int32_t drl_v8i_t __attribute__((vector_size(8 * sizeof(int32_t))));
+
+static inline bool drl_net_read(FILE* f, void* dst, size_t n) {
+    return fread(dst, 1, n, f) == n;
+}
+
+static inline float* drl_net_floats(FILE* f, size_t n) {
+    float* v = malloc(n * sizeof(float));
+    assert(v != NULL && "Memory exhausted");
+    if (!drl_net_read(f, v, n * sizeof(float))) {
+        free(v);
+        return NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!isfinite(v[i])) {
+            free(v);
+            return NULL;
+        }
+    }
+    return v;
+}
+
+static inline void drl_net_free(drl_net_t* net) {
+    free(net->mean);
+    free(net->scale);
+    // Also the layer a failed load stopped in
+    for (uint32_t k = 0; k < DRL_NET_MAX_LAYERS; k++) {
+        free(net->layer[k].w);
+        free(net->layer[k].b);
+    }
+    free(net->act[0]);
+    free(net->act[1]);
+    memset(net, 0, sizeof(*net));
+}
+
+// Frees the activations of a drl_net_share() copy, the weights stay
+static inline void drl_net_unshare(drl_net_t* net) {
+    free(net->act[0]);
+    free(net->act[1]);
+    memset(net, 0, sizeof(*net));
+}
+
+// dst runs the weights of src, which keeps owning them, on activations of
+// its own. Only drl_net_run() reads them: src must outlive its last call.
+static inline void drl_net_share(drl_net_t* dst, drl_net_t const* src) {
+    drl_net_unshare(dst);
+    *dst = *src;
+    dst->act[0] = dst->act[1] = NULL;
+    dst->stride = 0;
+}
+
+// False, with the reason logged, when path is not a valid network
+static inline bool drl_net_load(drl_net_t* net, char const* path) {
+    memset(net, 0, sizeof(*net));
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        XLOG_ERROR("[DRL]: Cannot open %s\n", path);
+        return false;
+    }
+    char magic[4];
+    uint32_t hdr[3];  // version, inputs, layers
+    char const* err = NULL;
+    if (!drl_net_read(f, magic, sizeof(magic)) || memcmp(magic, DRL_NET_MAGIC, 4) != 0 || !drl_net_read(f, hdr, sizeof(hdr)))
+        err = "not a network file";
+    else if (hdr[0] != DRL_NET_VERSION)
+        err = "unsupported version";
+    else if (hdr[1] == 0 || hdr[1] > DRL_NET_MAX_WIDTH || hdr[2] == 0 || hdr[2] > DRL_NET_MAX_LAYERS)
+        err = "too many inputs or layers";
+    else if ((net->mean = drl_net_floats(f, hdr[1])) == NULL || (net->scale = drl_net_floats(f, hdr[1])) == NULL)
+        err = "truncated or non-finite normalization";
+    if (err == NULL) {
+        net->inputs = hdr[1];
+        net->max_width = hdr[1];
+        uint32_t prev = hdr[1];
+        for (uint32_t k = 0; k < hdr[2] && err == NULL; k++) {
+            drl_layer_t* l = &net->layer[k];
+            uint32_t dims[3];  // in, out, act
+            if (!drl_net_read(f, dims, sizeof(dims)))
+                err = "truncated layer";
+            else if (dims[0] != prev || dims[1] == 0 || dims[1] > DRL_NET_MAX_WIDTH || dims[2] > DRL_ACT_TANH)
+                err = "layer does not fit the previous one";
+            else if ((l->w = drl_net_floats(f, (size_t)dims[0] * dims[1])) == NULL || (l->b = drl_net_floats(f, dims[1])) == NULL)
+                err = "truncated or non-finite weights";
+            if (err != NULL)
+                break;
+            l->in = dims[0];
+            l->out = dims[1];
+            l->act = dims[2];
+            net->num_layers = k + 1;
+            net->max_width = l->out > net->max_width ? l->out : net->max_width;
+            prev = l->out;
+        }
+        net->outputs = prev;
+    }
+    if (err == NULL && fgetc(f) != EOF)
+        err = "trailing bytes";
+    fclose(f);
+    if (err != NULL) {
+        XLOG_ERROR("[DRL]: %s: %s\n", path, err);
+        drl_net_free(net);
+        return false;
+    }
+    return true;
+}
+
+// Writes net to path through a temporary file renamed over it, so a reader
+// sees the old network or the new one
+static inline bool drl_net_save(drl_net_t const* net, char const* path) {
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+        return false;
+    FILE* f = fopen(tmp, "wb");
+    if (f == NULL) {
+        XLOG_ERROR("[DRL]: Cannot create %s\n", tmp);
+        return false;
+    }
+    uint32_t const hdr[3] = {DRL_NET_VERSION, net->inputs, net->num_layers};
+    bool ok = fwrite(DRL_NET_MAGIC, 1, 4, f) == 4 && fwrite(hdr, sizeof(hdr), 1, f) == 1
+              && fwrite(net->mean, sizeof(float), net->inputs, f) == net->inputs
+              && fwrite(net->scale, sizeof(float), net->inputs, f) == net->inputs;
+    for (uint32_t k = 0; k < net->num_layers && ok; k++) {
+        drl_layer_t const* l = &net->layer[k];
+        uint32_t const dims[3] = {l->in, l->out, l->act};
+        size_t const nw = (size_t)l->in * l->out;
+        ok = fwrite(dims, sizeof(dims), 1, f) == 1 && fwrite(l->w, sizeof(float), nw, f) == nw
+             && fwrite(l->b, sizeof(float), l->out, f) == l->out;
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp, path) != 0) {
+        XLOG_ERROR("[DRL]: Cannot write %s\n", path);
+        remove(tmp);
+        return false;
+    }
+    return true;
+}
+
+// Room for n UEs
+static inline void drl_net_reserve(drl_net_t* net, size_t n) {
+    size_t const stride = (n + DRL_NET_BLOCK - 1) / DRL_NET_BLOCK * DRL_NET_BLOCK;
+    if (stride <= net->stride)
+        return;
+    for (int k = 0; k < 2; k++) {
+        free(net->act[k]);
+        net->act[k] = aligned_alloc(64, (size_t)net->max_width * stride * sizeof(float));
+        assert(net->act[k] != NULL && "Memory exhausted");
+    }
+    net->stride = stride;
+}
+
+// Input matrix for n UEs: feature f of UE u goes to [f * net->stride + u]
+static inline float* drl_net_input(drl_net_t* net, size_t n) {
+    drl_net_reserve(net, n);
+    return net->act[0];
+}
+
+// y = act(W x + b) for the UE blocks of [0, n). The four accumulators are
+// named, an array of them would live in memory at -O2.
+DRL_NET_CLONES
+static void drl_net_dense(drl_layer_t const* l, float const* restrict x, float* restrict y, size_t n, size_t stride) {
+    _Static_assert(DRL_NET_BLOCK == 4 * 8, "drl_net_dense handles 4 vectors of 8 UEs");
+    for (size_t u = 0; u < n; u += DRL_NET_BLOCK) {
+        for (uint32_t o = 0; o < l->out; o++) {
+            float const* const w = l->w + (size_t)o * l->in;
+            drl_v8_t a0 = (drl_v8_t){0} + l->b[o], a1 = a0, a2 = a0, a3 = a0;
+            for (uint32_t i = 0; i < l->in; i++) {
+                drl_v8_t const* xi = (drl_v8_t const*)(x + (size_t)i * stride + u);
+                a0 += w[i] * xi[0];
+                a1 += w[i] * xi[1];
+                a2 += w[i] * xi[2];
+                a3 += w[i] * xi[3];
+            }
+            if (l->act == DRL_ACT_RELU) {
+                a0 = (drl_v8_t)((a0 > 0) & (drl_v8i_t)a0);
+                a1 = (drl_v8_t)((a1 > 0) & (drl_v8i_t)a1);
+                a2 = (drl_v8_t)((a2 > 0) & (drl_v8i_t)a2);
+                a3 = (drl_v8_t)((a3 > 0) & (drl_v8i_t)a3);
+            }
+            drl_v8_t* const yo = (drl_v8_t*)(y + (size_t)o * stride + u);
+            yo[0] = a0;
+            yo[1] = a1;
+            yo[2] = a2;
+            yo[3] = a3;
+            if (l->act == DRL_ACT_TANH) {
+                for (int k = 0; k < DRL_NET_BLOCK; k++)
+                    yo[k / 8][k % 8] = tanhf(yo[k / 8][k % 8]);
+            }
+        }
+    }
+}
+
+// Evaluates the n UEs of drl_net_input(). Output k of UE u is at
+// [k * net->stride + u], valid until the next call.
+static inline float const* drl_net_run(drl_net_t* net, size_t n) {
+    if (n == 0)
+        return net->act[0];
+    size_t const end = (n + DRL_NET_BLOCK - 1) / DRL_NET_BLOCK * DRL_NET_BLOCK;
+    float* const x = net->act[0];
+    for (uint32_t f = 0; f < net->inputs; f++) {
+        float* row = x + (size_t)f * net->stride;
+        for (size_t u = 0; u < n; u++)
+            row[u] = (row[u] - net->mean[f]) * net->scale[f];
+        // Padding lanes are computed too, keep them finite
+        memset(row + n, 0, (end - n) * sizeof(float));
+    }
+    for (uint32_t k = 0; k < net->num_layers; k++)
+        drl_net_dense(&net->layer[k], net->act[k % 2], net->act[(k + 1) % 2], end, net->stride);
+    return net->act[net->num_layers % 2];
+}
+
+#endif
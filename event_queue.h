@@ -0,0 +1,72 @@
+#ifndef EVENT_QUEUE_H
+#define EVENT_QUEUE_H
+
+// SPSC event ring plus an eventfd to wake the consumer. Pushing never
+// blocks: the producer pushes any number of events, then calls
+// event_queue_notify() once, which is a single non-blocking write(2).
+
+#include "spsc_ring.h"
+#include <assert.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+typedef struct {
+    spsc_ring_t ring;
+    int efd;
+    atomic_size_t dropped;  // Events lost to a full ring
+} event_queue_t;
+
+static inline void event_queue_init(event_queue_t* q, size_t elem_sz, size_t cap) {
+    spsc_ring_init(&q->ring, elem_sz, cap);
+    q->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    assert(q->efd >= 0 && "eventfd failed");
+    atomic_init(&q->dropped, 0);
+}
+
+static inline void event_queue_free(event_queue_t* q) {
+    close(q->efd);
+    spsc_ring_free(&q->ring);
+}
+
+static inline bool event_queue_push(event_queue_t* q, void const* ev) {
+    if (spsc_ring_push(&q->ring, ev))
+        return true;
+    atomic_fetch_add_explicit(&q->dropped, 1, memory_order_relaxed);
+    return false;
+}
+
+static inline void event_queue_notify(event_queue_t* q) {
+    uint64_t const one = 1;
+    ssize_t const rc = write(q->efd, &one, sizeof(one));
+    (void)rc;  // EAGAIN only when the counter saturates, the consumer is awake then
+}
+
+// Blocks until notified or timeout_ms elapses (-1 waits forever). Returns
+// false on timeout.
+static inline bool event_queue_wait(event_queue_t* q, int timeout_ms) {
+    struct pollfd pfd = {.fd = q->efd, .events = POLLIN};
+    int rc;
+    do {
+        rc = poll(&pfd, 1, timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    if (rc <= 0)
+        return false;
+    uint64_t cnt;
+    ssize_t const n = read(q->efd, &cnt, sizeof(cnt));
+    (void)n;
+    return true;
+}
+
+static inline void* event_queue_peek(event_queue_t* q) {
+    return spsc_ring_peek(&q->ring);
+}
+
+static inline void event_queue_pop(event_queue_t* q) {
+    spsc_ring_pop(&q->ring);
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef KPM_MEAS_MAP_H
+#define KPM_MEAS_MAP_H
+
+// Resolves KPM measurement names to store handlers once, when the
+// subscription is built, instead of comparing strings for every record.
+//
+// Records in an indication follow the order of meas_info_lst, which is the
+// order the action definition asked for. The map holds one slot per index:
+// a handler plus the offset of the field it writes in the UE record. The
+// xApp lists the KPIs it knows in a kpm_meas_def_t table. Any other name
+// is registered into one of the record's spare float fields, so it is
+// stored too instead of being dropped.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "xlog.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KPM_MEAS_NAME_LEN 64
+// Spare float fields per UE record for KPIs the xApp does not know
+#define KPM_MEAS_MAX_EXTRA 8
+
+typedef struct kpm_meas_slot_s kpm_meas_slot_t;
+
+typedef void (*kpm_meas_store_fn)(kpm_meas_slot_t const* slot, meas_record_lst_t const* rec, void* dst);
+
+typedef struct {
+    char const* name;
+    char const* unit;
+    kpm_meas_store_fn store;
+    size_t offset;  // Into the UE record
+} kpm_meas_def_t;
+
+struct kpm_meas_slot_s {
+    kpm_meas_store_fn store;  // NULL: record ignored
+    size_t offset;
+    char const* unit;
+    char name[KPM_MEAS_NAME_LEN];
+};
+
+typedef struct {
+    kpm_meas_def_t const* defs;
+    size_t num_defs;
+    size_t extra_offset;  // float[KPM_MEAS_MAX_EXTRA] in the UE record
+
+    size_t len;
+    kpm_meas_slot_t* slot;
+    bool verify;  // Compare the names of the next indication, set on (re)subscription
+
+    size_t num_extra;
+    char extra_name[KPM_MEAS_MAX_EXTRA][KPM_MEAS_NAME_LEN];
+} kpm_meas_map_t;
+
+static inline double kpm_meas_value(meas_record_lst_t const* rec) {
+    return rec->value == INTEGER_MEAS_VALUE ? (double)rec->int_val : rec->real_val;
+}
+
+// Handlers for int and float fields
+
+static inline void kpm_store_int(kpm_meas_slot_t const* slot, meas_record_lst_t const* rec, void* dst) {
+    int const v = rec->value == INTEGER_MEAS_VALUE ? (int)rec->int_val : (int)rec->real_val;
+    XLOG_TRACE("%s = %d [%s]\n", slot->name, v, slot->unit);
+    *(int*)dst = v;
+}
+
+static inline void kpm_store_real(kpm_meas_slot_t const* slot, meas_record_lst_t const* rec, void* dst) {
+    float const v = (float)kpm_meas_value(rec);
+    XLOG_TRACE("%s = %.2f [%s]\n", slot->name, v, slot->unit);
+    *(float*)dst = v;
+}
+
+static inline void kpm_meas_map_init(kpm_meas_map_t* map, kpm_meas_def_t const* defs, size_t num_defs, size_t extra_offset) {
+    assert(map != NULL && defs != NULL);
+    memset(map, 0, sizeof(*map));
+    map->defs = defs;
+    map->num_defs = num_defs;
+    map->extra_offset = extra_offset;
+}
+
+static inline void kpm_meas_map_free(kpm_meas_map_t* map) {
+    free(map->slot);
+    map->slot = NULL;
+    map->len = 0;
+}
+
+static inline void kpm_meas_map_resize(kpm_meas_map_t* map, size_t len) {
+    if (len != map->len) {
+        map->slot = realloc(map->slot, len * sizeof(kpm_meas_slot_t));
+        assert((map->slot != NULL || len == 0) && "Memory exhausted");
+        map->len = len;
+    }
+    memset(map->slot, 0, len * sizeof(kpm_meas_slot_t));
+}
+
+static inline int kpm_meas_map_extra_idx(kpm_meas_map_t* map, char const* name) {
+    for (size_t i = 0; i < map->num_extra; i++) {
+        if (strcmp(map->extra_name[i], name) == 0)
+            return (int)i;
+    }
+    if (map->num_extra == KPM_MEAS_MAX_EXTRA)
+        return -1;
+    snprintf(map->extra_name[map->num_extra], KPM_MEAS_NAME_LEN, "%s", name);
+    XLOG_INFO("[KPM]: Registered measurement %s in extra slot %zu\n", name, map->num_extra);
+    return (int)map->num_extra++;
+}
+
+// Binds record index idx to the measurement called name
+static inline void kpm_meas_map_set(kpm_meas_map_t* map, size_t idx, byte_array_t name) {
+    assert(idx < map->len);
+    kpm_meas_slot_t* slot = &map->slot[idx];
+    size_t const n = name.len < KPM_MEAS_NAME_LEN ? name.len : KPM_MEAS_NAME_LEN - 1;
+    memcpy(slot->name, name.buf, n);
+    slot->name[n] = '\0';
+
+    for (size_t i = 0; i < map->num_defs; i++) {
+        if (cmp_str_ba(map->defs[i].name, name) == 0) {
+            slot->store = map->defs[i].store;
+            slot->offset = map->defs[i].offset;
+            slot->unit = map->defs[i].unit;
+            return;
+        }
+    }
+
+    int const extra = kpm_meas_map_extra_idx(map, slot->name);
+    if (extra < 0) {
+        XLOG_WARN("[KPM]: No free slot for measurement %s, ignored\n", slot->name);
+        return;
+    }
+    slot->store = kpm_store_real;
+    slot->offset = map->extra_offset + (size_t)extra * sizeof(float);
+    slot->unit = "-";
+}
+
+// Rebinds every index from the names of an indication
+static inline void kpm_meas_map_from_ind(kpm_meas_map_t* map, kpm_ind_msg_format_1_t const* msg_frm_1) {
+    kpm_meas_map_resize(map, msg_frm_1->meas_info_lst_len);
+    for (size_t i = 0; i < msg_frm_1->meas_info_lst_len; i++) {
+        meas_type_t const* type = &msg_frm_1->meas_info_lst[i].meas_type;
+        if (type->type == NAME_MEAS_TYPE)
+            kpm_meas_map_set(map, i, type->name);
+    }
+}
+
+static inline void kpm_meas_map_store(kpm_meas_map_t const* map, size_t idx, meas_record_lst_t const* rec, void* ue_rec) {
+    kpm_meas_slot_t const* slot = &map->slot[idx];
+    if (slot->store != NULL && rec->value != NO_VALUE_MEAS_VALUE)
+        slot->store(slot, rec, (uint8_t*)ue_rec + slot->offset);
+}
+
+// True when the map is bound to the names of msg_frm_1, in its order
+static inline bool kpm_meas_map_matches(kpm_meas_map_t const* map, kpm_ind_msg_format_1_t const* msg_frm_1) {
+    if (msg_frm_1->meas_info_lst_len != map->len)
+        return false;
+    for (size_t i = 0; i < map->len; i++) {
+        meas_type_t const* type = &msg_frm_1->meas_info_lst[i].meas_type;
+        char const* bound = map->slot[i].name;
+        if (type->type != NAME_MEAS_TYPE) {
+            if (bound[0] != '\0')
+                return false;
+            continue;
+        }
+        size_t const n = type->name.len < KPM_MEAS_NAME_LEN ? type->name.len : KPM_MEAS_NAME_LEN - 1;
+        if (bound[n] != '\0' || memcmp(bound, type->name.buf, n) != 0)
+            return false;
+    }
+    return true;
+}
+
+// The names of the next indication are compared against the bound ones,
+// after a new subscription took over
+static inline void kpm_meas_map_recheck(kpm_meas_map_t* map) {
+    map->verify = true;
+}
+
+// Stores one UE's records of an indication into ue_rec. The names are
+// compared once after a (re)subscription, and again only when the list
+// length changes: a node that reports another list than the one subscribed
+// to, or the same names in another order, rebinds the map then. Malformed
+// items are skipped.
+static inline void kpm_meas_map_decode(kpm_meas_map_t* map, kpm_ind_msg_format_1_t const* msg_frm_1, void* ue_rec) {
+    if (msg_frm_1->meas_info_lst_len == 0) {
+        XLOG_WARN("[KPM]: Indication without measurement info, ignored\n");
+        return;
+    }
+    if (map->verify || msg_frm_1->meas_info_lst_len != map->len) {
+        map->verify = false;
+        if (!kpm_meas_map_matches(map, msg_frm_1))
+            kpm_meas_map_from_ind(map, msg_frm_1);
+    }
+
+    for (size_t j = 0; j < msg_frm_1->meas_data_lst_len; j++) {
+        meas_data_lst_t const* data_item = &msg_frm_1->meas_data_lst[j];
+        if (data_item->meas_record_len > map->len) {
+            XLOG_WARN("[KPM]: %zu records for %zu measurements, item ignored\n", (size_t)data_item->meas_record_len, map->len);
+            continue;
+        }
+        for (size_t z = 0; z < data_item->meas_record_len; z++) {
+            kpm_meas_map_store(map, z, &data_item->meas_record_lst[z], ue_rec);
+            if (data_item->incomplete_flag && *data_item->incomplete_flag == TRUE_ENUM_VALUE)
+                XLOG_DEBUG("Measurement Record not reliable\n");
+        }
+    }
+}
+
+// Resolves the names of an action definition, before its first indication
+static inline void kpm_meas_map_bind(kpm_meas_map_t* map, kpm_act_def_format_1_t const* ad) {
+    kpm_meas_map_resize(map, ad->meas_info_lst_len);
+    for (size_t i = 0; i < ad->meas_info_lst_len; i++)
+        kpm_meas_map_set(map, i, ad->meas_info_lst[i].meas_type.name);
+    map->verify = true;
+}
+
+#endif
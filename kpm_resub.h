@@ -0,0 +1,164 @@
+#ifndef KPM_RESUB_H
+#define KPM_RESUB_H
+
+// Replaces the KPM subscription of one E2 node without a gap in its
+// indications, to change the report period while the node reports.
+//
+// Removing the subscription and then adding the new one loses the
+// indications of a round trip or more. Instead the node's second slot
+// (node_shard.h) subscribes at the new period while the first keeps
+// reporting. The first indication of the new subscription makes it the
+// active one: from then on the old one's indications are dropped, and it
+// is removed. Until the cutover the old period keeps running, after it the
+// new one, so the series never misses a report.
+//
+// report_sm_xapp_api() and rm_report_sm_xapp_api() wait for the RIC, so
+// they are never called from the indication callback. kpm_resub_start(),
+// kpm_resub_poll() and kpm_resub_stop() run on the xApp's subscription
+// thread, serialized by the caller. kpm_resub_accept() runs in the
+// callback, with the lock passed to kpm_resub_init() held; that lock
+// guards the slot state.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "../../../../src/util/alg_ds/ds/lock_guard/lock_guard.h"
+#include "node_shard.h"
+#include "xlog.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct {
+    uint32_t period_ms;
+    uint32_t gran_ms;
+    int64_t since_us;  // Subscribed at
+} kpm_resub_slot_t;
+
+typedef struct {
+    size_t shard;
+    global_e2_node_id_t* node_id;
+    sm_cb const* cb;  // [NODE_SHARD_SUBS]
+    pthread_mutex_t* lock;
+    sm_ans_xapp_t sub[NODE_SHARD_SUBS];  // Subscription thread only
+
+    // Under *lock
+    kpm_resub_slot_t slot[NODE_SHARD_SUBS];
+    int active;   // Slot whose indications are used, -1: none yet
+    int pending;  // Subscribed, no indication yet, -1: none
+    int retired;  // Replaced, to be removed, -1: none
+    int64_t retry_us;  // No new subscription before, after one timed out
+    uint64_t swaps;
+} kpm_resub_t;
+
+typedef enum {
+    KPM_RESUB_DROP,    // From a replaced subscription
+    KPM_RESUB_KEEP,
+    KPM_RESUB_SWITCH,  // First of the new subscription, the period changed
+} kpm_resub_e;
+
+static inline void kpm_resub_init(kpm_resub_t* r, size_t shard, global_e2_node_id_t* node_id, sm_cb const* cb, pthread_mutex_t* lock) {
+    memset(r, 0, sizeof(*r));
+    r->shard = shard;
+    r->node_id = node_id;
+    r->cb = cb;
+    r->lock = lock;
+    r->active = r->pending = r->retired = -1;
+}
+
+// Period and granularity of the subscription in place, or of the one on its
+// way. False before the first subscription.
+static inline bool kpm_resub_target(kpm_resub_t* r, uint32_t* period_ms, uint32_t* gran_ms) {
+    lock_guard(r->lock);
+    int const k = r->pending >= 0 ? r->pending : r->active;
+    if (k < 0)
+        return false;
+    *period_ms = r->slot[k].period_ms;
+    *gran_ms = r->slot[k].gran_ms;
+    return true;
+}
+
+// Subscribes the idle slot with sub, for indications every period_ms. The
+// active slot keeps reporting until the new one delivers. False while a
+// swap is still under way or backing off, or when the node refuses.
+static inline bool kpm_resub_start(kpm_resub_t* r, kpm_sub_data_t* sub, uint32_t period_ms, uint32_t gran_ms, int64_t now) {
+    int k;
+    {
+        lock_guard(r->lock);
+        if (r->pending >= 0 || r->retired >= 0 || now < r->retry_us)
+            return false;
+        k = r->active == 0 ? 1 : 0;
+        r->slot[k] = (kpm_resub_slot_t){.period_ms = period_ms, .gran_ms = gran_ms, .since_us = now};
+        r->pending = k;
+    }
+    int const KPM_ran_function = 2;
+    r->sub[k] = report_sm_xapp_api(r->node_id, KPM_ran_function, sub, r->cb[k]);
+    if (!r->sub[k].success) {
+        lock_guard(r->lock);
+        r->pending = -1;
+        XLOG_WARN("[SHARD %zu]: KPM subscription at %u [ms] refused\n", r->shard, period_ms);
+        return false;
+    }
+    return true;
+}
+
+// Classifies an indication of slot k. Caller holds the lock.
+static inline kpm_resub_e kpm_resub_accept(kpm_resub_t* r, size_t k) {
+    if ((int)k == r->active)
+        return KPM_RESUB_KEEP;
+    if ((int)k != r->pending)
+        return KPM_RESUB_DROP;
+    r->retired = r->active;
+    r->active = r->pending;
+    r->pending = -1;
+    r->swaps++;
+    return KPM_RESUB_SWITCH;
+}
+
+// Removes the replaced subscription, and gives up on a new one that has not
+// delivered within timeout_us. True when a swap is under way or backing off.
+static inline bool kpm_resub_poll(kpm_resub_t* r, int64_t now, int64_t timeout_us) {
+    int retired = -1;
+    int expired = -1;
+    bool busy;
+    {
+        // Claimed under the lock, so the callback drops their indications
+        // before they are removed
+        lock_guard(r->lock);
+        retired = r->retired;
+        r->retired = -1;
+        if (r->pending >= 0 && now - r->slot[r->pending].since_us > timeout_us) {
+            expired = r->pending;
+            r->pending = -1;
+            r->retry_us = now + timeout_us;
+        }
+        busy = r->pending >= 0 || now < r->retry_us;
+    }
+    if (retired >= 0 && r->sub[retired].success) {
+        rm_report_sm_xapp_api(r->sub[retired].u.handle);
+        r->sub[retired].success = false;
+    }
+    if (expired >= 0) {
+        XLOG_WARN("[SHARD %zu]: No indication at %u [ms] within %ld [ms], keeping the running subscription\n", r->shard,
+                  r->slot[expired].period_ms, timeout_us / 1000);
+        if (r->sub[expired].success)
+            rm_report_sm_xapp_api(r->sub[expired].u.handle);
+        r->sub[expired].success = false;
+    }
+    return busy;
+}
+
+// Removes every subscription of the node
+static inline void kpm_resub_stop(kpm_resub_t* r) {
+    {
+        lock_guard(r->lock);
+        r->active = r->pending = r->retired = -1;
+    }
+    for (size_t k = 0; k < NODE_SHARD_SUBS; k++) {
+        if (r->sub[k].success)
+            rm_report_sm_xapp_api(r->sub[k].u.handle);
+        r->sub[k].success = false;
+    }
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef KPM_SUB_H
+#define KPM_SUB_H
+
+// KPM report style 4 subscription: every KPI the node offers, for the UEs
+// of one S-NSSAI, reported every period_ms.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "../../../../src/util/e.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+// No SD in the S-NSSAI filter, only the SST
+#define KPM_SUB_NO_SD 0xffffff
+
+// S-NSSAI as an octet string: SST, then SD when there is one
+static inline test_info_lst_t kpm_sub_filter_predicate(test_cond_type_e type, test_cond_e cond, uint32_t sst, uint32_t sd) {
+    test_info_lst_t dst = {0};
+    dst.test_cond_type = type;
+    dst.S_NSSAI = TRUE_TEST_COND_TYPE;
+    dst.test_cond = calloc(1, sizeof(test_cond_e));
+    assert(dst.test_cond != NULL && "Memory exhausted");
+    *dst.test_cond = cond;
+    dst.test_cond_value = calloc(1, sizeof(test_cond_value_t));
+    assert(dst.test_cond_value != NULL && "Memory exhausted");
+    dst.test_cond_value->type = OCTET_STRING_TEST_COND_VALUE;
+    dst.test_cond_value->octet_string_value = calloc(1, sizeof(byte_array_t));
+    assert(dst.test_cond_value->octet_string_value != NULL && "Memory exhausted");
+    const size_t len_nssai = sd == KPM_SUB_NO_SD ? 1 : 4;
+    dst.test_cond_value->octet_string_value->len = len_nssai;
+    dst.test_cond_value->octet_string_value->buf = calloc(len_nssai, sizeof(uint8_t));
+    assert(dst.test_cond_value->octet_string_value->buf != NULL && "Memory exhausted");
+    uint8_t* buf = dst.test_cond_value->octet_string_value->buf;
+    buf[0] = sst;
+    if (len_nssai == 4) {
+        buf[1] = sd >> 16;
+        buf[2] = sd >> 8;
+        buf[3] = sd;
+    }
+    return dst;
+}
+
+static inline label_info_lst_t kpm_sub_label(void) {
+    label_info_lst_t label_item = {0};
+    label_item.noLabel = ecalloc(1, sizeof(enum_value_e));
+    *label_item.noLabel = TRUE_ENUM_VALUE;
+    return label_item;
+}
+
+static inline kpm_act_def_format_1_t kpm_sub_act_def_frm_1(ric_report_style_item_t const* report_item, uint32_t gran_period_ms) {
+    assert(report_item != NULL);
+    kpm_act_def_format_1_t ad_frm_1 = {0};
+    size_t const sz = report_item->meas_info_for_action_lst_len;
+    ad_frm_1.meas_info_lst_len = sz;
+    ad_frm_1.meas_info_lst = calloc(sz, sizeof(meas_info_format_1_lst_t));
+    assert(ad_frm_1.meas_info_lst != NULL && "Memory exhausted");
+    for (size_t i = 0; i < sz; i++) {
+        meas_info_format_1_lst_t* meas_item = &ad_frm_1.meas_info_lst[i];
+        meas_item->meas_type.type = NAME_MEAS_TYPE;
+        meas_item->meas_type.name = copy_byte_array(report_item->meas_info_for_action_lst[i].name);
+        meas_item->label_info_lst_len = 1;
+        meas_item->label_info_lst = ecalloc(1, sizeof(label_info_lst_t));
+        meas_item->label_info_lst[0] = kpm_sub_label();
+    }
+    ad_frm_1.gran_period_ms = gran_period_ms;
+    ad_frm_1.cell_global_id = NULL;
+#if defined KPM_V2_03 || defined KPM_V3_00
+    ad_frm_1.meas_bin_range_info_lst_len = 0;
+    ad_frm_1.meas_bin_info_lst = NULL;
+#endif
+    return ad_frm_1;
+}
+
+static inline kpm_act_def_t kpm_sub_report_style_4(ric_report_style_item_t const* report_item, uint32_t gran_period_ms, uint32_t sst,
+                                                   uint32_t sd) {
+    assert(report_item != NULL);
+    assert(report_item->act_def_format_type == FORMAT_4_ACTION_DEFINITION);
+    kpm_act_def_t act_def = {.type = FORMAT_4_ACTION_DEFINITION};
+    act_def.frm_4.matching_cond_lst_len = 1;
+    act_def.frm_4.matching_cond_lst = calloc(act_def.frm_4.matching_cond_lst_len, sizeof(matching_condition_format_4_lst_t));
+    assert(act_def.frm_4.matching_cond_lst != NULL && "Memory exhausted");
+    test_cond_type_e const type = S_NSSAI_TEST_COND_TYPE;
+    test_cond_e const condition = EQUAL_TEST_COND;
+    act_def.frm_4.matching_cond_lst[0].test_info_lst = kpm_sub_filter_predicate(type, condition, sst, sd);
+    act_def.frm_4.action_def_format_1 = kpm_sub_act_def_frm_1(report_item, gran_period_ms);
+    return act_def;
+}
+
+// Free with free_kpm_sub_data()
+static inline kpm_sub_data_t kpm_sub_gen(kpm_ran_function_def_t const* ran_func, uint32_t period_ms, uint32_t gran_ms, uint32_t sst,
+                                         uint32_t sd) {
+    assert(ran_func != NULL);
+    assert(ran_func->ric_event_trigger_style_list != NULL);
+    kpm_sub_data_t kpm_sub = {0};
+    assert(ran_func->ric_event_trigger_style_list[0].format_type == FORMAT_1_RIC_EVENT_TRIGGER);
+    kpm_sub.ev_trg_def.type = FORMAT_1_RIC_EVENT_TRIGGER;
+    kpm_sub.ev_trg_def.kpm_ric_event_trigger_format_1.report_period_ms = period_ms;
+    kpm_sub.sz_ad = 1;
+    kpm_sub.ad = calloc(kpm_sub.sz_ad, sizeof(kpm_act_def_t));
+    assert(kpm_sub.ad != NULL && "Memory exhausted");
+    ric_report_style_item_t* const report_item = &ran_func->ric_report_style_list[0];
+    assert(report_item->report_style_type == STYLE_4_RIC_SERVICE_REPORT && "Only report style 4 is supported");
+    *kpm_sub.ad = kpm_sub_report_style_4(report_item, gran_ms, sst, sd);
+    return kpm_sub;
+}
+
+// Index of RAN function id in the node's list
+static inline size_t kpm_sub_find_rf(sm_ran_function_t const* rf, size_t sz, int id) {
+    for (size_t i = 0; i < sz; i++) {
+        if (rf[i].id == id)
+            return i;
+    }
+    assert(0 != 0 && "SM ID could not be found in the RAN Function List");
+    return sz;
+}
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef LAT_HIST_H
+#define LAT_HIST_H
+
+// HDR-style latency histogram. Buckets are log-linear: every power of two
+// is split into 2^LAT_HIST_SUB_BITS equal buckets, so a recorded value is
+// known to within 1/32 (3 %) from 1 ns up to LAT_HIST_MAX_NS, past which
+// it is clamped. 8 KiB per histogram, no allocation on record.
+//
+// One writer at a time, e.g. the thread holding the lock of what is timed:
+// lat_hist_record() is a relaxed load and store of one counter, neither a
+// lock nor a read-modify-write. Any thread may read with lat_hist_add_to()
+// meanwhile and sees each counter at most one record behind.
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#define LAT_HIST_SUB_BITS 5
+#define LAT_HIST_SUB (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_MAG_BITS 36  // 2^36 ns = 68.7 s
+#define LAT_HIST_BUCKETS ((LAT_HIST_MAG_BITS - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB)
+#define LAT_HIST_MAX_NS ((UINT64_C(1) << LAT_HIST_MAG_BITS) - 1)
+
+typedef struct {
+    _Atomic uint64_t count[LAT_HIST_BUCKETS];
+    _Atomic uint64_t sum_ns;  // Of the recorded values, as recorded
+} lat_hist_t;
+
+// Plain counts, what a reader merges histograms into
+typedef struct {
+    uint64_t count[LAT_HIST_BUCKETS];
+    uint64_t sum_ns;
+} lat_hist_counts_t;
+
+typedef struct {
+    uint64_t n;
+    int64_t p50_ns;
+    int64_t p99_ns;
+    int64_t p999_ns;
+    int64_t max_ns;
+} lat_hist_summary_t;
+
+// Monotonic, unlike time_now_us(): stage timers never mix clock domains
+static inline int64_t lat_hist_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline size_t lat_hist_bucket(int64_t ns) {
+    uint64_t v = ns < 0 ? 0 : (uint64_t)ns;
+    if (v > LAT_HIST_MAX_NS)
+        v = LAT_HIST_MAX_NS;
+    if (v < LAT_HIST_SUB)
+        return (size_t)v;
+    unsigned const shift = 63 - __builtin_clzll(v) - LAT_HIST_SUB_BITS;
+    return (size_t)(shift + 1) * LAT_HIST_SUB + (size_t)(v >> shift) - LAT_HIST_SUB;
+}
+
+// Highest value that lands in bucket i
+static inline int64_t lat_hist_bucket_max(size_t i) {
+    if (i < LAT_HIST_SUB)
+        return (int64_t)i;
+    unsigned const shift = (unsigned)(i / LAT_HIST_SUB) - 1;
+    uint64_t const lo = (uint64_t)(i % LAT_HIST_SUB + LAT_HIST_SUB) << shift;
+    return (int64_t)(lo + (UINT64_C(1) << shift) - 1);
+}
+
+static inline void lat_hist_reset(lat_hist_t* h) {
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++)
+        atomic_init(&h->count[i], 0);
+    atomic_init(&h->sum_ns, 0);
+}
+
+static inline void lat_hist_record(lat_hist_t* h, int64_t ns) {
+    _Atomic uint64_t* c = &h->count[lat_hist_bucket(ns)];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1, memory_order_relaxed);
+    if (ns > 0)
+        atomic_store_explicit(&h->sum_ns, atomic_load_explicit(&h->sum_ns, memory_order_relaxed) + (uint64_t)ns, memory_order_relaxed);
+}
+
+// acc += h
+static inline void lat_hist_add_to(lat_hist_counts_t* acc, lat_hist_t const* h) {
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++)
+        acc->count[i] += atomic_load_explicit(&h->count[i], memory_order_relaxed);
+    acc->sum_ns += atomic_load_explicit(&h->sum_ns, memory_order_relaxed);
+}
+
+// Records of c up to le_ns, counting a bucket once all of it is. Call with
+// rising le_ns and the same *i and *acc, starting from 0, to walk c once.
+static inline uint64_t lat_hist_count_le(lat_hist_counts_t const* c, int64_t le_ns, size_t* i, uint64_t* acc) {
+    for (; *i < LAT_HIST_BUCKETS && lat_hist_bucket_max(*i) <= le_ns; (*i)++)
+        *acc += c->count[*i];
+    return *acc;
+}
+
+// Percentiles of cur - prev, the records between two reads
+static inline lat_hist_summary_t lat_hist_summarize(lat_hist_counts_t const* cur, lat_hist_counts_t const* prev) {
+    lat_hist_summary_t sum = {0};
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++)
+        sum.n += cur->count[i] - (prev != NULL ? prev->count[i] : 0);
+    if (sum.n == 0)
+        return sum;
+    // Rank of each percentile, at least the first record
+    uint64_t const r50 = (sum.n * 500 + 999) / 1000;
+    uint64_t const r99 = (sum.n * 990 + 999) / 1000;
+    uint64_t const r999 = (sum.n * 999 + 999) / 1000;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LAT_HIST_BUCKETS; i++) {
+        uint64_t const c = cur->count[i] - (prev != NULL ? prev->count[i] : 0);
+        if (c == 0)
+            continue;
+        int64_t const v = lat_hist_bucket_max(i);
+        if (seen < r50 && seen + c >= r50)
+            sum.p50_ns = v;
+        if (seen < r99 && seen + c >= r99)
+            sum.p99_ns = v;
+        if (seen < r999 && seen + c >= r999)
+            sum.p999_ns = v;
+        sum.max_ns = v;
+        seen += c;
+    }
+    return sum;
+}
+
+#endif
@@ -0,0 +1,313 @@
+#ifndef MEAS_CSV_H
+#define MEAS_CSV_H
+
+// Fast CSV tokenizer for the measurement logs, see tools/kpm_csv2bin.c.
+//
+// meas_csv_next() walks the fields of a buffer, typically a mapped file,
+// without copying: 64 bytes at a time are compared against ',' and '\n'
+// with SSE2 (AVX2 when built with -mavx2) into one bit per byte, and the
+// fields are cut at the set bits. Other targets fall back to a byte loop
+// building the same mask. Quoting is not supported, the logs never quote.
+//
+// meas_csv_num() parses a decimal number into an exact mantissa and power
+// of ten, so integers are never routed through a double, and tells a value
+// written in E notation apart. Spreadsheets save 1761591234567890 as
+// 1.76159E+15: ten digits are gone, and the caller can see how many.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define MEAS_CSV_MANT_DIGITS 18  // Always fits an int64_t mantissa
+#define MEAS_CSV_PAD 16          // Readable bytes meas_csv_num() needs past a buffer
+
+// Bit i set when p[i] is ',' or '\n'
+static inline uint64_t meas_csv_mask64(char const* p) {
+#if defined(__AVX2__)
+    __m256i const comma = _mm256_set1_epi8(',');
+    __m256i const nl = _mm256_set1_epi8('\n');
+    __m256i const a = _mm256_loadu_si256((__m256i const*)p);
+    __m256i const b = _mm256_loadu_si256((__m256i const*)(p + 32));
+    uint32_t const ma = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(a, comma), _mm256_cmpeq_epi8(a, nl)));
+    uint32_t const mb = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(b, comma), _mm256_cmpeq_epi8(b, nl)));
+    return (uint64_t)ma | (uint64_t)mb << 32;
+#elif defined(__SSE2__)
+    __m128i const comma = _mm_set1_epi8(',');
+    __m128i const nl = _mm_set1_epi8('\n');
+    uint64_t m = 0;
+    for (int k = 0; k < 4; k++) {
+        __m128i const v = _mm_loadu_si128((__m128i const*)(p + 16 * k));
+        m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, nl))) << (16 * k);
+    }
+    return m;
+#else
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i++)
+        m |= (uint64_t)(p[i] == ',' || p[i] == '\n') << i;
+    return m;
+#endif
+}
+
+// Bit i set when p[i] is '\n'
+static inline uint64_t meas_csv_nl_mask64(char const* p) {
+#if defined(__AVX2__)
+    __m256i const nl = _mm256_set1_epi8('\n');
+    uint32_t const ma = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)p), nl));
+    uint32_t const mb = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(p + 32)), nl));
+    return (uint64_t)ma | (uint64_t)mb << 32;
+#elif defined(__SSE2__)
+    __m128i const nl = _mm_set1_epi8('\n');
+    uint64_t m = 0;
+    for (int k = 0; k < 4; k++)
+        m |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i const*)(p + 16 * k)), nl)) << (16 * k);
+    return m;
+#else
+    uint64_t m = 0;
+    for (int i = 0; i < 64; i++)
+        m |= (uint64_t)(p[i] == '\n') << i;
+    return m;
+#endif
+}
+
+// Lines in buf, counting a last one without '\n'
+static inline size_t meas_csv_count_lines(char const* buf, size_t len) {
+    size_t n = 0, i = 0;
+    for (; i + 64 <= len; i += 64)
+        n += (size_t)__builtin_popcountll(meas_csv_nl_mask64(buf + i));
+    for (; i < len; i++)
+        n += buf[i] == '\n';
+    return n + (len > 0 && buf[len - 1] != '\n');
+}
+
+typedef struct {
+    char const* buf;
+    size_t len;
+    size_t blk;     // Offset of the block mask covers
+    uint64_t mask;  // Separators at or after pos left in the block
+    size_t pos;     // Start of the next field
+} meas_csv_t;
+
+static inline void meas_csv_load(meas_csv_t* cs) {
+    if (cs->blk + 64 <= cs->len) {
+        cs->mask = meas_csv_mask64(cs->buf + cs->blk);
+        return;
+    }
+    // Tail shorter than a block
+    char tail[64] = {0};
+    memcpy(tail, cs->buf + cs->blk, cs->len - cs->blk);
+    cs->mask = meas_csv_mask64(tail) & ((UINT64_C(1) << (cs->len - cs->blk)) - 1);
+}
+
+static inline void meas_csv_init(meas_csv_t* cs, char const* buf, size_t len) {
+    memset(cs, 0, sizeof(*cs));
+    cs->buf = buf;
+    cs->len = len;
+    if (len > 0)
+        meas_csv_load(cs);
+}
+
+// Next field of buf, without the '\r' of a CRLF line end. *eol is set when
+// the field ends its line. False at the end of buf.
+static inline bool meas_csv_next(meas_csv_t* cs, char const** field, size_t* len, bool* eol) {
+    if (cs->pos >= cs->len)
+        return false;
+    while (cs->mask == 0 && cs->blk + 64 < cs->len) {
+        cs->blk += 64;
+        meas_csv_load(cs);
+    }
+    size_t end = cs->len;  // Last field without a line end
+    if (cs->mask != 0) {
+        end = cs->blk + (size_t)__builtin_ctzll(cs->mask);
+        cs->mask &= cs->mask - 1;
+    }
+    *field = cs->buf + cs->pos;
+    *len = end - cs->pos;
+    *eol = end == cs->len || cs->buf[end] == '\n';
+    if (*eol && *len > 0 && (*field)[*len - 1] == '\r')
+        (*len)--;
+    cs->pos = end + 1;
+    return true;
+}
+
+/////////////////////////////
+// Numbers
+/////////////////////////////
+
+// value = mant * 10^exp10, negated when neg
+typedef struct {
+    int64_t mant;
+    int exp10;
+    bool neg;
+    bool sci;  // Written with an exponent
+} meas_csv_num_t;
+
+static int64_t const meas_csv_pow10_i64[19] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000, 10000000000, 100000000000,
+    1000000000000, 10000000000000, 100000000000000, 1000000000000000, 10000000000000000, 100000000000000000,
+    1000000000000000000,
+};
+
+// Any form meas_csv_num() accepts
+static inline bool meas_csv_num_slow(char const* p, size_t len, meas_csv_num_t* n) {
+    char const* end = p + len;
+    memset(n, 0, sizeof(*n));
+    while (p < end && *p == ' ')
+        p++;
+    while (end > p && end[-1] == ' ')
+        end--;
+    if (p < end && (*p == '-' || *p == '+'))
+        n->neg = *p++ == '-';
+    int digits = 0, frac = 0, dropped = 0;
+    bool any = false, dot = false;
+    for (; p < end; p++) {
+        unsigned const d = (unsigned)(*p - '0');
+        if (d <= 9) {
+            any = true;
+            if (digits < MEAS_CSV_MANT_DIGITS) {
+                if (n->mant != 0 || d != 0)
+                    digits++;
+                n->mant = n->mant * 10 + d;
+                frac += dot;
+            } else {
+                dropped += !dot;
+            }
+        } else if (*p == '.' && !dot) {
+            dot = true;
+        } else {
+            break;
+        }
+    }
+    if (!any)
+        return false;
+    n->exp10 = dropped - frac;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool eneg = false;
+        if (p < end && (*p == '-' || *p == '+'))
+            eneg = *p++ == '-';
+        if (p == end)
+            return false;
+        int e = 0;
+        for (; p < end && (unsigned)(*p - '0') <= 9; p++)
+            e = e < 10000 ? e * 10 + (*p - '0') : e;
+        n->exp10 += eneg ? -e : e;
+        n->sci = true;
+    }
+    return p == end;
+}
+
+// The n <= 8 ASCII digits at the start of w (little endian) as a number,
+// or -1 when one of them is not a digit
+static inline int64_t meas_csv_swar8(uint64_t w, size_t n) {
+    if (n == 0)
+        return 0;
+    // Digits to the top bytes, zeros below read as leading zeros
+    w <<= 8 * (8 - n);
+    uint64_t const want = UINT64_C(0x3030303030303030) & (~UINT64_C(0) << 8 * (8 - n));
+    if ((w & UINT64_C(0xF0F0F0F0F0F0F0F0)) != want || ((w + UINT64_C(0x0606060606060606)) & UINT64_C(0xF0F0F0F0F0F0F0F0)) != want)
+        return -1;
+    w = (w & UINT64_C(0x0F0F0F0F0F0F0F0F)) * 2561 >> 8;
+    w = (w & UINT64_C(0x00FF00FF00FF00FF)) * 6553601 >> 16;
+    return (int64_t)((w & UINT64_C(0x0000FFFF0000FFFF)) * UINT64_C(42949672960001) >> 32);
+}
+
+static inline uint64_t meas_csv_load64(char const* p) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+// The n <= 16 digits at p, -1 when one is not a digit
+static inline int64_t meas_csv_digits(char const* p, size_t n) {
+    if (n <= 8)
+        return meas_csv_swar8(meas_csv_load64(p), n);
+    int64_t const hi = meas_csv_swar8(meas_csv_load64(p), n - 8);
+    int64_t const lo = meas_csv_swar8(meas_csv_load64(p + n - 8), 8);
+    return hi < 0 || lo < 0 ? -1 : hi * 100000000 + lo;
+}
+
+// Offset of the first '.' in the 8 bytes of w, 8 without
+static inline size_t meas_csv_dot8(uint64_t w) {
+    uint64_t const x = w ^ UINT64_C(0x2E2E2E2E2E2E2E2E);
+    uint64_t const z = (x - UINT64_C(0x0101010101010101)) & ~x & UINT64_C(0x8080808080808080);
+    return z != 0 ? (size_t)__builtin_ctzll(z) / 8 : 8;
+}
+
+// False when p is empty or not a plain decimal ("12", "-3.5", "1.76159E+15").
+// Digits past MEAS_CSV_MANT_DIGITS are dropped. Reads up to MEAS_CSV_PAD
+// bytes past p + len.
+static inline bool meas_csv_num(char const* p, size_t len, meas_csv_num_t* n) {
+    // Most fields are a short [-]digits[.digits]: eight digits at a time
+    bool const neg = len > 0 && *p == '-';
+    char const* const q = p + neg;
+    size_t const l = len - neg;
+    if (l > 0 && l <= 16) {
+        size_t dot = meas_csv_dot8(meas_csv_load64(q));
+        if (dot == 8)
+            dot = 8 + meas_csv_dot8(meas_csv_load64(q + 8));
+        dot = dot < l ? dot : l;
+        size_t const frac = dot < l ? l - dot - 1 : 0;
+        if (dot + frac > 0) {
+            int64_t const ip = meas_csv_digits(q, dot);
+            int64_t const fp = meas_csv_digits(q + dot + 1, frac);
+            if (ip >= 0 && fp >= 0) {
+                n->mant = ip * meas_csv_pow10_i64[frac] + fp;
+                n->exp10 = -(int)frac;
+                n->neg = neg;
+                n->sci = false;
+                return true;
+            }
+        }
+    }
+    return meas_csv_num_slow(p, len, n);
+}
+
+// n * 10^scale as an integer, the fraction truncated like a C cast. False
+// when it does not fit an int64_t.
+static inline bool meas_csv_num_i64(meas_csv_num_t const* n, int scale, int64_t* v) {
+    int const e = n->exp10 + scale;
+    int64_t m = n->mant;
+    if (e >= 0) {
+        if (m != 0 && (e > 18 || m > INT64_MAX / meas_csv_pow10_i64[e]))
+            return false;
+        m *= meas_csv_pow10_i64[m != 0 ? e : 0];
+    } else {
+        m = -e > 18 ? 0 : m / meas_csv_pow10_i64[-e];
+    }
+    *v = n->neg ? -m : m;
+    return true;
+}
+
+// Digits of n * 10^scale that E notation left out: the true value is within
+// half of 10^lost of the parsed one
+static inline int meas_csv_num_lost(meas_csv_num_t const* n, int scale) {
+    int const e = n->exp10 + scale;
+    return n->sci && n->mant != 0 && e > 0 ? e : 0;
+}
+
+// n as a double, rounded like strtod()
+static inline double meas_csv_num_f64(meas_csv_num_t const* n, char const* p, size_t len) {
+    static double const pow10_f64[23] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                         1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    // Exact operands give one correctly rounded operation
+    if (n->mant < (INT64_C(1) << 53) && n->exp10 >= -22 && n->exp10 <= 22) {
+        double const m = (double)n->mant;
+        double const v = n->exp10 >= 0 ? m * pow10_f64[n->exp10] : m / pow10_f64[-n->exp10];
+        return n->neg ? -v : v;
+    }
+    char tmp[64];
+    len = len < sizeof(tmp) - 1 ? len : sizeof(tmp) - 1;
+    memcpy(tmp, p, len);
+    tmp[len] = '\0';
+    return strtod(tmp, NULL);
+}
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MEAS_ROW_H
+#define MEAS_ROW_H
+
+// One measurement row: one UE in one indication. The column list below is
+// the single definition of the row layout, the CSV header and the binary
+// column table, so the xApps, the sinks and the offline tools cannot drift.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    MEAS_COL_I32 = 1,
+    MEAS_COL_I64 = 2,
+    MEAS_COL_U64 = 3,
+    MEAS_COL_F32 = 4,
+} meas_col_e;
+
+// X(name, C type, column type)
+#define MEAS_ROW_COLUMNS(X)                     \
+    X(timestamp, int64_t, MEAS_COL_I64)         \
+    X(indication_counter, int32_t, MEAS_COL_I32) \
+    X(latency_us, int64_t, MEAS_COL_I64)        \
+    X(ue_ngap_id, uint64_t, MEAS_COL_U64)       \
+    X(ue_ran_ue_id, uint64_t, MEAS_COL_U64)     \
+    X(ue_prb_dl, int32_t, MEAS_COL_I32)         \
+    X(ue_prb_ul, int32_t, MEAS_COL_I32)         \
+    X(ue_pdcp_dl_kb, int32_t, MEAS_COL_I32)     \
+    X(ue_pdcp_ul_kb, int32_t, MEAS_COL_I32)     \
+    X(ue_delay_us, float, MEAS_COL_F32)         \
+    X(ue_thp_dl_kbps, float, MEAS_COL_F32)      \
+    X(ue_thp_ul_kbps, float, MEAS_COL_F32)      \
+    X(ue_is_burst, int32_t, MEAS_COL_I32)       \
+    X(ue_prb_allocation, int32_t, MEAS_COL_I32) \
+    X(rc_drb_id, int32_t, MEAS_COL_I32)         \
+    X(rc_qfi, int32_t, MEAS_COL_I32)            \
+    X(rc_mapping_ind, int32_t, MEAS_COL_I32)    \
+    X(burst_to_ctrl_us, int64_t, MEAS_COL_I64)  \
+    X(report_period_ms, int32_t, MEAS_COL_I32)
+
+// The monitoring-only xApp logs the leading KPM columns, up to ue_thp_ul_kbps
+#define MEAS_KPM_COLS 12
+
+#define MEAS_ROW_FIELD(name, ctype, coltype) ctype name;
+typedef struct {
+    MEAS_ROW_COLUMNS(MEAS_ROW_FIELD)
+} meas_row_t;
+#undef MEAS_ROW_FIELD
+
+typedef struct {
+    char const* name;
+    meas_col_e type;
+    size_t offset;
+    size_t width;
+} meas_col_t;
+
+#define MEAS_COL_DESC(name, ctype, coltype) {#name, coltype, offsetof(meas_row_t, name), sizeof(ctype)},
+static meas_col_t const meas_cols[] = {
+    MEAS_ROW_COLUMNS(MEAS_COL_DESC)
+};
+#undef MEAS_COL_DESC
+
+#define MEAS_NUM_COLS (sizeof(meas_cols) / sizeof(meas_cols[0]))
+
+static inline size_t meas_col_width(meas_col_e type) {
+    return (type == MEAS_COL_I32 || type == MEAS_COL_F32) ? 4 : 8;
+}
+
+// Prints one value the way the xApps always wrote it to CSV
+static inline void meas_col_fprint(FILE* f, meas_col_e type, void const* val) {
+    switch (type) {
+        case MEAS_COL_I32:
+            fprintf(f, "%d", *(int32_t const*)val);
+            break;
+        case MEAS_COL_I64:
+            fprintf(f, "%ld", (long)*(int64_t const*)val);
+            break;
+        case MEAS_COL_U64:
+            fprintf(f, "%lu", (unsigned long)*(uint64_t const*)val);
+            break;
+        case MEAS_COL_F32:
+            fprintf(f, "%.2f", *(float const*)val);
+            break;
+    }
+}
+
+#endif
@@ -0,0 +1,486 @@
+#ifndef MEAS_SINK_H
+#define MEAS_SINK_H
+
+// Measurement sinks and the asynchronous writer in front of them.
+//
+// sm_cb_kpm only copies meas_row_t records into an SPSC ring
+// (meas_writer_push) and wakes the writer thread once per indication
+// (meas_writer_commit). The writer thread drains the ring in batches into
+// a pluggable sink:
+//
+//  - bin: fixed-width columnar blocks, fsync'ed every fsync_ms. This is the
+//    default. tools/kpm_bin2csv.c exports it to the familiar CSV.
+//  - csv: the historical text format, for quick looks at a live run.
+//  - tsdb: a directory of memory-mapped column files with a time index and
+//    1s/10s/1m rollups, for range queries over long runs, see meas_tsdb.h
+//    and tools/kpm_query.c.
+//
+// Binary layout (host byte order):
+//   meas_bin_hdr_t
+//   meas_bin_col_t[num_cols]
+//   blocks: meas_bin_blk_t, then for each column rows * width bytes
+// A block is written with a single write(2). A crash can only leave a
+// truncated last block, which readers ignore.
+//
+// The sinks and the writer log through xlog.h. The reader, used by the
+// tools, reports to stderr.
+
+#include "event_queue.h"
+#include "meas_row.h"
+#include "meas_tsdb.h"
+#include "xlog.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MEAS_BIN_MAGIC "KPMB"
+#define MEAS_BIN_BLK_MAGIC "BLK1"
+#define MEAS_BIN_VERSION 1
+#define MEAS_BIN_COL_NAME_LEN 32
+
+#define MEAS_SINK_RING_ROWS (1 << 16)
+#define MEAS_SINK_BATCH_ROWS 4096
+#define MEAS_SINK_FSYNC_MS 1000
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_cols;
+    uint32_t reserved;
+} meas_bin_hdr_t;
+
+typedef struct {
+    char name[MEAS_BIN_COL_NAME_LEN];
+    uint32_t type;  // meas_col_e
+    uint32_t width;
+} meas_bin_col_t;
+
+typedef struct {
+    char magic[4];
+    uint32_t rows;
+} meas_bin_blk_t;
+
+typedef struct meas_sink_s meas_sink_t;
+
+struct meas_sink_s {
+    char const* name;
+    void (*write)(meas_sink_t* s, meas_row_t const* rows, size_t n);
+    void (*flush)(meas_sink_t* s, bool durable);
+    void (*close)(meas_sink_t* s);
+};
+
+/////////////////////////////
+// CSV sink
+/////////////////////////////
+
+typedef struct {
+    meas_sink_t base;
+    FILE* f;
+    size_t num_cols;
+} meas_sink_csv_t;
+
+static void meas_sink_csv_write(meas_sink_t* s, meas_row_t const* rows, size_t n) {
+    meas_sink_csv_t* csv = (meas_sink_csv_t*)s;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t c = 0; c < csv->num_cols; c++) {
+            if (c > 0)
+                fputc(',', csv->f);
+            meas_col_fprint(csv->f, meas_cols[c].type, (uint8_t const*)&rows[i] + meas_cols[c].offset);
+        }
+        fputc('\n', csv->f);
+    }
+}
+
+static void meas_sink_csv_flush(meas_sink_t* s, bool durable) {
+    meas_sink_csv_t* csv = (meas_sink_csv_t*)s;
+    fflush(csv->f);
+    if (durable)
+        fsync(fileno(csv->f));
+}
+
+static void meas_sink_csv_close(meas_sink_t* s) {
+    meas_sink_csv_t* csv = (meas_sink_csv_t*)s;
+    fflush(csv->f);
+    fclose(csv->f);
+    free(csv);
+}
+
+// Logs the first num_cols columns of every row
+static meas_sink_t* meas_sink_csv_open(char const* path, size_t num_cols) {
+    assert(num_cols > 0 && num_cols <= MEAS_NUM_COLS);
+    FILE* f = fopen(path, "w");
+    if (f == NULL) {
+        XLOG_ERROR("[SINK]: Cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    for (size_t c = 0; c < num_cols; c++)
+        fprintf(f, "%s%s", c > 0 ? "," : "", meas_cols[c].name);
+    fputc('\n', f);
+    fflush(f);
+
+    meas_sink_csv_t* csv = calloc(1, sizeof(meas_sink_csv_t));
+    assert(csv != NULL && "Memory exhausted");
+    csv->base = (meas_sink_t){"csv", meas_sink_csv_write, meas_sink_csv_flush, meas_sink_csv_close};
+    csv->f = f;
+    csv->num_cols = num_cols;
+    return &csv->base;
+}
+
+/////////////////////////////
+// Binary columnar sink
+/////////////////////////////
+
+typedef struct {
+    meas_sink_t base;
+    int fd;
+    bool failed;
+    uint8_t* blk;  // One block, MEAS_SINK_BATCH_ROWS rows at most
+} meas_sink_bin_t;
+
+static bool meas_write_all(int fd, void const* buf, size_t len) {
+    uint8_t const* p = buf;
+    while (len > 0) {
+        ssize_t const n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void meas_sink_bin_write(meas_sink_t* s, meas_row_t const* rows, size_t n) {
+    meas_sink_bin_t* bin = (meas_sink_bin_t*)s;
+    while (n > 0 && !bin->failed) {
+        size_t const cnt = n < MEAS_SINK_BATCH_ROWS ? n : MEAS_SINK_BATCH_ROWS;
+
+        meas_bin_blk_t blk_hdr = {.rows = (uint32_t)cnt};
+        memcpy(blk_hdr.magic, MEAS_BIN_BLK_MAGIC, 4);
+        uint8_t* p = bin->blk;
+        memcpy(p, &blk_hdr, sizeof(blk_hdr));
+        p += sizeof(blk_hdr);
+
+        // Rows to columns
+        for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+            size_t const off = meas_cols[c].offset;
+            size_t const w = meas_cols[c].width;
+            for (size_t i = 0; i < cnt; i++, p += w)
+                memcpy(p, (uint8_t const*)&rows[i] + off, w);
+        }
+
+        if (!meas_write_all(bin->fd, bin->blk, (size_t)(p - bin->blk))) {
+            XLOG_ERROR("[SINK]: Binary measurement write failed: %s\n", strerror(errno));
+            bin->failed = true;
+        }
+        rows += cnt;
+        n -= cnt;
+    }
+}
+
+static void meas_sink_bin_flush(meas_sink_t* s, bool durable) {
+    meas_sink_bin_t* bin = (meas_sink_bin_t*)s;
+    if (durable && !bin->failed)
+        fdatasync(bin->fd);
+}
+
+static void meas_sink_bin_close(meas_sink_t* s) {
+    meas_sink_bin_t* bin = (meas_sink_bin_t*)s;
+    fdatasync(bin->fd);
+    close(bin->fd);
+    free(bin->blk);
+    free(bin);
+}
+
+static meas_sink_t* meas_sink_bin_open(char const* path) {
+    int const fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        XLOG_ERROR("[SINK]: Cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+
+    meas_bin_hdr_t hdr = {.version = MEAS_BIN_VERSION, .num_cols = MEAS_NUM_COLS};
+    memcpy(hdr.magic, MEAS_BIN_MAGIC, 4);
+    meas_bin_col_t cols[MEAS_NUM_COLS];
+    memset(cols, 0, sizeof(cols));
+    for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+        strncpy(cols[c].name, meas_cols[c].name, MEAS_BIN_COL_NAME_LEN - 1);
+        cols[c].type = meas_cols[c].type;
+        cols[c].width = (uint32_t)meas_cols[c].width;
+    }
+    if (!meas_write_all(fd, &hdr, sizeof(hdr)) || !meas_write_all(fd, cols, sizeof(cols))) {
+        XLOG_ERROR("[SINK]: Cannot write the header of %s: %s\n", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    meas_sink_bin_t* bin = calloc(1, sizeof(meas_sink_bin_t));
+    assert(bin != NULL && "Memory exhausted");
+    bin->base = (meas_sink_t){"bin", meas_sink_bin_write, meas_sink_bin_flush, meas_sink_bin_close};
+    bin->fd = fd;
+    bin->blk = malloc(sizeof(meas_bin_blk_t) + MEAS_SINK_BATCH_ROWS * sizeof(meas_row_t));
+    assert(bin->blk != NULL && "Memory exhausted");
+    return &bin->base;
+}
+
+/////////////////////////////
+// Memory-mapped columnar store
+/////////////////////////////
+
+typedef struct {
+    meas_sink_t base;
+    meas_tsdb_t db;
+} meas_sink_tsdb_t;
+
+static void meas_sink_tsdb_write(meas_sink_t* s, meas_row_t const* rows, size_t n) {
+    meas_tsdb_append(&((meas_sink_tsdb_t*)s)->db, rows, n);
+}
+
+// Appended rows are visible to readers at once, durable only on sync
+static void meas_sink_tsdb_flush(meas_sink_t* s, bool durable) {
+    if (durable)
+        meas_tsdb_sync(&((meas_sink_tsdb_t*)s)->db);
+}
+
+static void meas_sink_tsdb_close(meas_sink_t* s) {
+    meas_sink_tsdb_t* ts = (meas_sink_tsdb_t*)s;
+    meas_tsdb_close(&ts->db);
+    free(ts);
+}
+
+static meas_sink_t* meas_sink_tsdb_open(char const* dir) {
+    meas_sink_tsdb_t* ts = calloc(1, sizeof(meas_sink_tsdb_t));
+    assert(ts != NULL && "Memory exhausted");
+    if (!meas_tsdb_create(&ts->db, dir)) {
+        XLOG_ERROR("[SINK]: Cannot create the measurement store %s\n", dir);
+        meas_tsdb_close(&ts->db);
+        free(ts);
+        return NULL;
+    }
+    ts->base = (meas_sink_t){"tsdb", meas_sink_tsdb_write, meas_sink_tsdb_flush, meas_sink_tsdb_close};
+    return &ts->base;
+}
+
+// fmt "csv" selects the CSV sink, "tsdb" the columnar store, anything else
+// the binary one (the sink key of xapp_cfg_t). base_path gets a .csv, .tsdb
+// or .kpmb extension.
+static inline meas_sink_t* meas_sink_open(char const* base_path, char const* fmt, size_t csv_cols) {
+    bool const csv = strcmp(fmt, "csv") == 0;
+    bool const tsdb = strcmp(fmt, "tsdb") == 0;
+    char path[512];
+    snprintf(path, sizeof(path), "%s.%s", base_path, csv ? "csv" : tsdb ? "tsdb" : "kpmb");
+    meas_sink_t* s = csv ? meas_sink_csv_open(path, csv_cols) : tsdb ? meas_sink_tsdb_open(path) : meas_sink_bin_open(path);
+    if (s != NULL)
+        XLOG_INFO("[SINK]: Writing measurements to %s (%s)\n", path, s->name);
+    return s;
+}
+
+/////////////////////////////
+// Binary reader
+/////////////////////////////
+
+// Reads back a file block by block. The column table comes from the file,
+// so files written with an older row layout remain readable.
+typedef struct {
+    FILE* f;
+    meas_bin_hdr_t hdr;
+    meas_bin_col_t* cols;
+    size_t* col_off;  // Start of each column in blk
+    size_t row_width;
+    uint8_t* blk;
+    size_t blk_cap;
+    uint32_t rows;  // In the current block
+} meas_bin_reader_t;
+
+static inline bool meas_bin_reader_open(meas_bin_reader_t* r, char const* path) {
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(path, "rb");
+    if (r->f == NULL) {
+        perror(path);
+        return false;
+    }
+    if (fread(&r->hdr, sizeof(r->hdr), 1, r->f) != 1 || memcmp(r->hdr.magic, MEAS_BIN_MAGIC, 4) != 0) {
+        fprintf(stderr, "[SINK]: %s is not a measurement file\n", path);
+        goto fail;
+    }
+    if (r->hdr.version != MEAS_BIN_VERSION || r->hdr.num_cols == 0 || r->hdr.num_cols > 1024) {
+        fprintf(stderr, "[SINK]: Unsupported version %u with %u columns\n", r->hdr.version, r->hdr.num_cols);
+        goto fail;
+    }
+    r->cols = calloc(r->hdr.num_cols, sizeof(meas_bin_col_t));
+    r->col_off = calloc(r->hdr.num_cols, sizeof(size_t));
+    assert(r->cols != NULL && r->col_off != NULL && "Memory exhausted");
+    if (fread(r->cols, sizeof(meas_bin_col_t), r->hdr.num_cols, r->f) != r->hdr.num_cols) {
+        fprintf(stderr, "[SINK]: Truncated column table\n");
+        goto fail;
+    }
+    for (uint32_t c = 0; c < r->hdr.num_cols; c++) {
+        r->cols[c].name[MEAS_BIN_COL_NAME_LEN - 1] = '\0';
+        if (r->cols[c].width != meas_col_width((meas_col_e)r->cols[c].type)) {
+            fprintf(stderr, "[SINK]: Column %s has an unknown type %u\n", r->cols[c].name, r->cols[c].type);
+            goto fail;
+        }
+        r->row_width += r->cols[c].width;
+    }
+    return true;
+
+fail:
+    fclose(r->f);
+    free(r->cols);
+    free(r->col_off);
+    memset(r, 0, sizeof(*r));
+    return false;
+}
+
+// Loads the next block. Returns false at the end of the file, or at a
+// corrupt or truncated block, which can only be the last one.
+static inline bool meas_bin_reader_next(meas_bin_reader_t* r) {
+    meas_bin_blk_t blk_hdr;
+    if (fread(&blk_hdr, sizeof(blk_hdr), 1, r->f) != 1)
+        return false;
+    if (memcmp(blk_hdr.magic, MEAS_BIN_BLK_MAGIC, 4) != 0) {
+        fprintf(stderr, "[SINK]: Corrupt block, stopping\n");
+        return false;
+    }
+    size_t const sz = (size_t)blk_hdr.rows * r->row_width;
+    if (sz > r->blk_cap) {
+        r->blk = realloc(r->blk, sz);
+        assert(r->blk != NULL && "Memory exhausted");
+        r->blk_cap = sz;
+    }
+    if (fread(r->blk, 1, sz, r->f) != sz) {
+        fprintf(stderr, "[SINK]: Truncated last block ignored\n");
+        return false;
+    }
+    size_t off = 0;
+    for (uint32_t c = 0; c < r->hdr.num_cols; c++) {
+        r->col_off[c] = off;
+        off += (size_t)blk_hdr.rows * r->cols[c].width;
+    }
+    r->rows = blk_hdr.rows;
+    return true;
+}
+
+// Value of column c in row i of the current block
+static inline void const* meas_bin_reader_val(meas_bin_reader_t const* r, uint32_t c, uint32_t i) {
+    return r->blk + r->col_off[c] + (size_t)i * r->cols[c].width;
+}
+
+static inline void meas_bin_reader_close(meas_bin_reader_t* r) {
+    if (r->f != NULL)
+        fclose(r->f);
+    free(r->cols);
+    free(r->col_off);
+    free(r->blk);
+    memset(r, 0, sizeof(*r));
+}
+
+/////////////////////////////
+// Asynchronous writer
+/////////////////////////////
+
+typedef struct {
+    event_queue_t q;  // meas_row_t, one producer (sm_cb_kpm)
+    meas_sink_t* sink;
+    int fsync_ms;
+    atomic_bool stop;
+    pthread_t thread;
+    meas_row_t* batch;
+} meas_writer_t;
+
+static int64_t meas_mono_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static size_t meas_writer_drain(meas_writer_t* w) {
+    size_t total = 0;
+    for (;;) {
+        size_t n = 0;
+        while (n < MEAS_SINK_BATCH_ROWS && spsc_ring_pop_into(&w->q.ring, &w->batch[n]))
+            n++;
+        if (n == 0)
+            return total;
+        w->sink->write(w->sink, w->batch, n);
+        total += n;
+    }
+}
+
+static void* meas_writer_thread(void* arg) {
+    meas_writer_t* w = arg;
+    int64_t last_sync = meas_mono_ms();
+    size_t reported_drops = 0;
+    for (;;) {
+        event_queue_wait(&w->q, w->fsync_ms);
+        bool const stopping = atomic_load(&w->stop);
+        if (meas_writer_drain(w) > 0)
+            w->sink->flush(w->sink, false);
+
+        int64_t const now = meas_mono_ms();
+        if (now - last_sync >= w->fsync_ms) {
+            w->sink->flush(w->sink, true);
+            last_sync = now;
+            size_t const drops = atomic_load(&w->q.dropped);
+            if (drops != reported_drops) {
+                XLOG_WARN("[SINK]: %zu rows dropped, writer cannot keep up\n", drops - reported_drops);
+                reported_drops = drops;
+            }
+        }
+        if (stopping)
+            break;
+    }
+    meas_writer_drain(w);
+    return NULL;
+}
+
+// Takes ownership of sink. A NULL sink turns every push into a no-op.
+static inline void meas_writer_start(meas_writer_t* w, meas_sink_t* sink) {
+    memset(w, 0, sizeof(*w));
+    w->sink = sink;
+    if (sink == NULL)
+        return;
+    w->fsync_ms = MEAS_SINK_FSYNC_MS;
+    event_queue_init(&w->q, sizeof(meas_row_t), MEAS_SINK_RING_ROWS);
+    atomic_init(&w->stop, false);
+    w->batch = malloc(MEAS_SINK_BATCH_ROWS * sizeof(meas_row_t));
+    assert(w->batch != NULL && "Memory exhausted");
+    int const rc = pthread_create(&w->thread, NULL, meas_writer_thread, w);
+    assert(rc == 0);
+}
+
+// Producer side. Never blocks: drops the row, and counts it, when full.
+static inline void meas_writer_push(meas_writer_t* w, meas_row_t const* row) {
+    if (w->sink != NULL)
+        event_queue_push(&w->q, row);
+}
+
+// Producer side, once per indication
+static inline void meas_writer_commit(meas_writer_t* w) {
+    if (w->sink != NULL)
+        event_queue_notify(&w->q);
+}
+
+static inline void meas_writer_stop(meas_writer_t* w) {
+    if (w->sink == NULL)
+        return;
+    atomic_store(&w->stop, true);
+    event_queue_notify(&w->q);
+    pthread_join(w->thread, NULL);
+    w->sink->close(w->sink);
+    w->sink = NULL;
+    event_queue_free(&w->q);
+    free(w->batch);
+}
+
+#endif
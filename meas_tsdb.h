@@ -0,0 +1,594 @@
+#ifndef MEAS_TSDB_H
+#define MEAS_TSDB_H
+
+// Memory-mapped columnar store of the measurement rows, for range queries
+// over runs of several days.
+//
+// A store is a directory with one table of the raw rows and one per rollup
+// resolution (1s, 10s, 1m):
+//
+//   kpm_rc_monitoring.tsdb/raw/   timestamp.col  ue_ran_ue_id.col  ...
+//   kpm_rc_monitoring.tsdb/1s/    bucket_ts.col  ue_thp_ul_kbps_mean.col  ...
+//
+// Every column is its own file of fixed-width values in host byte order,
+// row i at offset i * width. The first column is the int64_t time of the
+// row. time.idx holds the [min, max] time of every MEAS_TSDB_STRIDE rows,
+// so a scan only touches the strides that overlap its window; rows need
+// not be sorted. table.meta holds the column table and the committed row
+// count, stored after the values it covers: a reader mapping the files
+// while the xApp writes sees a consistent prefix, and a crash loses at
+// most the rows of the last unsynced batch.
+//
+// Rollups are per UE: samples, and the mean, min and max of every column
+// of MEAS_TSDB_ROLLUP_COLS, in buckets of the resolution. A bucket is
+// written once the UE reports in a later one, or two buckets later when
+// it stopped reporting.
+//
+// One writer (the measurement writer thread, see meas_sink.h); any number
+// of readers, in any process, through meas_tsdb_table_open(). The writer
+// logs through xlog.h, readers to stderr.
+
+#include "meas_row.h"
+#include "ue_table.h"
+#include "xlog.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define MEAS_TSDB_MAGIC "KPMT"
+#define MEAS_TSDB_VERSION 1
+#define MEAS_TSDB_COL_NAME_LEN 32
+#define MEAS_TSDB_PATH_LEN 512
+#define MEAS_TSDB_STRIDE 4096          // Rows per time index entry
+#define MEAS_TSDB_INIT_ROWS (1u << 16)  // Rows a new table reserves
+#define MEAS_TSDB_MAX_COLS 128
+
+// Columns rolled up, all numeric columns of meas_row_t but the IDs
+#define MEAS_TSDB_ROLLUP_COLS(X) \
+    X(latency_us)                \
+    X(ue_prb_dl)                 \
+    X(ue_prb_ul)                 \
+    X(ue_pdcp_dl_kb)             \
+    X(ue_pdcp_ul_kb)             \
+    X(ue_delay_us)               \
+    X(ue_thp_dl_kbps)            \
+    X(ue_thp_ul_kbps)            \
+    X(ue_is_burst)               \
+    X(ue_prb_allocation)         \
+    X(burst_to_ctrl_us)
+
+#define MEAS_TSDB_ROLLUP_ONE(name) +1
+#define MEAS_TSDB_NUM_ROLLUP (0 MEAS_TSDB_ROLLUP_COLS(MEAS_TSDB_ROLLUP_ONE))
+// bucket_ts, ue_ran_ue_id, samples, then mean, min, max of each
+#define MEAS_TSDB_ROLLUP_FIXED 3
+#define MEAS_TSDB_NUM_RES 3
+
+static char const* const meas_tsdb_res_name[MEAS_TSDB_NUM_RES] = {"1s", "10s", "1m"};
+static int64_t const meas_tsdb_res_us[MEAS_TSDB_NUM_RES] = {1000000, 10000000, 60000000};
+
+typedef struct {
+    char name[MEAS_TSDB_COL_NAME_LEN];
+    uint32_t type;  // meas_col_e
+    uint32_t width;
+} meas_tsdb_col_t;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t num_cols;
+    uint32_t stride;
+    _Atomic uint64_t rows;  // Committed
+    meas_tsdb_col_t col[];
+} meas_tsdb_meta_t;
+
+typedef struct {
+    int64_t t_min;
+    int64_t t_max;
+} meas_tsdb_span_t;
+
+typedef struct {
+    char dir[MEAS_TSDB_PATH_LEN];
+    bool writable;
+    bool failed;
+    meas_tsdb_meta_t* meta;
+    size_t meta_sz;
+    uint32_t num_cols;
+    uint64_t rows;    // Writer: appended, committed or not. Reader: mapped.
+    uint64_t cap;     // Rows the files hold
+    uint64_t synced;  // Rows fdatasync'ed
+    int fd[MEAS_TSDB_MAX_COLS];
+    uint8_t* col[MEAS_TSDB_MAX_COLS];
+    int idx_fd;
+    meas_tsdb_span_t* idx;
+} meas_tsdb_table_t;
+
+/////////////////////////////
+// Tables
+/////////////////////////////
+
+static inline int meas_tsdb_open_file(meas_tsdb_table_t const* t, char const* name, int flags) {
+    char path[MEAS_TSDB_PATH_LEN + MEAS_TSDB_COL_NAME_LEN + 8];
+    snprintf(path, sizeof(path), "%s/%s", t->dir, name);
+    int const fd = open(path, flags | O_CLOEXEC, 0644);
+    if (fd < 0 && t->writable)
+        XLOG_ERROR("[TSDB]: %s: %s\n", path, strerror(errno));
+    else if (fd < 0)
+        perror(path);
+    return fd;
+}
+
+static inline void* meas_tsdb_map(int fd, size_t sz, bool writable) {
+    if (sz == 0)
+        return NULL;
+    void* p = mmap(NULL, sz, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+static inline size_t meas_tsdb_idx_len(uint64_t rows) {
+    return (size_t)((rows + MEAS_TSDB_STRIDE - 1) / MEAS_TSDB_STRIDE);
+}
+
+// Values of column c, row i at [i]
+static inline void const* meas_tsdb_col(meas_tsdb_table_t const* t, uint32_t c) {
+    return t->col[c];
+}
+
+static inline int64_t const* meas_tsdb_time(meas_tsdb_table_t const* t) {
+    return (int64_t const*)t->col[0];
+}
+
+// Column index of name, -1 when the table has none
+static inline int meas_tsdb_col_find(meas_tsdb_table_t const* t, char const* name) {
+    for (uint32_t c = 0; c < t->num_cols; c++) {
+        if (strcmp(t->meta->col[c].name, name) == 0)
+            return (int)c;
+    }
+    return -1;
+}
+
+// Writer: room for rows rows. Space is allocated on disk, so a full disk
+// fails here rather than faulting on a store into the map.
+static inline bool meas_tsdb_table_reserve(meas_tsdb_table_t* t, uint64_t rows) {
+    if (rows <= t->cap)
+        return true;
+    uint64_t cap = t->cap == 0 ? MEAS_TSDB_INIT_ROWS : t->cap;
+    while (cap < rows)
+        cap *= 2;
+    for (uint32_t c = 0; c <= t->num_cols; c++) {
+        bool const is_idx = c == t->num_cols;
+        int const fd = is_idx ? t->idx_fd : t->fd[c];
+        size_t const w = is_idx ? sizeof(meas_tsdb_span_t) : t->meta->col[c].width;
+        size_t const old_sz = is_idx ? meas_tsdb_idx_len(t->cap) * w : t->cap * w;
+        size_t const new_sz = is_idx ? meas_tsdb_idx_len(cap) * w : cap * w;
+        int const rc = posix_fallocate(fd, 0, (off_t)new_sz);
+        if (rc != 0) {
+            XLOG_ERROR("[TSDB]: %s: cannot grow to %lu rows: %s\n", t->dir, (unsigned long)cap, strerror(rc));
+            return false;
+        }
+        // The file holds the values, the old map can go first
+        void* old = is_idx ? (void*)t->idx : (void*)t->col[c];
+        if (old != NULL)
+            munmap(old, old_sz);
+        void* p = meas_tsdb_map(fd, new_sz, true);
+        if (is_idx)
+            t->idx = p;
+        else
+            t->col[c] = p;
+        if (p == NULL) {
+            XLOG_ERROR("[TSDB]: %s: mmap: %s\n", t->dir, strerror(errno));
+            return false;
+        }
+    }
+    t->cap = cap;
+    return true;
+}
+
+// Writer: creates the table in dir with cols, column 0 its int64_t time
+static inline bool meas_tsdb_table_create(meas_tsdb_table_t* t, char const* dir, meas_tsdb_col_t const* cols, uint32_t num_cols) {
+    assert(num_cols > 0 && num_cols <= MEAS_TSDB_MAX_COLS);
+    assert(cols[0].type == MEAS_COL_I64);
+    memset(t, 0, sizeof(*t));
+    snprintf(t->dir, sizeof(t->dir), "%s", dir);
+    t->writable = true;
+    t->num_cols = num_cols;
+    t->idx_fd = -1;
+    for (uint32_t c = 0; c < MEAS_TSDB_MAX_COLS; c++)
+        t->fd[c] = -1;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        XLOG_ERROR("[TSDB]: %s: %s\n", dir, strerror(errno));
+        return false;
+    }
+
+    int const meta_fd = meas_tsdb_open_file(t, "table.meta", O_RDWR | O_CREAT | O_TRUNC);
+    if (meta_fd < 0)
+        return false;
+    t->meta_sz = sizeof(meas_tsdb_meta_t) + num_cols * sizeof(meas_tsdb_col_t);
+    if (ftruncate(meta_fd, (off_t)t->meta_sz) != 0 || (t->meta = meas_tsdb_map(meta_fd, t->meta_sz, true)) == NULL) {
+        XLOG_ERROR("[TSDB]: %s/table.meta: %s\n", dir, strerror(errno));
+        close(meta_fd);
+        return false;
+    }
+    close(meta_fd);
+    memcpy(t->meta->magic, MEAS_TSDB_MAGIC, 4);
+    t->meta->version = MEAS_TSDB_VERSION;
+    t->meta->num_cols = num_cols;
+    t->meta->stride = MEAS_TSDB_STRIDE;
+    atomic_store_explicit(&t->meta->rows, 0, memory_order_release);
+    memcpy(t->meta->col, cols, num_cols * sizeof(meas_tsdb_col_t));
+
+    char name[MEAS_TSDB_COL_NAME_LEN + 8];
+    for (uint32_t c = 0; c < num_cols; c++) {
+        snprintf(name, sizeof(name), "%s.col", cols[c].name);
+        if ((t->fd[c] = meas_tsdb_open_file(t, name, O_RDWR | O_CREAT | O_TRUNC)) < 0)
+            return false;
+    }
+    if ((t->idx_fd = meas_tsdb_open_file(t, "time.idx", O_RDWR | O_CREAT | O_TRUNC)) < 0)
+        return false;
+    return meas_tsdb_table_reserve(t, MEAS_TSDB_INIT_ROWS);
+}
+
+// Writer: row n of the next append, written with meas_tsdb_cell()
+static inline void* meas_tsdb_cell(meas_tsdb_table_t* t, uint32_t c, uint64_t row) {
+    return t->col[c] + row * t->meta->col[c].width;
+}
+
+// Writer: room for n more rows at t->rows. False once the table failed.
+static inline bool meas_tsdb_table_grow(meas_tsdb_table_t* t, size_t n) {
+    if (!t->failed && !meas_tsdb_table_reserve(t, t->rows + n))
+        t->failed = true;
+    return !t->failed;
+}
+
+// Writer: indexes the n rows written at t->rows and makes them visible
+static inline void meas_tsdb_table_commit(meas_tsdb_table_t* t, size_t n) {
+    int64_t const* ts = (int64_t const*)t->col[0];
+    for (uint64_t r = t->rows; r < t->rows + n; r++) {
+        meas_tsdb_span_t* sp = &t->idx[r / MEAS_TSDB_STRIDE];
+        if (r % MEAS_TSDB_STRIDE == 0) {
+            sp->t_min = sp->t_max = ts[r];
+        } else {
+            if (ts[r] < sp->t_min)
+                sp->t_min = ts[r];
+            if (ts[r] > sp->t_max)
+                sp->t_max = ts[r];
+        }
+    }
+    t->rows += n;
+    atomic_store_explicit(&t->meta->rows, t->rows, memory_order_release);
+}
+
+static inline void meas_tsdb_msync(void* base, size_t from, size_t to) {
+    long const page = sysconf(_SC_PAGESIZE);
+    size_t const start = from & ~(size_t)(page - 1);
+    if (base != NULL && to > start)
+        msync((uint8_t*)base + start, to - start, MS_SYNC);
+}
+
+// Writer: the committed rows down to disk
+static inline void meas_tsdb_table_sync(meas_tsdb_table_t* t) {
+    if (t->failed || t->synced == t->rows)
+        return;
+    for (uint32_t c = 0; c < t->num_cols; c++) {
+        size_t const w = t->meta->col[c].width;
+        meas_tsdb_msync(t->col[c], t->synced * w, t->rows * w);
+    }
+    meas_tsdb_msync(t->idx, t->synced / MEAS_TSDB_STRIDE * sizeof(meas_tsdb_span_t), meas_tsdb_idx_len(t->rows) * sizeof(meas_tsdb_span_t));
+    msync(t->meta, t->meta_sz, MS_SYNC);
+    t->synced = t->rows;
+}
+
+// Reader: maps the rows committed so far. Reopen to see newer ones.
+static inline bool meas_tsdb_table_open(meas_tsdb_table_t* t, char const* dir) {
+    memset(t, 0, sizeof(*t));
+    snprintf(t->dir, sizeof(t->dir), "%s", dir);
+    t->idx_fd = -1;
+    for (uint32_t c = 0; c < MEAS_TSDB_MAX_COLS; c++)
+        t->fd[c] = -1;
+
+    int const meta_fd = meas_tsdb_open_file(t, "table.meta", O_RDONLY);
+    if (meta_fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(meta_fd, &st) != 0 || (size_t)st.st_size < sizeof(meas_tsdb_meta_t)
+        || (t->meta = meas_tsdb_map(meta_fd, (size_t)st.st_size, false)) == NULL) {
+        fprintf(stderr, "[TSDB]: %s: no table\n", dir);
+        close(meta_fd);
+        return false;
+    }
+    close(meta_fd);
+    t->meta_sz = (size_t)st.st_size;
+    if (memcmp(t->meta->magic, MEAS_TSDB_MAGIC, 4) != 0 || t->meta->version != MEAS_TSDB_VERSION || t->meta->num_cols == 0
+        || t->meta->num_cols > MEAS_TSDB_MAX_COLS || t->meta_sz < sizeof(meas_tsdb_meta_t) + t->meta->num_cols * sizeof(meas_tsdb_col_t)
+        || t->meta->stride != MEAS_TSDB_STRIDE) {
+        fprintf(stderr, "[TSDB]: %s: unsupported table\n", dir);
+        munmap(t->meta, t->meta_sz);
+        return false;
+    }
+    t->num_cols = t->meta->num_cols;
+    t->rows = atomic_load_explicit(&t->meta->rows, memory_order_acquire);
+
+    char name[MEAS_TSDB_COL_NAME_LEN + 8];
+    for (uint32_t c = 0; c < t->num_cols; c++) {
+        meas_tsdb_col_t const* col = &t->meta->col[c];
+        snprintf(name, sizeof(name), "%.*s.col", MEAS_TSDB_COL_NAME_LEN - 1, col->name);
+        if (col->width != meas_col_width((meas_col_e)col->type) || (t->fd[c] = meas_tsdb_open_file(t, name, O_RDONLY)) < 0)
+            return false;
+        if (fstat(t->fd[c], &st) != 0 || (uint64_t)st.st_size < t->rows * col->width) {
+            fprintf(stderr, "[TSDB]: %s is short of its %lu rows\n", name, (unsigned long)t->rows);
+            return false;
+        }
+        t->col[c] = meas_tsdb_map(t->fd[c], t->rows * col->width, false);
+        if (t->rows > 0 && t->col[c] == NULL)
+            return false;
+    }
+    if ((t->idx_fd = meas_tsdb_open_file(t, "time.idx", O_RDONLY)) < 0)
+        return false;
+    t->idx = meas_tsdb_map(t->idx_fd, meas_tsdb_idx_len(t->rows) * sizeof(meas_tsdb_span_t), false);
+    t->cap = t->rows;
+    return t->rows == 0 || t->idx != NULL;
+}
+
+// Writer or reader. A writer trims the files to the committed rows.
+static inline void meas_tsdb_table_close(meas_tsdb_table_t* t) {
+    if (t->dir[0] == '\0')
+        return;  // Never created or opened
+    if (t->writable && t->meta != NULL)
+        meas_tsdb_table_sync(t);
+    for (uint32_t c = 0; c < t->num_cols; c++) {
+        size_t const w = t->meta != NULL ? t->meta->col[c].width : 0;
+        if (t->col[c] != NULL)
+            munmap(t->col[c], (t->writable ? t->cap : t->rows) * w);
+        if (t->fd[c] >= 0) {
+            if (t->writable && ftruncate(t->fd[c], (off_t)(t->rows * w)) != 0)
+                XLOG_ERROR("[TSDB]: %s: ftruncate: %s\n", t->dir, strerror(errno));
+            close(t->fd[c]);
+        }
+    }
+    if (t->idx != NULL)
+        munmap(t->idx, meas_tsdb_idx_len(t->writable ? t->cap : t->rows) * sizeof(meas_tsdb_span_t));
+    if (t->idx_fd >= 0) {
+        if (t->writable && ftruncate(t->idx_fd, (off_t)(meas_tsdb_idx_len(t->rows) * sizeof(meas_tsdb_span_t))) != 0)
+            XLOG_ERROR("[TSDB]: %s: ftruncate: %s\n", t->dir, strerror(errno));
+        close(t->idx_fd);
+    }
+    if (t->meta != NULL)
+        munmap(t->meta, t->meta_sz);
+    memset(t, 0, sizeof(*t));
+}
+
+/////////////////////////////
+// Range scans
+/////////////////////////////
+
+// Rows of a table with a time in [t0, t1], and with key_col equal to key
+// unless key_col is -1. Values are read in place, from the maps.
+typedef struct {
+    meas_tsdb_table_t const* t;
+    int64_t t0;
+    int64_t t1;
+    int key_col;
+    uint64_t key;
+    uint64_t row;
+    uint64_t end;      // Of the current stride
+    uint64_t scanned;  // Rows looked at, for the caller's statistics
+} meas_tsdb_scan_t;
+
+static inline void meas_tsdb_scan_init(meas_tsdb_scan_t* s, meas_tsdb_table_t const* t, int64_t t0, int64_t t1, int key_col, uint64_t key) {
+    assert(key_col < 0 || (t->meta->col[key_col].type == MEAS_COL_U64 || t->meta->col[key_col].type == MEAS_COL_I64));
+    *s = (meas_tsdb_scan_t){.t = t, .t0 = t0, .t1 = t1, .key_col = key_col, .key = key};
+}
+
+// Next matching row, false once there is none
+static inline bool meas_tsdb_scan_next(meas_tsdb_scan_t* s, uint64_t* row) {
+    meas_tsdb_table_t const* t = s->t;
+    int64_t const* ts = meas_tsdb_time(t);
+    uint64_t const* key = s->key_col >= 0 ? (uint64_t const*)t->col[s->key_col] : NULL;
+    for (;;) {
+        if (s->row == s->end) {
+            // Next stride overlapping the window
+            while (s->row < t->rows) {
+                meas_tsdb_span_t const* sp = &t->idx[s->row / MEAS_TSDB_STRIDE];
+                if (sp->t_max >= s->t0 && sp->t_min <= s->t1)
+                    break;
+                s->row += MEAS_TSDB_STRIDE;
+            }
+            if (s->row >= t->rows)
+                return false;
+            s->end = s->row + MEAS_TSDB_STRIDE < t->rows ? s->row + MEAS_TSDB_STRIDE : t->rows;
+        }
+        for (; s->row < s->end; s->row++) {
+            s->scanned++;
+            if (ts[s->row] >= s->t0 && ts[s->row] <= s->t1 && (key == NULL || key[s->row] == s->key)) {
+                *row = s->row++;
+                return true;
+            }
+        }
+    }
+}
+
+/////////////////////////////
+// Store
+/////////////////////////////
+
+typedef struct {
+    int64_t bucket;  // Start time
+    uint32_t n;
+    double sum[MEAS_TSDB_NUM_ROLLUP];
+    float min[MEAS_TSDB_NUM_ROLLUP];
+    float max[MEAS_TSDB_NUM_ROLLUP];
+} meas_tsdb_acc_t;
+
+typedef struct {
+    meas_tsdb_table_t tbl;
+    int64_t res_us;
+    ue_table_t acc;       // meas_tsdb_acc_t by RAN UE ID
+    int64_t last_bucket;  // Newest bucket any row fell into
+} meas_tsdb_rollup_t;
+
+typedef struct {
+    meas_tsdb_table_t raw;
+    meas_tsdb_rollup_t roll[MEAS_TSDB_NUM_RES];
+} meas_tsdb_t;
+
+static inline uint32_t meas_tsdb_rollup_cols(meas_tsdb_col_t* cols) {
+    static char const* const names[MEAS_TSDB_NUM_ROLLUP] = {
+#define MEAS_TSDB_ROLLUP_NAME(name) #name,
+        MEAS_TSDB_ROLLUP_COLS(MEAS_TSDB_ROLLUP_NAME)
+#undef MEAS_TSDB_ROLLUP_NAME
+    };
+    cols[0] = (meas_tsdb_col_t){"bucket_ts", MEAS_COL_I64, 8};
+    cols[1] = (meas_tsdb_col_t){"ue_ran_ue_id", MEAS_COL_U64, 8};
+    cols[2] = (meas_tsdb_col_t){"samples", MEAS_COL_I32, 4};
+    uint32_t n = MEAS_TSDB_ROLLUP_FIXED;
+    char const* const stat[3] = {"mean", "min", "max"};
+    for (size_t m = 0; m < MEAS_TSDB_NUM_ROLLUP; m++) {
+        for (size_t k = 0; k < 3; k++) {
+            cols[n] = (meas_tsdb_col_t){.type = MEAS_COL_F32, .width = 4};
+            snprintf(cols[n].name, MEAS_TSDB_COL_NAME_LEN, "%s_%s", names[m], stat[k]);
+            n++;
+        }
+    }
+    return n;
+}
+
+static inline void meas_tsdb_acc_add(meas_tsdb_acc_t* a, meas_row_t const* r) {
+    size_t m = 0;
+#define MEAS_TSDB_ROLLUP_ADD(name)                       \
+    {                                                    \
+        float const v = (float)r->name;                  \
+        a->sum[m] += (double)r->name;                    \
+        a->min[m] = a->n == 0 || v < a->min[m] ? v : a->min[m]; \
+        a->max[m] = a->n == 0 || v > a->max[m] ? v : a->max[m]; \
+        m++;                                             \
+    }
+    MEAS_TSDB_ROLLUP_COLS(MEAS_TSDB_ROLLUP_ADD)
+#undef MEAS_TSDB_ROLLUP_ADD
+    a->n++;
+}
+
+// Writes out the UE's bucket and starts it over
+static inline void meas_tsdb_rollup_flush(meas_tsdb_rollup_t* ro, uint64_t ue, meas_tsdb_acc_t* a) {
+    meas_tsdb_table_t* t = &ro->tbl;
+    if (a->n > 0 && meas_tsdb_table_grow(t, 1)) {
+        uint64_t const r = t->rows;
+        *(int64_t*)meas_tsdb_cell(t, 0, r) = a->bucket;
+        *(uint64_t*)meas_tsdb_cell(t, 1, r) = ue;
+        *(int32_t*)meas_tsdb_cell(t, 2, r) = (int32_t)a->n;
+        for (uint32_t m = 0; m < MEAS_TSDB_NUM_ROLLUP; m++) {
+            uint32_t const c = MEAS_TSDB_ROLLUP_FIXED + 3 * m;
+            *(float*)meas_tsdb_cell(t, c, r) = (float)(a->sum[m] / a->n);
+            *(float*)meas_tsdb_cell(t, c + 1, r) = a->min[m];
+            *(float*)meas_tsdb_cell(t, c + 2, r) = a->max[m];
+        }
+        meas_tsdb_table_commit(t, 1);
+    }
+    memset(a, 0, sizeof(*a));
+}
+
+static inline void meas_tsdb_rollup_add(meas_tsdb_rollup_t* ro, meas_row_t const* r) {
+    int64_t const bucket = r->timestamp - ((r->timestamp % ro->res_us) + ro->res_us) % ro->res_us;
+    if (bucket > ro->last_bucket) {
+        ro->last_bucket = bucket;
+        // UEs that stopped reporting
+        for (size_t i = 0; i < ue_table_len(&ro->acc);) {
+            meas_tsdb_acc_t* a = ue_table_at(&ro->acc, i);
+            if (a->bucket < bucket - ro->res_us) {
+                uint64_t const ue = ue_table_key_at(&ro->acc, i);
+                meas_tsdb_rollup_flush(ro, ue, a);
+                ue_table_remove(&ro->acc, ue);
+            } else {
+                i++;
+            }
+        }
+    }
+    bool created = false;
+    meas_tsdb_acc_t* a = ue_table_upsert(&ro->acc, r->ue_ran_ue_id, &created);
+    if (created)
+        memset(a, 0, sizeof(*a));
+    if (a->n > 0 && a->bucket != bucket)
+        meas_tsdb_rollup_flush(ro, r->ue_ran_ue_id, a);
+    a->bucket = bucket;
+    meas_tsdb_acc_add(a, r);
+}
+
+// Creates the store in dir, an existing one is overwritten
+static inline bool meas_tsdb_create(meas_tsdb_t* db, char const* dir) {
+    memset(db, 0, sizeof(*db));
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        XLOG_ERROR("[TSDB]: %s: %s\n", dir, strerror(errno));
+        return false;
+    }
+    char path[MEAS_TSDB_PATH_LEN + 8];
+    meas_tsdb_col_t cols[MEAS_TSDB_MAX_COLS];
+    memset(cols, 0, sizeof(cols));
+    for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+        snprintf(cols[c].name, MEAS_TSDB_COL_NAME_LEN, "%s", meas_cols[c].name);
+        cols[c].type = meas_cols[c].type;
+        cols[c].width = (uint32_t)meas_cols[c].width;
+    }
+    snprintf(path, sizeof(path), "%s/raw", dir);
+    if (!meas_tsdb_table_create(&db->raw, path, cols, MEAS_NUM_COLS))
+        return false;
+
+    memset(cols, 0, sizeof(cols));
+    uint32_t const num_cols = meas_tsdb_rollup_cols(cols);
+    for (size_t k = 0; k < MEAS_TSDB_NUM_RES; k++) {
+        meas_tsdb_rollup_t* ro = &db->roll[k];
+        snprintf(path, sizeof(path), "%s/%s", dir, meas_tsdb_res_name[k]);
+        if (!meas_tsdb_table_create(&ro->tbl, path, cols, num_cols))
+            return false;
+        ro->res_us = meas_tsdb_res_us[k];
+        ro->last_bucket = INT64_MIN;
+        ue_table_init(&ro->acc, sizeof(meas_tsdb_acc_t), 64);
+    }
+    return true;
+}
+
+static inline void meas_tsdb_append(meas_tsdb_t* db, meas_row_t const* rows, size_t n) {
+    meas_tsdb_table_t* t = &db->raw;
+    if (meas_tsdb_table_grow(t, n)) {
+        for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+            size_t const off = meas_cols[c].offset;
+            size_t const w = meas_cols[c].width;
+            uint8_t* p = meas_tsdb_cell(t, (uint32_t)c, t->rows);
+            for (size_t i = 0; i < n; i++, p += w)
+                memcpy(p, (uint8_t const*)&rows[i] + off, w);
+        }
+        meas_tsdb_table_commit(t, n);
+    }
+    for (size_t k = 0; k < MEAS_TSDB_NUM_RES; k++) {
+        for (size_t i = 0; i < n; i++)
+            meas_tsdb_rollup_add(&db->roll[k], &rows[i]);
+    }
+}
+
+static inline void meas_tsdb_sync(meas_tsdb_t* db) {
+    meas_tsdb_table_sync(&db->raw);
+    for (size_t k = 0; k < MEAS_TSDB_NUM_RES; k++)
+        meas_tsdb_table_sync(&db->roll[k].tbl);
+}
+
+// Writes the open buckets, then closes every table
+static inline void meas_tsdb_close(meas_tsdb_t* db) {
+    meas_tsdb_table_close(&db->raw);
+    for (size_t k = 0; k < MEAS_TSDB_NUM_RES; k++) {
+        meas_tsdb_rollup_t* ro = &db->roll[k];
+        if (ro->tbl.meta != NULL) {
+            for (size_t i = 0; i < ue_table_len(&ro->acc); i++)
+                meas_tsdb_rollup_flush(ro, ue_table_key_at(&ro->acc, i), ue_table_at(&ro->acc, i));
+        }
+        ue_table_free(&ro->acc);
+        meas_tsdb_table_close(&ro->tbl);
+    }
+}
+
+#endif
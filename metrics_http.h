@@ -0,0 +1,191 @@
+#ifndef METRICS_HTTP_H
+#define METRICS_HTTP_H
+
+// Minimal HTTP endpoint for Prometheus / OpenMetrics scrapes.
+//
+// One thread accepts on the port and answers GET /metrics with what the
+// render callback writes into a metrics_buf_t, one connection at a time,
+// then closes it. Anything else gets a 404. The render callback runs on
+// this thread only, so it must not block on the threads it observes; a slow
+// or stuck client times out after METRICS_HTTP_IO_TIMEOUT_MS and only delays
+// the next scrape.
+
+#include "xlog.h"
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define METRICS_HTTP_IO_TIMEOUT_MS 1000
+#define METRICS_HTTP_POLL_MS 200  // How soon metrics_http_stop() is noticed
+#define METRICS_HTTP_REQ_MAX 2048
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} metrics_buf_t;
+
+static inline void metrics_buf_printf(metrics_buf_t* b, char const* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static inline void metrics_buf_printf(metrics_buf_t* b, char const* fmt, ...) {
+    if (b->cap == 0) {
+        b->cap = 4096;
+        b->data = malloc(b->cap);
+        assert(b->data != NULL && "Memory exhausted");
+    }
+    for (;;) {
+        va_list ap;
+        va_start(ap, fmt);
+        int const n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+        assert(n >= 0);
+        if (b->len + (size_t)n < b->cap) {
+            b->len += (size_t)n;
+            return;
+        }
+        b->cap = 2 * (b->len + (size_t)n + 1);
+        b->data = realloc(b->data, b->cap);
+        assert(b->data != NULL && "Memory exhausted");
+    }
+}
+
+typedef void (*metrics_render_fn)(metrics_buf_t* b, void* arg);
+
+typedef struct {
+    int fd;
+    uint16_t port;
+    metrics_render_fn render;
+    void* arg;
+    metrics_buf_t body;
+    metrics_buf_t head;
+    atomic_bool stop;
+    pthread_t thread;
+} metrics_http_t;
+
+static inline bool metrics_http_send_all(int fd, char const* p, size_t len) {
+    while (len > 0) {
+        ssize_t const n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+// Reads up to the end of the request head, answers and closes
+static inline void metrics_http_serve(metrics_http_t* m, int fd) {
+    struct timeval const tv = {.tv_sec = METRICS_HTTP_IO_TIMEOUT_MS / 1000, .tv_usec = (METRICS_HTTP_IO_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    char req[METRICS_HTTP_REQ_MAX];
+    size_t len = 0;
+    while (len < sizeof(req) - 1) {
+        ssize_t const n = recv(fd, req + len, sizeof(req) - 1 - len, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        len += (size_t)n;
+        req[len] = '\0';
+        if (strstr(req, "\r\n\r\n") != NULL || strstr(req, "\n\n") != NULL)
+            break;
+    }
+    req[len] = '\0';
+
+    bool const get = strncmp(req, "GET ", 4) == 0 || strncmp(req, "HEAD ", 5) == 0;
+    char const* path = strchr(req, ' ');
+    bool const metrics = get && path != NULL && strncmp(path + 1, "/metrics", 8) == 0
+                         && (path[9] == ' ' || path[9] == '?');
+
+    m->head.len = 0;
+    if (metrics) {
+        m->body.len = 0;
+        m->render(&m->body, m->arg);
+        metrics_buf_printf(&m->head,
+                           "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                           "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                           m->body.len);
+        if (metrics_http_send_all(fd, m->head.data, m->head.len) && req[0] == 'G')
+            metrics_http_send_all(fd, m->body.data, m->body.len);
+    } else {
+        metrics_buf_printf(&m->head, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+        metrics_http_send_all(fd, m->head.data, m->head.len);
+    }
+    close(fd);
+}
+
+static inline void* metrics_http_thread(void* arg) {
+    metrics_http_t* m = arg;
+    while (!atomic_load_explicit(&m->stop, memory_order_relaxed)) {
+        struct pollfd pfd = {.fd = m->fd, .events = POLLIN};
+        int const rc = poll(&pfd, 1, METRICS_HTTP_POLL_MS);
+        if (rc <= 0)
+            continue;
+        int const fd = accept(m->fd, NULL, NULL);
+        if (fd < 0)
+            continue;
+        metrics_http_serve(m, fd);
+    }
+    return NULL;
+}
+
+// Listens on port of every interface. False, with a warning, when the port
+// cannot be bound.
+static inline bool metrics_http_start(metrics_http_t* m, uint16_t port, metrics_render_fn render, void* arg) {
+    assert(m != NULL && render != NULL);
+    memset(m, 0, sizeof(*m));
+    m->port = port;
+    m->render = render;
+    m->arg = arg;
+    m->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m->fd < 0) {
+        XLOG_WARN("[METRICS]: socket: %s\n", strerror(errno));
+        return false;
+    }
+    int const one = 1;
+    setsockopt(m->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {.sin_family = AF_INET, .sin_port = htons(port), .sin_addr.s_addr = htonl(INADDR_ANY)};
+    if (bind(m->fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m->fd, 16) != 0) {
+        XLOG_WARN("[METRICS]: Port %u: %s, no /metrics endpoint\n", port, strerror(errno));
+        close(m->fd);
+        m->fd = -1;
+        return false;
+    }
+    atomic_init(&m->stop, false);
+    int const rc = pthread_create(&m->thread, NULL, metrics_http_thread, m);
+    assert(rc == 0);
+    XLOG_INFO("[METRICS]: Serving http://0.0.0.0:%u/metrics\n", port);
+    return true;
+}
+
+static inline void metrics_http_stop(metrics_http_t* m) {
+    if (m->fd < 0 || m->render == NULL)
+        return;
+    atomic_store(&m->stop, true);
+    int const rc = pthread_join(m->thread, NULL);
+    assert(rc == 0);
+    close(m->fd);
+    free(m->body.data);
+    free(m->head.data);
+    memset(m, 0, sizeof(*m));
+    m->fd = -1;
+}
+
+#endif
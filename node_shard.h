@@ -0,0 +1,68 @@
+#ifndef NODE_SHARD_H
+#define NODE_SHARD_H
+
+// Routing of KPM indications to per-E2-node shards.
+//
+// FlexRIC's sm_cb gets neither the node ID nor a user pointer, so a single
+// callback cannot tell which node an indication came from. Instead every
+// node subscribes with its own trampoline, fn_0_0 .. fn_N_1, each of which
+// forwards to fn(shard, slot, rd) with a fixed shard index. A node has
+// NODE_SHARD_SUBS subscription slots, so that two subscriptions of the
+// same node can be told apart while one replaces the other (kpm_resub.h).
+//
+//   static void sm_cb_kpm(size_t shard, size_t slot, sm_ag_if_rd_t const* rd) { ... }
+//   NODE_SHARD_CALLBACKS(sm_cb_kpm)
+//   report_sm_xapp_api(&n->id, 2, &sub, sm_cb_kpm_by_shard[s->idx][slot]);
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "xlog.h"
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <unistd.h>
+
+// E2 nodes one xApp instance serves
+#define NODE_SHARD_MAX 16
+// Subscriptions per node
+#define NODE_SHARD_SUBS 2
+
+#define NODE_SHARD_CB_(fn, i)                                        \
+    static void fn##_##i##_0(sm_ag_if_rd_t const* rd) { fn(i, 0, rd); } \
+    static void fn##_##i##_1(sm_ag_if_rd_t const* rd) { fn(i, 1, rd); }
+
+#define NODE_SHARD_CB_ROW_(fn, i) {fn##_##i##_0, fn##_##i##_1},
+
+#define NODE_SHARD_CALLBACKS(fn)                                              \
+    NODE_SHARD_CB_(fn, 0) NODE_SHARD_CB_(fn, 1) NODE_SHARD_CB_(fn, 2)         \
+    NODE_SHARD_CB_(fn, 3) NODE_SHARD_CB_(fn, 4) NODE_SHARD_CB_(fn, 5)         \
+    NODE_SHARD_CB_(fn, 6) NODE_SHARD_CB_(fn, 7) NODE_SHARD_CB_(fn, 8)         \
+    NODE_SHARD_CB_(fn, 9) NODE_SHARD_CB_(fn, 10) NODE_SHARD_CB_(fn, 11)       \
+    NODE_SHARD_CB_(fn, 12) NODE_SHARD_CB_(fn, 13) NODE_SHARD_CB_(fn, 14)      \
+    NODE_SHARD_CB_(fn, 15)                                                    \
+    static sm_cb const fn##_by_shard[NODE_SHARD_MAX][NODE_SHARD_SUBS] = {     \
+        NODE_SHARD_CB_ROW_(fn, 0) NODE_SHARD_CB_ROW_(fn, 1)                   \
+        NODE_SHARD_CB_ROW_(fn, 2) NODE_SHARD_CB_ROW_(fn, 3)                   \
+        NODE_SHARD_CB_ROW_(fn, 4) NODE_SHARD_CB_ROW_(fn, 5)                   \
+        NODE_SHARD_CB_ROW_(fn, 6) NODE_SHARD_CB_ROW_(fn, 7)                   \
+        NODE_SHARD_CB_ROW_(fn, 8) NODE_SHARD_CB_ROW_(fn, 9)                   \
+        NODE_SHARD_CB_ROW_(fn, 10) NODE_SHARD_CB_ROW_(fn, 11)                 \
+        NODE_SHARD_CB_ROW_(fn, 12) NODE_SHARD_CB_ROW_(fn, 13)                 \
+        NODE_SHARD_CB_ROW_(fn, 14) NODE_SHARD_CB_ROW_(fn, 15)                 \
+    };
+
+// Pins the calling thread to one CPU, shards round-robin over the online
+// CPUs. Failing to pin only costs locality, so it is not fatal.
+static inline void node_shard_pin_self(size_t shard) {
+    long const ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu <= 0)
+        return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET((int)(shard % (size_t)ncpu), &set);
+    int const rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (rc != 0)
+        XLOG_WARN("[SHARD %zu]: Could not pin worker to CPU %zu\n", shard, shard % (size_t)ncpu);
+}
+
+#endif
@@ -0,0 +1,321 @@
+// DRL RC: a policy network trained offline (drl_net.h, the drl_model key)
+// puts each reported UE on mMTC or URLLC. All UEs of the indication are
+// evaluated in one batch. DRB/QFI and the initial control are those of the
+// threshold policy.
+//
+// The network reads the features below, the first `inputs` of them. Its
+// outputs 0 and 1 score mMTC and URLLC, the higher one wins. A third
+// output, when present, is the UE's PRB demand.
+//
+// Without a model, or while drl_model does not load, the policy follows
+// the burst detector as threshold does. The daemon watches drl_model from
+// its subscription thread: a new path, or a rewrite of the file, is loaded
+// there once and handed to every node's policy between two indications.
+//
+// With drl_exp_shm, each UE reported on two indications in a row yields an
+// experience in that ring (drl_exp.h): the features and decision of the
+// first, the reward seen on the second, and its features. drl_explore
+// flips that share of the decisions, model or not. The ring lasts until the
+// daemon exits, also across a SIGHUP to another policy and back, so a
+// trainer stays attached.
+
+#include "drl_exp.h"
+#include "drl_net.h"
+#include "xapp_policy.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define DRL_INITIAL_CONTROL_MIN_UES 2
+// Reward of a decision: minus the RLC delay in ms the UE then reports,
+// minus this while on URLLC
+#define DRL_URLLC_COST_MS 2.0f
+
+// Inputs, in the units of the meas_row.h columns named
+typedef enum {
+    DRL_FEAT_THP_UL,     // ue_thp_ul_kbps
+    DRL_FEAT_THP_DL,     // ue_thp_dl_kbps
+    DRL_FEAT_PRB_UL,     // ue_prb_ul
+    DRL_FEAT_PRB_DL,     // ue_prb_dl
+    DRL_FEAT_PDCP_UL,    // ue_pdcp_ul_kb
+    DRL_FEAT_PDCP_DL,    // ue_pdcp_dl_kb
+    DRL_FEAT_DELAY,      // ue_delay_us
+    DRL_FEAT_BURST,      // ue_is_burst, the detector's
+    DRL_FEAT_FORECAST,   // 1 when a burst is forecast
+    DRL_FEAT_MODE,       // 1 while on URLLC
+    DRL_FEAT_PRB_ALLOC,  // ue_prb_allocation, of the last indication
+    DRL_NUM_FEAT,
+} drl_feat_e;
+
+_Static_assert(DRL_NUM_FEAT <= DRL_EXP_MAX_FEAT, "drl_exp_t holds the features");
+
+// A UE's state and decision of the last indication
+typedef struct {
+    float s[DRL_NUM_FEAT];
+    int64_t t_us;
+    bool urllc;
+} drl_prev_t;
+
+typedef struct {
+    drl_net_t net;  // drl_model_net's weights, activations of its own
+    bool loaded;
+    uint64_t gen;             // drl_model_gen of net
+    ue_table_t const* tbl;    // Of the last decide(), for prb_demand
+    bool* urllc;              // Per reported UE
+    float* prb;               // Third output per table slot
+    size_t cap;
+    bool initial_control_done;
+    // Experience
+    drl_exp_ring_t* exp;  // NULL: none
+    ue_table_t prev;      // drl_prev_t per UE
+    uint64_t rng;
+} drl_state_t;
+
+// The model of the policies of all nodes. The daemon loads it and
+// replaces it with every shard lock held (drl_model_sync() in xapp_core.h),
+// so a policy reads both under its own. A plugin build has no loader and
+// follows the burst detector.
+static drl_net_t* drl_model_net;  // NULL: none
+static uint64_t drl_model_gen;
+
+// The ring is the process's, shared by the policies of all nodes. The
+// daemon removes it at exit (drl_exp_remove() in xapp_core.h).
+static pthread_mutex_t drl_exp_mtx = PTHREAD_MUTEX_INITIALIZER;
+static drl_exp_ring_t drl_exp_ring;
+static char drl_exp_name[XAPP_CFG_STR_LEN];
+static bool drl_exp_tried;
+
+static void* drl_open(size_t shard) {
+    drl_state_t* st = calloc(1, sizeof(drl_state_t));
+    assert(st != NULL && "Memory exhausted");
+    ue_table_init(&st->prev, sizeof(drl_prev_t), 64);
+    st->rng = 0x9e3779b97f4a7c15ULL * (shard + 1) ^ (uint64_t)time(NULL);
+    return st;
+}
+
+static void drl_close(void* arg) {
+    drl_state_t* st = arg;
+    drl_net_unshare(&st->net);
+    ue_table_free(&st->prev);
+    free(st->urllc);
+    free(st->prb);
+    free(st);
+}
+
+// The ring named by drl_exp_shm, created by the first policy that asks
+static drl_exp_ring_t* drl_exp_shared(char const* name) {
+    pthread_mutex_lock(&drl_exp_mtx);
+    if (!drl_exp_tried) {
+        drl_exp_tried = true;
+        memcpy(drl_exp_name, name, sizeof(drl_exp_name));
+        if (drl_exp_create(&drl_exp_ring, name, DRL_NUM_FEAT))
+            XLOG_INFO("[DRL]: Experience to %s, %u entries\n", name, DRL_EXP_CAP);
+        else
+            XLOG_WARN("[DRL]: No experience ring\n");
+    }
+    drl_exp_ring_t* r = drl_exp_ring.hdr != NULL ? &drl_exp_ring : NULL;
+    pthread_mutex_unlock(&drl_exp_mtx);
+    return r;
+}
+
+// xorshift64*, uniform in [0, 1)
+static float drl_uniform(drl_state_t* st) {
+    st->rng ^= st->rng >> 12;
+    st->rng ^= st->rng << 25;
+    st->rng ^= st->rng >> 27;
+    return (float)((st->rng * 0x2545f4914f6cdd1dULL) >> 40) / (float)(1u << 24);
+}
+
+// New UEs start as mMTC, QFI=9 (sen)
+static void drl_ue_new(void* st, ue_state_t* ue) {
+    (void)st;
+    ue->alloc.drb_id = 5;
+    ue->alloc.qfi = 9;
+}
+
+// Takes up the published model, a compare when it did not change
+static void drl_sync_model(drl_state_t* st) {
+    if (st->gen == drl_model_gen)
+        return;
+    st->gen = drl_model_gen;
+    st->loaded = drl_model_net != NULL;
+    if (st->loaded)
+        drl_net_share(&st->net, drl_model_net);
+    else
+        drl_net_unshare(&st->net);
+}
+
+static void drl_features(float f[DRL_NUM_FEAT], ue_state_t const* ue) {
+    f[DRL_FEAT_THP_UL] = ue->meas.ue_thp_ul;
+    f[DRL_FEAT_THP_DL] = ue->meas.ue_thp_dl;
+    f[DRL_FEAT_PRB_UL] = (float)ue->meas.prb_tot_ul;
+    f[DRL_FEAT_PRB_DL] = (float)ue->meas.prb_tot_dl;
+    f[DRL_FEAT_PDCP_UL] = (float)ue->meas.pdcp_volume_ul;
+    f[DRL_FEAT_PDCP_DL] = (float)ue->meas.pdcp_volume_dl;
+    f[DRL_FEAT_DELAY] = ue->meas.rlc_delay_dl;
+    f[DRL_FEAT_BURST] = (float)ue->meas.is_burst;
+    f[DRL_FEAT_FORECAST] = ue->predicted_burst ? 1.0f : 0.0f;
+    f[DRL_FEAT_MODE] = ue->alloc.is_burst_mode ? 1.0f : 0.0f;
+    f[DRL_FEAT_PRB_ALLOC] = (float)ue->alloc.prb_allocation;
+}
+
+// st->urllc per reported UE, in table order: the network's choice, or the
+// detector's without one
+static void drl_infer(drl_state_t* st, ue_table_t const* tbl) {
+    if (st->cap < ue_table_len(tbl)) {
+        st->cap = ue_table_len(tbl);
+        st->urllc = realloc(st->urllc, st->cap * sizeof(bool));
+        st->prb = realloc(st->prb, st->cap * sizeof(float));
+        assert(st->urllc != NULL && st->prb != NULL && "Memory exhausted");
+    }
+    bool* const urllc = st->urllc;
+    size_t n = 0;
+    if (!st->loaded) {
+        for (size_t i = 0; i < ue_table_len(tbl); i++) {
+            ue_state_t const* ue = ue_table_at(tbl, i);
+            if (ue_table_seen(tbl, i))
+                urllc[n++] = ue->meas.is_burst || ue->predicted_burst;
+        }
+        return;
+    }
+    for (size_t i = 0; i < ue_table_len(tbl); i++)
+        n += ue_table_seen(tbl, i);
+    float* const x = drl_net_input(&st->net, n);
+    size_t const stride = st->net.stride;
+    size_t u = 0;
+    for (size_t i = 0; i < ue_table_len(tbl); i++) {
+        if (!ue_table_seen(tbl, i))
+            continue;
+        float f[DRL_NUM_FEAT];
+        drl_features(f, ue_table_at(tbl, i));
+        for (size_t k = 0; k < st->net.inputs; k++)
+            x[k * stride + u] = f[k];
+        u++;
+    }
+    float const* const y = drl_net_run(&st->net, n);
+    for (u = 0; u < n; u++)
+        urllc[u] = y[stride + u] > y[u];
+
+    if (st->net.outputs < 3)
+        return;
+    u = 0;
+    for (size_t i = 0; i < ue_table_len(tbl); i++)
+        st->prb[i] = ue_table_seen(tbl, i) ? y[2 * stride + u++] : 0;
+}
+
+// Experience of the UE's last decision, now that f shows its outcome, then
+// remembers this one
+static void drl_experience(drl_state_t* st, uint64_t key, float const f[DRL_NUM_FEAT], ue_state_t const* ue, bool urllc, int64_t now_us) {
+    bool created = false;
+    drl_prev_t* p = ue_table_upsert(&st->prev, key, &created);
+    if (!created) {
+        uint64_t idx;
+        drl_exp_t* e = drl_exp_claim(st->exp, &idx);
+        e->ue_key = key;
+        e->t_us = now_us;
+        e->dt_us = now_us - p->t_us;
+        memcpy(e->s, p->s, sizeof(p->s));
+        memcpy(e->s2, f, sizeof(p->s));
+        e->reward = -f[DRL_FEAT_DELAY] / 1000.0f - (p->urllc ? DRL_URLLC_COST_MS : 0.0f);
+        e->action = p->urllc;
+        e->prb = (uint32_t)ue->alloc.prb_allocation;
+        drl_exp_publish(e, idx);
+    }
+    memcpy(p->s, f, sizeof(p->s));
+    p->t_us = now_us;
+    p->urllc = urllc;
+}
+
+static bool drl_decide(void* arg, xapp_policy_ctx_t* ctx) {
+    drl_state_t* st = arg;
+    ue_table_t* tbl = ctx->ue_tbl;
+    bool resource_reallocation_needed = false;
+
+    drl_sync_model(st);
+    st->tbl = tbl;
+    drl_infer(st, tbl);
+    if (st->exp == NULL && ctx->cfg->drl_exp_shm[0] != '\0')
+        st->exp = drl_exp_shared(ctx->cfg->drl_exp_shm);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t const now_us = (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    if (st->exp != NULL)
+        ue_table_begin_epoch(&st->prev);
+
+    size_t u = 0;
+    for (size_t i = 0; i < ue_table_len(tbl); i++) {
+        if (!ue_table_seen(tbl, i))
+            continue;
+        ue_state_t* ue = ue_table_at(tbl, i);
+        bool const explored = ctx->cfg->drl_explore > 0 && drl_uniform(st) < ctx->cfg->drl_explore;
+        bool const current_burst = st->urllc[u++] != explored;
+        bool const previous_burst = ue->alloc.is_burst_mode;
+
+        if (st->exp != NULL) {
+            float f[DRL_NUM_FEAT];
+            drl_features(f, ue);
+            drl_experience(st, ue_table_key_at(tbl, i), f, ue, current_burst, now_us);
+        }
+
+        ue->alloc.drb_id = current_burst ? 6 : 5;
+        ue->alloc.qfi = current_burst ? 4 : 9;
+
+        if (current_burst != previous_burst) {
+            XLOG_INFO("\n[RESOURCE MANAGER]: UE %s BURST mode (RAN UE ID: %lu)%s\n", current_burst ? "entering" : "exiting",
+                      ue->meas.ran_ue_id, explored ? ", explored" : st->loaded ? ", DRL" : "");
+            ue->alloc.is_burst_mode = current_burst;
+            ctx->transition(ctx, ue);
+            resource_reallocation_needed = true;
+        }
+    }
+
+    // A UE missing from this indication starts over
+    if (st->exp != NULL)
+        ue_table_sweep(&st->prev, 0, NULL, NULL);
+
+    if (!st->initial_control_done && ue_table_len(tbl) >= DRL_INITIAL_CONTROL_MIN_UES) {
+        XLOG_INFO("\n[INITIAL CONTROL]: Sending initial control messages for all UEs\n");
+        st->initial_control_done = true;
+        resource_reallocation_needed = true;
+        ctx->initial_control(ctx);
+    }
+
+    if (resource_reallocation_needed) {
+        XLOG_INFO("\n[TRIGGER]: Resource reallocation required\n");
+        for (size_t i = 0; i < ue_table_len(tbl); i++) {
+            ue_state_t const* ue = ue_table_at(tbl, i);
+            ctx->rc_alloc->drb_id = ue->alloc.drb_id;
+            ctx->rc_alloc->qfi = ue->alloc.qfi;
+            ctx->rc_alloc->mapping_ind = 1;
+        }
+    }
+    return resource_reallocation_needed;
+}
+
+// The network's third output, else what the UL throughput needs, within
+// [prb_min, prb_pool]
+static int drl_prb_demand(void* arg, xapp_cfg_t const* cfg, ue_state_t const* ue) {
+    drl_state_t const* st = arg;
+    float prb = (float)xapp_policy_prb_need(ue);
+    if (st->loaded && st->net.outputs >= 3 && st->tbl != NULL)
+        prb = st->prb[ue_table_slot(st->tbl, ue)] + 0.5f;
+    if (!(prb >= (float)cfg->prb_min))  // Also NaN
+        return (int)cfg->prb_min;
+    return prb > (float)cfg->prb_pool ? (int)cfg->prb_pool : (int)prb;
+}
+
+static xapp_policy_t const policy_drl = {
+    .abi = XAPP_POLICY_ABI,
+    .name = "drl",
+    .flags = XAPP_POLICY_RC,
+    .meas_cols = MEAS_NUM_COLS,
+    .open = drl_open,
+    .close = drl_close,
+    .ue_new = drl_ue_new,
+    .decide = drl_decide,
+    .prb_demand = drl_prb_demand,
+};
+
+XAPP_POLICY_EXPORT(policy_drl)
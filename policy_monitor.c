@@ -0,0 +1,12 @@
+// Monitoring only, the policy of xapp_kpm.c: the KPM columns of every
+// reported UE are written, nothing is decided and no RC control is sent.
+
+#include "xapp_policy.h"
+
+static xapp_policy_t const policy_monitor = {
+    .abi = XAPP_POLICY_ABI,
+    .name = "monitor",
+    .meas_cols = MEAS_KPM_COLS,
+};
+
+XAPP_POLICY_EXPORT(policy_monitor)
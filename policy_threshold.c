@@ -0,0 +1,109 @@
+// Threshold RC, the policy of xapp_RC_KPM_Infinity.c: a UE whose UL
+// throughput is in a burst, or forecast to be, moves to the URLLC DRB.
+// Every other UE stays on mMTC. Once INITIAL_CONTROL_MIN_UES UEs are
+// attached, every UE gets its control once, burst or not.
+
+#include "xapp_policy.h"
+#include <assert.h>
+#include <stdlib.h>
+
+#define INITIAL_CONTROL_MIN_UES 2
+
+typedef struct {
+    bool initial_control_done;
+} threshold_state_t;
+
+static void* threshold_open(size_t shard) {
+    (void)shard;
+    threshold_state_t* st = calloc(1, sizeof(threshold_state_t));
+    assert(st != NULL && "Memory exhausted");
+    return st;
+}
+
+static void threshold_close(void* st) {
+    free(st);
+}
+
+// New UEs start as mMTC, QFI=9 (sen)
+static void threshold_ue_new(void* st, ue_state_t* ue) {
+    (void)st;
+    ue->alloc.drb_id = 5;
+    ue->alloc.qfi = 9;
+}
+
+// Dynamic DRB selection, follows the burst detector
+static int get_dynamic_drb(bool burst) {
+    return burst ? 6 : 5;
+}
+
+// Dynamic QFI from 5QI table
+static int get_dynamic_qfi(bool burst) {
+    return burst ? 4 : 9;
+}
+
+static bool threshold_decide(void* arg, xapp_policy_ctx_t* ctx) {
+    threshold_state_t* st = arg;
+    ue_table_t* tbl = ctx->ue_tbl;
+    bool resource_reallocation_needed = false;
+
+    for (size_t i = 0; i < ue_table_len(tbl); i++) {
+        if (!ue_table_seen(tbl, i))
+            continue;
+        ue_state_t* ue = ue_table_at(tbl, i);
+        // A forecast burst is handled like a detected one, only earlier
+        bool current_burst = ue->meas.is_burst || ue->predicted_burst;
+        bool previous_burst = ue->alloc.is_burst_mode;
+
+        // Update DRB and QFI dynamically
+        ue->alloc.drb_id = get_dynamic_drb(current_burst);
+        ue->alloc.qfi = get_dynamic_qfi(current_burst);
+
+        // Detect transition to burst mode
+        if (current_burst && !previous_burst) {
+            XLOG_INFO("\n[RESOURCE MANAGER]: UE entering BURST mode (RAN UE ID: %lu)%s\n", 
+                   ue->meas.ran_ue_id, ue->meas.is_burst ? "" : ", forecast");
+            ue->alloc.is_burst_mode = true;
+            ctx->transition(ctx, ue);
+            resource_reallocation_needed = true;
+        }
+        // Detect transition from burst to normal
+        else if (!current_burst && previous_burst) {
+            XLOG_INFO("\n[RESOURCE MANAGER]: UE exiting BURST mode (RAN UE ID: %lu)\n", 
+                   ue->meas.ran_ue_id);
+            ue->alloc.is_burst_mode = false;
+            ctx->transition(ctx, ue);
+            resource_reallocation_needed = true;
+        }
+    }
+
+    if (!st->initial_control_done && ue_table_len(tbl) >= INITIAL_CONTROL_MIN_UES) {
+        XLOG_INFO("\n[INITIAL CONTROL]: Sending initial control messages for all UEs\n");
+        st->initial_control_done = true;
+        resource_reallocation_needed = true;  // Force sending control messages
+        ctx->initial_control(ctx);
+    }
+
+    if (resource_reallocation_needed) {
+        XLOG_INFO("\n[TRIGGER]: Resource reallocation required\n");
+        for (size_t i = 0; i < ue_table_len(tbl); i++) {
+            ue_state_t const* ue = ue_table_at(tbl, i);
+            ctx->rc_alloc->drb_id = ue->alloc.drb_id;
+            ctx->rc_alloc->qfi = ue->alloc.qfi;
+            ctx->rc_alloc->mapping_ind = 1;
+        }
+    }
+    return resource_reallocation_needed;
+}
+
+static xapp_policy_t const policy_threshold = {
+    .abi = XAPP_POLICY_ABI,
+    .name = "threshold",
+    .flags = XAPP_POLICY_RC,
+    .meas_cols = MEAS_NUM_COLS,
+    .open = threshold_open,
+    .close = threshold_close,
+    .ue_new = threshold_ue_new,
+    .decide = threshold_decide,
+};
+
+XAPP_POLICY_EXPORT(policy_threshold)
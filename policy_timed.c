@@ -0,0 +1,116 @@
+// Timed RC, the policy of xapp_kpm_rc_setTime.c: a bursting UE moves to
+// the URLLC DRB with QFI 11, every other UE is held on mMTC with QFI 10
+// meanwhile. The node's RC allocation is logged on every indication.
+//
+// Its nodes report RRU.PrbTot* in subcarriers, UEs with PRB values above
+// the pool are left as they are.
+
+#include "xapp_policy.h"
+
+// New UEs start as mMTC
+static void timed_ue_new(void* st, ue_state_t* ue) {
+    (void)st;
+    ue->alloc.drb_id = 5;
+    ue->alloc.qfi = 10;
+}
+
+// Moves every reported UE other than `except` that is not bursting to drb_id / qfi
+static void set_other_ues(ue_table_t* tbl, ue_state_t const* except, int drb_id, int qfi) {
+    for (size_t j = 0; j < ue_table_len(tbl); j++) {
+        ue_state_t* other = ue_table_at(tbl, j);
+        if (other == except || !ue_table_seen(tbl, j) || other->alloc.is_burst_mode)
+            continue;
+        other->alloc.drb_id = drb_id;
+        other->alloc.qfi = qfi;
+    }
+}
+
+static bool timed_decide(void* st, xapp_policy_ctx_t* ctx) {
+    (void)st;
+    ue_table_t* tbl = ctx->ue_tbl;
+    bool resource_reallocation_needed = false;
+
+    for (size_t i = 0; i < ue_table_len(tbl); i++) {
+        if (!ue_table_seen(tbl, i))
+            continue;
+        ue_state_t* ue = ue_table_at(tbl, i);
+        // A forecast burst is handled like a detected one, only earlier
+        bool current_burst = ue->meas.is_burst || ue->predicted_burst;
+        bool previous_burst = ue->alloc.is_burst_mode;
+
+        // Check if PRB values are valid
+        if (xapp_policy_invalid_prb(ctx->cfg, ue)) {
+            XLOG_WARN("[RESOURCE MANAGER]: Invalid PRB values for UE (RAN UE ID %lu), skipping allocation\n", ue->meas.ran_ue_id);
+            continue;
+        }
+        
+        size_t const others = ue_table_len(tbl) - 1;
+
+        // Detect transition to burst mode
+        if (current_burst && !previous_burst) {
+            XLOG_INFO("\n[RESOURCE MANAGER]: UE entering BURST mode (RAN UE ID: %lu)%s\n", 
+                   ue->meas.ran_ue_id, ue->meas.is_burst ? "" : ", forecast");
+            
+            ue->alloc.is_burst_mode = true;
+            ue->alloc.drb_id = 6;  // URLLC DRB
+            ue->alloc.qfi = 11;
+            
+            // The remaining UEs share what is left of the pool
+            if (others > 0) {
+                set_other_ues(tbl, ue, 5, 10);  // mMTC DRB
+                XLOG_INFO("[RESOURCE MANAGER]: %zu other UE(s) give up PRBs to accommodate burst\n", others);
+            }
+            
+            ctx->transition(ctx, ue);
+            resource_reallocation_needed = true;
+        }
+        // Detect transition from burst to normal
+        else if (!current_burst && previous_burst) {
+            XLOG_INFO("\n[RESOURCE MANAGER]: UE exiting BURST mode (RAN UE ID: %lu)\n", 
+                   ue->meas.ran_ue_id);
+            
+            ue->alloc.is_burst_mode = false;
+            ue->alloc.drb_id = 5;  // mMTC DRB
+            ue->alloc.qfi = 10;
+            
+            if (others > 0) {
+                set_other_ues(tbl, ue, 5, 10);  // mMTC DRB
+                XLOG_INFO("[RESOURCE MANAGER]: %zu other UE(s) restored\n", others);
+            }
+            
+            ctx->transition(ctx, ue);
+            resource_reallocation_needed = true;
+        }
+    }
+
+    if (resource_reallocation_needed) {
+        XLOG_INFO("\n[TRIGGER]: Resource reallocation required\n");
+    }
+    
+    for (size_t i = 0; i < ue_table_len(tbl); i++) {
+        ue_state_t const* ue = ue_table_at(tbl, i);
+        ctx->rc_alloc->drb_id = ue->alloc.drb_id;
+        ctx->rc_alloc->qfi = ue->alloc.qfi;
+        ctx->rc_alloc->mapping_ind = 1;
+    }
+    return resource_reallocation_needed;
+}
+
+// PRBs the UE's UL throughput needs, prb_min is left to the allocator
+static int timed_prb_demand(void* st, xapp_cfg_t const* cfg, ue_state_t const* ue) {
+    (void)st;
+    int required_prb = xapp_policy_prb_need(ue);
+    return (required_prb > (int)cfg->prb_pool) ? (int)cfg->prb_pool : (required_prb < 0 ? 0 : required_prb);
+}
+
+static xapp_policy_t const policy_timed = {
+    .abi = XAPP_POLICY_ABI,
+    .name = "timed",
+    .flags = XAPP_POLICY_RC | XAPP_POLICY_PRB_SUBCARRIERS,
+    .meas_cols = MEAS_NUM_COLS,
+    .ue_new = timed_ue_new,
+    .decide = timed_decide,
+    .prb_demand = timed_prb_demand,
+};
+
+XAPP_POLICY_EXPORT(policy_timed)
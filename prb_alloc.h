@@ -0,0 +1,445 @@
+#ifndef PRB_ALLOC_H
+#define PRB_ALLOC_H
+
+// PRB allocation policies for the UEs of one E2 node.
+//
+// The caller fills a prb_alloc_batch_t with one entry per UE (PRB demand,
+// 5QI, slice, burst flag) and a policy writes .prb. The batch is kept as
+// structure-of-arrays so the solver loops run over contiguous floats and
+// the compiler vectorizes them. Every policy keeps the sum of .prb within
+// the pool it was opened with:
+//
+//  - linear: the demand, clamped per UE, scaled down when the UEs together
+//    ask for more than the pool.
+//  - fixed:  burst_prb for bursting UEs, normal_prb for the others, who give
+//    up PRBs when the bursting UEs need them.
+//  - pf:     proportional fair, i.e. weighted water-filling with 5QI
+//    priority weights. The pool is split across slices within their min /
+//    max shares, then each slice's share across its UEs, every UE between
+//    its guaranteed minimum and what it can use. 1000 UEs take a few tens
+//    of microseconds.
+//
+// The allocator key of xapp_cfg_t picks the policy, see prb_alloc_open().
+
+#include "xlog.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PRB_ALLOC_MAX_SLICES 4
+// Bisection steps of the water level, rounding takes care of the rest
+#define PRB_ALLOC_PF_ITERS 32
+// Independent partial sums per reduction. Float addition does not
+// reassociate without -ffast-math, separate lanes let it vectorize anyway.
+#define PRB_ALLOC_LANES 8
+
+typedef struct {
+    size_t len;
+    size_t cap;
+    int pool;  // Set by prb_alloc_batch_reset()
+
+    // Input, one entry per UE
+    float* demand;   // PRBs the UE can use
+    float* weight;   // 5QI priority weight, prb_alloc_5qi_weight()
+    float* min_prb;  // Guaranteed, as far as the UE can use it
+    float* max_prb;
+    uint8_t* slice;
+    uint8_t* burst;
+
+    // Output
+    int* prb;
+
+    // Solver scratch, per-slice segments of the inputs
+    uint32_t* idx;
+    float* w;
+    float* lo;
+    float* hi;
+    float* x;
+} prb_alloc_batch_t;
+
+typedef struct {
+    int min_prb;
+    int max_prb;
+} prb_slice_t;
+
+typedef struct prb_alloc_s prb_alloc_t;
+
+struct prb_alloc_s {
+    char const* name;
+    void (*run)(prb_alloc_t const* a, prb_alloc_batch_t* b);
+    int pool;
+};
+
+// Priority levels of the standardized 5QIs (3GPP TS 23.501 table 5.7.4-1).
+// A lower level is served first, so the weight is its inverse, scaled so
+// that the default bearer (5QI 9) weighs about 1.
+static inline float prb_alloc_5qi_weight(int fiveqi) {
+    static struct {
+        uint8_t fiveqi;
+        uint8_t level;
+    } const tbl[] = {
+        {1, 20}, {2, 40}, {3, 30}, {4, 50}, {5, 10}, {6, 60}, {7, 70}, {8, 80}, {9, 90}, {10, 90},
+        {65, 7}, {66, 20}, {67, 15}, {69, 5}, {70, 55}, {75, 25}, {79, 65}, {80, 68},
+        {82, 19}, {83, 22}, {84, 24}, {85, 21}, {86, 18},
+    };
+    for (size_t i = 0; i < sizeof(tbl) / sizeof(tbl[0]); i++) {
+        if (tbl[i].fiveqi == fiveqi)
+            return 90.0f / tbl[i].level;
+    }
+    return 1.0f;  // Unknown or operator specific, as 5QI 9
+}
+
+/////////////////////////////
+// Batch
+/////////////////////////////
+
+static inline void prb_alloc_batch_grow(prb_alloc_batch_t* b, size_t cap) {
+    float** const f[] = {&b->demand, &b->weight, &b->min_prb, &b->max_prb, &b->w, &b->lo, &b->hi, &b->x};
+    for (size_t i = 0; i < sizeof(f) / sizeof(f[0]); i++) {
+        *f[i] = realloc(*f[i], cap * sizeof(float));
+        assert(*f[i] != NULL && "Memory exhausted");
+    }
+    b->slice = realloc(b->slice, cap);
+    b->burst = realloc(b->burst, cap);
+    b->prb = realloc(b->prb, cap * sizeof(int));
+    b->idx = realloc(b->idx, cap * sizeof(uint32_t));
+    assert(b->slice != NULL && b->burst != NULL && b->prb != NULL && b->idx != NULL && "Memory exhausted");
+    b->cap = cap;
+}
+
+static inline void prb_alloc_batch_init(prb_alloc_batch_t* b, size_t expected_ues) {
+    memset(b, 0, sizeof(*b));
+    prb_alloc_batch_grow(b, expected_ues > 0 ? expected_ues : 1);
+}
+
+static inline void prb_alloc_batch_reset(prb_alloc_batch_t* b, int pool) {
+    b->len = 0;
+    b->pool = pool;
+}
+
+// Adds a UE with no guaranteed PRBs, the caller may raise min_prb[i] or
+// lower max_prb[i]. Returns its index.
+static inline size_t prb_alloc_batch_push(prb_alloc_batch_t* b, float demand, int fiveqi, size_t slice, bool burst) {
+    assert(slice < PRB_ALLOC_MAX_SLICES);
+    if (b->len == b->cap)
+        prb_alloc_batch_grow(b, 2 * b->cap);
+    size_t const i = b->len++;
+    b->demand[i] = demand > 0 ? demand : 0;
+    b->weight[i] = prb_alloc_5qi_weight(fiveqi);
+    b->min_prb[i] = 0;
+    b->max_prb[i] = (float)b->pool;
+    b->slice[i] = (uint8_t)slice;
+    b->burst[i] = burst;
+    b->prb[i] = 0;
+    return i;
+}
+
+static inline void prb_alloc_batch_free(prb_alloc_batch_t* b) {
+    free(b->demand);
+    free(b->weight);
+    free(b->min_prb);
+    free(b->max_prb);
+    free(b->slice);
+    free(b->burst);
+    free(b->prb);
+    free(b->idx);
+    free(b->w);
+    free(b->lo);
+    free(b->hi);
+    free(b->x);
+    memset(b, 0, sizeof(*b));
+}
+
+/////////////////////////////
+// Solver kernels
+/////////////////////////////
+
+static inline float prb_alloc_sum(size_t n, float const* restrict v) {
+    float acc[PRB_ALLOC_LANES] = {0};
+    size_t i = 0;
+    for (; i + PRB_ALLOC_LANES <= n; i += PRB_ALLOC_LANES) {
+        for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+            acc[l] += v[i + l];
+    }
+    float sum = 0;
+    for (; i < n; i++)
+        sum += v[i];
+    for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+        sum += acc[l];
+    return sum;
+}
+
+static inline float prb_alloc_clamp(float v, float lo, float hi) {
+    v = v < lo ? lo : v;
+    return v > hi ? hi : v;
+}
+
+// Sum of clamp(w[i] * level, lo[i], hi[i])
+static inline float prb_alloc_level_sum(size_t n, float const* restrict w, float const* restrict lo, float const* restrict hi, float level) {
+    float acc[PRB_ALLOC_LANES] = {0};
+    size_t i = 0;
+    for (; i + PRB_ALLOC_LANES <= n; i += PRB_ALLOC_LANES) {
+        for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+            acc[l] += prb_alloc_clamp(w[i + l] * level, lo[i + l], hi[i + l]);
+    }
+    float sum = 0;
+    for (; i < n; i++)
+        sum += prb_alloc_clamp(w[i] * level, lo[i], hi[i]);
+    for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+        sum += acc[l];
+    return sum;
+}
+
+static inline size_t prb_alloc_count_above(size_t n, float const* restrict v, float t) {
+    uint32_t acc[PRB_ALLOC_LANES] = {0};
+    size_t i = 0;
+    for (; i + PRB_ALLOC_LANES <= n; i += PRB_ALLOC_LANES) {
+        for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+            acc[l] += v[i + l] > t;
+    }
+    size_t cnt = 0;
+    for (; i < n; i++)
+        cnt += v[i] > t;
+    for (size_t l = 0; l < PRB_ALLOC_LANES; l++)
+        cnt += acc[l];
+    return cnt;
+}
+
+// x[i] = clamp(w[i] * level, lo[i], hi[i]) with the level at which the x
+// add up to budget. Needs lo <= hi and w > 0. Gives everyone hi if that
+// fits, and scales lo down if even that does not.
+static inline void prb_alloc_waterfill(size_t n, float const* restrict w, float const* restrict lo, float const* restrict hi, float budget,
+                                       float* restrict x) {
+    float const sum_lo = prb_alloc_sum(n, lo);
+    if (sum_lo >= budget) {
+        float const f = sum_lo > 0 ? budget / sum_lo : 0;
+        for (size_t i = 0; i < n; i++)
+            x[i] = lo[i] * f;
+        return;
+    }
+    if (prb_alloc_sum(n, hi) <= budget) {
+        memcpy(x, hi, n * sizeof(float));
+        return;
+    }
+
+    float top = 0;
+    for (size_t i = 0; i < n; i++) {
+        float const l = hi[i] / w[i];
+        top = l > top ? l : top;
+    }
+    float bot = 0;
+    for (int it = 0; it < PRB_ALLOC_PF_ITERS; it++) {
+        float const level = 0.5f * (bot + top);
+        if (prb_alloc_level_sum(n, w, lo, hi, level) > budget)
+            top = level;
+        else
+            bot = level;
+    }
+    for (size_t i = 0; i < n; i++)
+        x[i] = prb_alloc_clamp(w[i] * bot, lo[i], hi[i]);
+}
+
+// Integer PRBs for x[0, n) of b's UEs idx[0, n): rounded down, then the
+// PRBs the rounding lost go to the largest fractional parts. Never more
+// than the sum of x, rounded to nearest.
+static inline void prb_alloc_round(prb_alloc_batch_t* b, uint32_t const* idx, float const* x, size_t n) {
+    float* const frac = b->w;  // Free again once x is solved
+    assert(frac != x);
+    long spare = (long)(prb_alloc_sum(n, x) + 0.5f);
+    for (size_t i = 0; i < n; i++) {
+        float const fl = (float)(int)x[i];  // x >= 0
+        b->prb[idx[i]] = (int)fl;
+        frac[i] = x[i] - fl;
+        spare -= (long)fl;
+    }
+    if (spare <= 0)
+        return;
+
+    // Threshold above which at most `spare` fractions lie
+    float bot = 0, top = 1;
+    for (int it = 0; it < 24; it++) {
+        float const t = 0.5f * (bot + top);
+        if (prb_alloc_count_above(n, frac, t) > (size_t)spare)
+            bot = t;
+        else
+            top = t;
+    }
+    for (size_t i = 0; i < n && spare > 0; i++) {
+        if (frac[i] > top) {
+            b->prb[idx[i]]++;
+            frac[i] = 0;
+            spare--;
+        }
+    }
+    // Ties at the threshold, in UE order
+    for (size_t i = 0; i < n && spare > 0; i++) {
+        if (frac[i] > 0) {
+            b->prb[idx[i]]++;
+            spare--;
+        }
+    }
+}
+
+/////////////////////////////
+// linear
+/////////////////////////////
+
+static void prb_alloc_linear_run(prb_alloc_t const* a, prb_alloc_batch_t* b) {
+    size_t const n = b->len;
+    float* restrict x = b->x;
+    for (size_t i = 0; i < n; i++) {
+        x[i] = prb_alloc_clamp(b->demand[i], b->min_prb[i], b->max_prb[i]);
+        b->idx[i] = (uint32_t)i;
+    }
+    float const sum = prb_alloc_sum(n, x);
+    if (sum > a->pool) {
+        float const f = a->pool / sum;
+        for (size_t i = 0; i < n; i++)
+            x[i] *= f;
+    }
+    prb_alloc_round(b, b->idx, x, n);
+}
+
+/////////////////////////////
+// fixed
+/////////////////////////////
+
+typedef struct {
+    prb_alloc_t base;
+    int burst_prb;
+    int normal_prb;
+} prb_alloc_fixed_t;
+
+static void prb_alloc_fixed_run(prb_alloc_t const* a, prb_alloc_batch_t* b) {
+    prb_alloc_fixed_t const* f = (prb_alloc_fixed_t const*)a;
+    size_t bursting = 0;
+    for (size_t i = 0; i < b->len; i++)
+        bursting += b->burst[i];
+    size_t const others = b->len - bursting;
+
+    int burst_prb = f->burst_prb;
+    if (bursting > 0 && (size_t)burst_prb * bursting > (size_t)a->pool)
+        burst_prb = a->pool / (int)bursting;
+    int normal_prb = f->normal_prb;
+    int const left = a->pool - burst_prb * (int)bursting;
+    if (others > 0 && (size_t)normal_prb * others > (size_t)left)
+        normal_prb = left / (int)others;
+
+    for (size_t i = 0; i < b->len; i++)
+        b->prb[i] = b->burst[i] ? burst_prb : normal_prb;
+}
+
+/////////////////////////////
+// pf
+/////////////////////////////
+
+typedef struct {
+    prb_alloc_t base;
+    size_t num_slices;
+    prb_slice_t slice[PRB_ALLOC_MAX_SLICES];
+} prb_alloc_pf_t;
+
+static void prb_alloc_pf_run(prb_alloc_t const* a, prb_alloc_batch_t* b) {
+    prb_alloc_pf_t const* pf = (prb_alloc_pf_t const*)a;
+    size_t const n = b->len;
+
+    // Group the UEs by slice: segment s is [start[s], start[s + 1])
+    size_t start[PRB_ALLOC_MAX_SLICES + 1] = {0};
+    for (size_t i = 0; i < n; i++)
+        start[b->slice[i] + 1]++;
+    for (size_t s = 0; s < PRB_ALLOC_MAX_SLICES; s++)
+        start[s + 1] += start[s];
+    size_t fill[PRB_ALLOC_MAX_SLICES];
+    memcpy(fill, start, sizeof(fill));
+    for (size_t i = 0; i < n; i++) {
+        size_t const j = fill[b->slice[i]]++;
+        float hi = b->demand[i] < b->max_prb[i] ? b->demand[i] : b->max_prb[i];
+        float lo = b->min_prb[i] < hi ? b->min_prb[i] : hi;
+        b->idx[j] = (uint32_t)i;
+        b->w[j] = b->weight[i] > 0 ? b->weight[i] : 1.0f;
+        b->lo[j] = lo;
+        b->hi[j] = hi;
+    }
+
+    // Slice shares, weighted by the UEs in them
+    float sw[PRB_ALLOC_MAX_SLICES], slo[PRB_ALLOC_MAX_SLICES], shi[PRB_ALLOC_MAX_SLICES], sx[PRB_ALLOC_MAX_SLICES];
+    for (size_t s = 0; s < PRB_ALLOC_MAX_SLICES; s++) {
+        size_t const len = start[s + 1] - start[s];
+        float const sum_hi = prb_alloc_sum(len, b->hi + start[s]);
+        float const sum_lo = prb_alloc_sum(len, b->lo + start[s]);
+        float const max = s < pf->num_slices ? (float)pf->slice[s].max_prb : (float)a->pool;
+        float const min = s < pf->num_slices ? (float)pf->slice[s].min_prb : 0;
+        sw[s] = len > 0 ? prb_alloc_sum(len, b->w + start[s]) : 1.0f;
+        shi[s] = sum_hi < max ? sum_hi : max;
+        slo[s] = sum_lo > min ? sum_lo : min;
+        slo[s] = slo[s] < shi[s] ? slo[s] : shi[s];
+    }
+    prb_alloc_waterfill(PRB_ALLOC_MAX_SLICES, sw, slo, shi, (float)a->pool, sx);
+
+    for (size_t s = 0; s < PRB_ALLOC_MAX_SLICES; s++) {
+        size_t const len = start[s + 1] - start[s];
+        if (len > 0)
+            prb_alloc_waterfill(len, b->w + start[s], b->lo + start[s], b->hi + start[s], sx[s], b->x + start[s]);
+    }
+    prb_alloc_round(b, b->idx, b->x, n);
+}
+
+/////////////////////////////
+// Construction
+/////////////////////////////
+
+static inline prb_alloc_t* prb_alloc_linear_open(int pool) {
+    prb_alloc_t* a = calloc(1, sizeof(prb_alloc_t));
+    assert(a != NULL && "Memory exhausted");
+    *a = (prb_alloc_t){"linear", prb_alloc_linear_run, pool};
+    return a;
+}
+
+static inline prb_alloc_t* prb_alloc_fixed_open(int pool, int burst_prb, int normal_prb) {
+    assert(burst_prb >= 0 && normal_prb >= 0);
+    prb_alloc_fixed_t* f = calloc(1, sizeof(prb_alloc_fixed_t));
+    assert(f != NULL && "Memory exhausted");
+    f->base = (prb_alloc_t){"fixed", prb_alloc_fixed_run, pool};
+    f->burst_prb = burst_prb;
+    f->normal_prb = normal_prb;
+    return &f->base;
+}
+
+// Slices past num_slices may take the whole pool
+static inline prb_alloc_t* prb_alloc_pf_open(int pool, prb_slice_t const* slice, size_t num_slices) {
+    assert(num_slices <= PRB_ALLOC_MAX_SLICES);
+    int sum_min = 0;
+    for (size_t s = 0; s < num_slices; s++) {
+        assert(slice[s].min_prb <= slice[s].max_prb);
+        sum_min += slice[s].min_prb;
+    }
+    if (sum_min > pool)
+        XLOG_WARN("[PRB ALLOC]: Slice minimums add up to %d PRBs, more than the pool of %d, scaling them down\n", sum_min, pool);
+
+    prb_alloc_pf_t* pf = calloc(1, sizeof(prb_alloc_pf_t));
+    assert(pf != NULL && "Memory exhausted");
+    pf->base = (prb_alloc_t){"pf", prb_alloc_pf_run, pool};
+    pf->num_slices = num_slices;
+    memcpy(pf->slice, slice, num_slices * sizeof(prb_slice_t));
+    return &pf->base;
+}
+
+static inline void prb_alloc_free(prb_alloc_t* a) {
+    free(a);
+}
+
+// NULL for an unknown name
+static inline prb_alloc_t* prb_alloc_open(char const* name, int pool, int burst_prb, int normal_prb, prb_slice_t const* slice,
+                                          size_t num_slices) {
+    if (strcmp(name, "linear") == 0)
+        return prb_alloc_linear_open(pool);
+    if (strcmp(name, "fixed") == 0)
+        return prb_alloc_fixed_open(pool, burst_prb, normal_prb);
+    if (strcmp(name, "pf") == 0)
+        return prb_alloc_pf_open(pool, slice, num_slices);
+    return NULL;
+}
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef RC_CTRL_TMPL_H
+#define RC_CTRL_TMPL_H
+
+// Reusable RC CONTROL request for "QoS flow mapping configuration"
+// (Radio Bearer Control, O-RAN E2SM-RC 7.6.2.1 / 8.4.2.2).
+//
+// The request tree is built once per E2 node from the RAN function
+// definition the node advertised. A send only patches the DRB ID, QFI and
+// mapping-indicator leaves and points the header at a borrowed UE ID, so
+// no memory is allocated or freed per control. control_sm_xapp_api()
+// encodes the request before it returns, so the tree can be patched again
+// right after.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "../../../../src/sm/rc_sm/ie/ir/ran_param_struct.h"
+#include "../../../../src/sm/rc_sm/ie/ir/ran_param_list.h"
+#include "xlog.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    DRB_QoS_Configuration_7_6_2_1 = 1,
+    QoS_flow_mapping_configuration_7_6_2_1 = 2,
+    Logical_channel_configuration_7_6_2_1 = 3,
+    Radio_admission_control_7_6_2_1 = 4,
+    DRB_termination_control_7_6_2_1 = 5,
+    DRB_split_ratio_control_7_6_2_1 = 6,
+    PDCP_Duplication_control_7_6_2_1 = 7,
+} rc_ctrl_service_style_1_e;
+
+typedef enum {
+    DRB_ID_8_4_2_2 = 1,
+    LIST_OF_QOS_FLOWS_MOD_IN_DRB_8_4_2_2 = 2,
+    QOS_FLOW_ITEM_8_4_2_2 = 3,
+    QOS_FLOW_ID_8_4_2_2 = 4,
+    QOS_FLOW_MAPPING_IND_8_4_2_2 = 5,
+} qos_flow_mapping_conf_e;
+
+typedef struct {
+    rc_ctrl_req_data_t req;
+    // Leaves inside req, patched per send
+    int64_t* drb_id;
+    int64_t* qfi;
+    int64_t* mapping_ind;
+} rc_ctrl_tmpl_t;
+
+static inline ran_parameter_value_t* rc_ctrl_tmpl_int_leaf(void) {
+    ran_parameter_value_t* v = calloc(1, sizeof(ran_parameter_value_t));
+    assert(v != NULL && "Memory exhausted");
+    v->type = INTEGER_RAN_PARAMETER_VALUE;
+    return v;
+}
+
+static inline seq_ran_param_t rc_ctrl_tmpl_drb_id_param(rc_ctrl_tmpl_t* t) {
+    seq_ran_param_t drb_param = {0};
+    drb_param.ran_param_id = DRB_ID_8_4_2_2;
+    drb_param.ran_param_val.type = ELEMENT_KEY_FLAG_TRUE_RAN_PARAMETER_VAL_TYPE;
+    drb_param.ran_param_val.flag_true = rc_ctrl_tmpl_int_leaf();
+    t->drb_id = &drb_param.ran_param_val.flag_true->int_ran;
+    return drb_param;
+}
+
+static inline seq_ran_param_t rc_ctrl_tmpl_qos_flows_param(rc_ctrl_tmpl_t* t) {
+    seq_ran_param_t qos_param = {0};
+    qos_param.ran_param_id = LIST_OF_QOS_FLOWS_MOD_IN_DRB_8_4_2_2;
+    qos_param.ran_param_val.type = LIST_RAN_PARAMETER_VAL_TYPE;
+    qos_param.ran_param_val.lst = calloc(1, sizeof(ran_param_list_t));
+    assert(qos_param.ran_param_val.lst != NULL && "Memory exhausted");
+    ran_param_list_t* rpl = qos_param.ran_param_val.lst;
+    rpl->sz_lst_ran_param = 1;
+    rpl->lst_ran_param = calloc(1, sizeof(lst_ran_param_t));
+    assert(rpl->lst_ran_param != NULL && "Memory exhausted");
+    rpl->lst_ran_param[0].ran_param_struct.sz_ran_param_struct = 2;
+    rpl->lst_ran_param[0].ran_param_struct.ran_param_struct = calloc(2, sizeof(seq_ran_param_t));
+    assert(rpl->lst_ran_param[0].ran_param_struct.ran_param_struct != NULL && "Memory exhausted");
+    seq_ran_param_t* rps = rpl->lst_ran_param[0].ran_param_struct.ran_param_struct;
+    rps[0].ran_param_id = QOS_FLOW_ID_8_4_2_2;
+    rps[0].ran_param_val.type = ELEMENT_KEY_FLAG_TRUE_RAN_PARAMETER_VAL_TYPE;
+    rps[0].ran_param_val.flag_true = rc_ctrl_tmpl_int_leaf();
+    t->qfi = &rps[0].ran_param_val.flag_true->int_ran;
+    rps[1].ran_param_id = QOS_FLOW_MAPPING_IND_8_4_2_2;
+    rps[1].ran_param_val.type = ELEMENT_KEY_FLAG_FALSE_RAN_PARAMETER_VAL_TYPE;
+    rps[1].ran_param_val.flag_false = rc_ctrl_tmpl_int_leaf();
+    t->mapping_ind = &rps[1].ran_param_val.flag_false->int_ran;
+    return qos_param;
+}
+
+// Builds the request skeleton for the control style and action ran_func
+// offers. Asserts on anything other than Radio Bearer Control / QoS flow
+// mapping configuration, as sending it would.
+static inline void rc_ctrl_tmpl_init(rc_ctrl_tmpl_t* t, ran_func_def_ctrl_t const* ran_func) {
+    assert(t != NULL && ran_func != NULL);
+    memset(t, 0, sizeof(*t));
+    rc_ctrl_req_data_t* rc_ctrl = &t->req;
+    for (size_t i = 0; i < ran_func->sz_seq_ctrl_style; i++) {
+        seq_ctrl_style_t const* style = &ran_func->seq_ctrl_style[i];
+        assert(cmp_str_ba("Radio Bearer Control", style->name) == 0 && "Add requested CONTROL Style");
+        rc_ctrl->hdr.format = style->hdr;
+        assert(rc_ctrl->hdr.format == FORMAT_1_E2SM_RC_CTRL_HDR && "Indication Header Format received not valid");
+        rc_ctrl->hdr.frmt_1.ric_style_type = 1;
+        rc_ctrl->msg.format = style->msg;
+        assert(rc_ctrl->msg.format == FORMAT_1_E2SM_RC_CTRL_MSG && "Indication Message Format received not valid");
+
+        assert(style->seq_ctrl_act != NULL);
+        for (size_t j = 0; j < style->sz_seq_ctrl_act; j++) {
+            seq_ctrl_act_2_t const* act = &style->seq_ctrl_act[j];
+            assert(cmp_str_ba("QoS flow mapping configuration", act->name) == 0 && "Add requested CONTROL Action");
+            rc_ctrl->hdr.frmt_1.ctrl_act_id = QoS_flow_mapping_configuration_7_6_2_1;
+            e2sm_rc_ctrl_msg_frmt_1_t* msg = &rc_ctrl->msg.frmt_1;
+            assert(act->sz_seq_assoc_ran_param == 2);
+            assert(msg->ran_param == NULL && "One CONTROL Action per request");
+            msg->sz_ran_param = act->sz_seq_assoc_ran_param;
+            msg->ran_param = calloc(msg->sz_ran_param, sizeof(seq_ran_param_t));
+            assert(msg->ran_param != NULL && "Memory exhausted");
+            assert(act->assoc_ran_param[0].id == DRB_ID_8_4_2_2);
+            msg->ran_param[0] = rc_ctrl_tmpl_drb_id_param(t);
+            assert(act->assoc_ran_param[1].id == LIST_OF_QOS_FLOWS_MOD_IN_DRB_8_4_2_2);
+            msg->ran_param[1] = rc_ctrl_tmpl_qos_flows_param(t);
+        }
+    }
+    assert(t->drb_id != NULL && "RAN function offers no CONTROL Action");
+}
+
+// ue_id is borrowed and must stay valid until the request is sent
+static inline rc_ctrl_req_data_t* rc_ctrl_tmpl_patch(rc_ctrl_tmpl_t* t, ue_id_e2sm_t const* ue_id, int drb_id, int qfi, int mapping_ind) {
+    t->req.hdr.frmt_1.ue_id = *ue_id;
+    *t->drb_id = drb_id;
+    *t->qfi = qfi;
+    *t->mapping_ind = mapping_ind;
+    XLOG_TRACE("Allocating DRB ID = %d\n", drb_id);
+    XLOG_TRACE("Allocating QFI = %d\n", qfi);
+    XLOG_TRACE("Allocating Mapping Ind = %d (UL)\n", mapping_ind);
+    return &t->req;
+}
+
+static inline void rc_ctrl_tmpl_free(rc_ctrl_tmpl_t* t) {
+    if (t->drb_id == NULL)
+        return;
+    // The UE ID is borrowed, not owned by the tree
+    memset(&t->req.hdr.frmt_1.ue_id, 0, sizeof(t->req.hdr.frmt_1.ue_id));
+    free_rc_ctrl_req_data(&t->req);
+    memset(t, 0, sizeof(*t));
+}
+
+#endif
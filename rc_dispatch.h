@@ -0,0 +1,250 @@
+#ifndef RC_DISPATCH_H
+#define RC_DISPATCH_H
+
+// Pipelined RC CONTROL sender for one E2 node.
+//
+// control_sm_xapp_api() blocks until the node answers, so sending one UE
+// after the other costs a full round trip per UE. The dispatcher keeps up
+// to `window` requests in flight instead: `window` sender threads, each
+// with its own request template, take jobs from a bounded queue. A token
+// bucket caps the send rate at what the node can take, and a burst of
+// controls after a transition is timed against the report period.
+//
+// Jobs are submitted by one thread (the shard worker). on_done runs on a
+// sender thread with the dispatcher lock held, so completions are
+// serialized and may feed a single-producer ring. It gets the job's
+// send-to-answer time on the monotonic clock.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "../../../../src/util/time_now_us.h"
+#include "node_shard.h"
+#include "rc_ctrl_tmpl.h"
+#include "ue_id_flat.h"
+#include "lat_hist.h"
+#include "xlog.h"
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    ue_id_flat_t ue_id;
+    uint64_t ran_ue_id;
+    int drb_id;
+    int qfi;
+    int mapping_ind;
+    int64_t detect_us;  // Burst detection time, 0 when not burst triggered
+} rc_ctrl_job_t;
+
+typedef void (*rc_dispatch_done_fn)(void* arg, rc_ctrl_job_t const* job, bool acked, int64_t now, int64_t rtt_ns);
+
+typedef struct rc_dispatch_s rc_dispatch_t;
+
+typedef struct {
+    rc_dispatch_t* d;
+    rc_ctrl_tmpl_t tmpl;
+    pthread_t thread;
+} rc_dispatch_sender_t;
+
+struct rc_dispatch_s {
+    global_e2_node_id_t* node_id;
+    size_t shard;
+    int64_t batch_budget_us;  // A batch taking longer is reported
+
+    pthread_mutex_t mtx;
+    pthread_cond_t has_job;
+    pthread_cond_t has_space;
+    rc_ctrl_job_t* job;
+    size_t cap;
+    size_t head;  // Next job to send
+    size_t len;   // Queued, not yet sent
+    size_t in_flight;
+    bool stop;
+
+    // Token bucket
+    double rate_per_us;
+    double burst;
+    double tokens;
+    int64_t refill_us;
+
+    size_t window;
+    rc_dispatch_sender_t* sender;
+
+    rc_dispatch_done_fn on_done;
+    void* on_done_arg;
+
+    uint64_t sent;
+    uint64_t acked;
+    uint64_t failed;
+    int64_t batch_start_us;
+    size_t batch_len;
+};
+
+// Microseconds until a token is available, 0 after taking one
+static inline int64_t rc_dispatch_take_token(rc_dispatch_t* d, int64_t now) {
+    d->tokens += (now - d->refill_us) * d->rate_per_us;
+    if (d->tokens > d->burst)
+        d->tokens = d->burst;
+    d->refill_us = now;
+    if (d->tokens >= 1.0) {
+        d->tokens -= 1.0;
+        return 0;
+    }
+    return (int64_t)((1.0 - d->tokens) / d->rate_per_us) + 1;
+}
+
+static inline void rc_dispatch_batch_done(rc_dispatch_t* d, int64_t now) {
+    int64_t const took = now - d->batch_start_us;
+    if (took > d->batch_budget_us)
+        XLOG_WARN("[RC DISPATCH %zu]: %zu controls took %ld [μs], over the %ld [μs] report period\n", d->shard, d->batch_len, took, d->batch_budget_us);
+    else
+        XLOG_INFO("[RC DISPATCH %zu]: %zu controls in %ld [μs] (acked %lu, failed %lu in total)\n", d->shard, d->batch_len, took, d->acked, d->failed);
+    d->batch_len = 0;
+}
+
+// The report period changed
+static inline void rc_dispatch_set_budget(rc_dispatch_t* d, int64_t batch_budget_us) {
+    pthread_mutex_lock(&d->mtx);
+    d->batch_budget_us = batch_budget_us;
+    pthread_mutex_unlock(&d->mtx);
+}
+
+static void* rc_dispatch_sender(void* arg) {
+    rc_dispatch_sender_t* snd = arg;
+    rc_dispatch_t* d = snd->d;
+    const int RC_ran_function = 3;
+    node_shard_pin_self(d->shard);
+
+    pthread_mutex_lock(&d->mtx);
+    for (;;) {
+        while (!d->stop && d->len == 0)
+            pthread_cond_wait(&d->has_job, &d->mtx);
+        if (d->len == 0)
+            break;  // Stopping, queue drained
+
+        int64_t const wait_us = rc_dispatch_take_token(d, time_now_us());
+        if (wait_us > 0) {
+            pthread_mutex_unlock(&d->mtx);
+            struct timespec const ts = {.tv_sec = wait_us / 1000000, .tv_nsec = (wait_us % 1000000) * 1000};
+            nanosleep(&ts, NULL);
+            pthread_mutex_lock(&d->mtx);
+            continue;
+        }
+
+        rc_ctrl_job_t const job = d->job[d->head];
+        d->head = (d->head + 1) % d->cap;
+        d->len--;
+        d->in_flight++;
+        d->sent++;
+        pthread_cond_signal(&d->has_space);
+        pthread_mutex_unlock(&d->mtx);
+
+        ue_id_flat_t ue_id = job.ue_id;
+        ue_id_e2sm_t const target_ue_id = ue_id_flat_view(&ue_id);
+        rc_ctrl_req_data_t* req = rc_ctrl_tmpl_patch(&snd->tmpl, &target_ue_id, job.drb_id, job.qfi, job.mapping_ind);
+        int64_t const sent_ns = lat_hist_now_ns();
+        sm_ans_xapp_t const ans = control_sm_xapp_api(d->node_id, RC_ran_function, req);
+        int64_t const rtt_ns = lat_hist_now_ns() - sent_ns;
+        int64_t const now = time_now_us();
+
+        pthread_mutex_lock(&d->mtx);
+        d->in_flight--;
+        if (ans.success) {
+            d->acked++;
+        } else {
+            d->failed++;
+            XLOG_WARN("[RC DISPATCH %zu]: CONTROL for UE (RAN UE ID %lu) failed\n", d->shard, job.ran_ue_id);
+        }
+        if (d->on_done != NULL)
+            d->on_done(d->on_done_arg, &job, ans.success, now, rtt_ns);
+        if (d->len == 0 && d->in_flight == 0 && d->batch_len > 0)
+            rc_dispatch_batch_done(d, now);
+    }
+    pthread_mutex_unlock(&d->mtx);
+    return NULL;
+}
+
+// window: requests in flight; rate_per_s, burst: token bucket of the node;
+// queue_len: jobs waiting for a sender before rc_dispatch_submit() blocks
+static inline void rc_dispatch_init(rc_dispatch_t* d, size_t shard, global_e2_node_id_t* node_id, ran_func_def_ctrl_t const* ran_func,
+                                    size_t window, double rate_per_s, double burst, size_t queue_len, int64_t batch_budget_us) {
+    assert(d != NULL && node_id != NULL && ran_func != NULL);
+    assert(window > 0 && rate_per_s > 0 && burst >= 1 && queue_len > 0);
+    memset(d, 0, sizeof(*d));
+    d->node_id = node_id;
+    d->shard = shard;
+    d->batch_budget_us = batch_budget_us;
+
+    pthread_mutexattr_t attr = {0};
+    int rc = pthread_mutex_init(&d->mtx, &attr);
+    assert(rc == 0);
+    rc = pthread_cond_init(&d->has_job, NULL);
+    assert(rc == 0);
+    rc = pthread_cond_init(&d->has_space, NULL);
+    assert(rc == 0);
+
+    d->cap = queue_len;
+    d->job = calloc(queue_len, sizeof(rc_ctrl_job_t));
+    assert(d->job != NULL && "Memory exhausted");
+
+    d->rate_per_us = rate_per_s / 1e6;
+    d->burst = burst;
+    d->tokens = burst;
+    d->refill_us = time_now_us();
+
+    d->window = window;
+    d->sender = calloc(window, sizeof(rc_dispatch_sender_t));
+    assert(d->sender != NULL && "Memory exhausted");
+    for (size_t i = 0; i < window; i++) {
+        d->sender[i].d = d;
+        rc_ctrl_tmpl_init(&d->sender[i].tmpl, ran_func);
+        rc = pthread_create(&d->sender[i].thread, NULL, rc_dispatch_sender, &d->sender[i]);
+        assert(rc == 0);
+    }
+}
+
+static inline void rc_dispatch_on_done(rc_dispatch_t* d, rc_dispatch_done_fn fn, void* arg) {
+    pthread_mutex_lock(&d->mtx);
+    d->on_done = fn;
+    d->on_done_arg = arg;
+    pthread_mutex_unlock(&d->mtx);
+}
+
+// Blocks while the queue is full
+static inline void rc_dispatch_submit(rc_dispatch_t* d, rc_ctrl_job_t const* job) {
+    pthread_mutex_lock(&d->mtx);
+    while (d->len == d->cap)
+        pthread_cond_wait(&d->has_space, &d->mtx);
+    if (d->len == 0 && d->in_flight == 0 && d->batch_len == 0)
+        d->batch_start_us = time_now_us();
+    d->job[(d->head + d->len) % d->cap] = *job;
+    d->len++;
+    d->batch_len++;
+    pthread_cond_signal(&d->has_job);
+    pthread_mutex_unlock(&d->mtx);
+}
+
+// Sends what is queued, then stops the senders
+static inline void rc_dispatch_free(rc_dispatch_t* d) {
+    if (d->sender == NULL)
+        return;
+    pthread_mutex_lock(&d->mtx);
+    d->stop = true;
+    pthread_cond_broadcast(&d->has_job);
+    pthread_mutex_unlock(&d->mtx);
+    for (size_t i = 0; i < d->window; i++) {
+        pthread_join(d->sender[i].thread, NULL);
+        rc_ctrl_tmpl_free(&d->sender[i].tmpl);
+    }
+    free(d->sender);
+    free(d->job);
+    pthread_cond_destroy(&d->has_job);
+    pthread_cond_destroy(&d->has_space);
+    pthread_mutex_destroy(&d->mtx);
+    memset(d, 0, sizeof(*d));
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+// Single-writer / single-reader snapshot exchange over three buffers.
+// The writer fills its back buffer and publishes it with one atomic
+// exchange. The reader takes the newest published buffer with another one.
+// Neither side ever waits for the other, and a buffer held by one side is
+// never touched by the other until it is handed back. Intermediate
+// snapshots the reader did not pick up are simply overwritten.
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_IDX_MASK 0x3u
+#define SNAPSHOT_FRESH 0x4u
+
+typedef struct {
+    void* buf[3];
+    uint32_t back;          // Owned by the writer
+    uint32_t front;         // Owned by the reader
+    _Atomic uint32_t mid;   // In transit, SNAPSHOT_FRESH until the reader takes it
+} snapshot_t;
+
+static inline void snapshot_init(snapshot_t* s, void* b0, void* b1, void* b2) {
+    assert(s != NULL && b0 != NULL && b1 != NULL && b2 != NULL);
+    s->buf[0] = b0;
+    s->buf[1] = b1;
+    s->buf[2] = b2;
+    s->back = 0;
+    s->front = 2;
+    atomic_init(&s->mid, 1);
+}
+
+// Writer side: the buffer to fill. It may hold an older snapshot, so the
+// writer rebuilds it completely before publishing.
+static inline void* snapshot_back(snapshot_t* s) {
+    return s->buf[s->back];
+}
+
+static inline void snapshot_publish(snapshot_t* s) {
+    uint32_t const prev = atomic_exchange_explicit(&s->mid, s->back | SNAPSHOT_FRESH, memory_order_acq_rel);
+    s->back = prev & SNAPSHOT_IDX_MASK;
+}
+
+// Reader side: the newest published buffer. It stays valid, and unchanged,
+// until the next call.
+static inline void* snapshot_acquire(snapshot_t* s) {
+    if (atomic_load_explicit(&s->mid, memory_order_relaxed) & SNAPSHOT_FRESH) {
+        uint32_t const prev = atomic_exchange_explicit(&s->mid, s->front, memory_order_acq_rel);
+        s->front = prev & SNAPSHOT_IDX_MASK;
+    }
+    return s->buf[s->front];
+}
+
+#endif
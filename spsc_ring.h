@@ -0,0 +1,94 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+// Bounded lock-free ring for exactly one producer thread and one consumer
+// thread. Elements are fixed-size and copied in and out. Each side caches
+// the other side's index, so the shared cache lines are only touched when
+// the cached view says the ring looks full (producer) or empty (consumer).
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPSC_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(SPSC_CACHE_LINE) _Atomic size_t head;  // Next slot to write
+    size_t cached_tail;                              // Producer's view of tail
+
+    _Alignas(SPSC_CACHE_LINE) _Atomic size_t tail;  // Next slot to read
+    size_t cached_head;                              // Consumer's view of head
+
+    _Alignas(SPSC_CACHE_LINE) size_t mask;
+    size_t elem_sz;
+    uint8_t* buf;
+} spsc_ring_t;
+
+// cap is rounded up to a power of two
+static inline void spsc_ring_init(spsc_ring_t* r, size_t elem_sz, size_t cap) {
+    assert(r != NULL && elem_sz > 0 && cap > 0);
+    size_t n = 1;
+    while (n < cap)
+        n <<= 1;
+    memset(r, 0, sizeof(*r));
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->mask = n - 1;
+    r->elem_sz = elem_sz;
+    r->buf = calloc(n, elem_sz);
+    assert(r->buf != NULL && "Memory exhausted");
+}
+
+static inline void spsc_ring_free(spsc_ring_t* r) {
+    free(r->buf);
+    r->buf = NULL;
+}
+
+static inline size_t spsc_ring_cap(spsc_ring_t const* r) {
+    return r->mask + 1;
+}
+
+// Producer side. Returns false, without blocking, when the ring is full.
+static inline bool spsc_ring_push(spsc_ring_t* r, void const* elem) {
+    size_t const head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    if (head - r->cached_tail > r->mask) {
+        r->cached_tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+        if (head - r->cached_tail > r->mask)
+            return false;
+    }
+    memcpy(r->buf + (head & r->mask) * r->elem_sz, elem, r->elem_sz);
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+// Consumer side. The oldest element, or NULL when empty. It stays valid
+// until spsc_ring_pop().
+static inline void* spsc_ring_peek(spsc_ring_t* r) {
+    size_t const tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    if (tail == r->cached_head) {
+        r->cached_head = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (tail == r->cached_head)
+            return NULL;
+    }
+    return r->buf + (tail & r->mask) * r->elem_sz;
+}
+
+static inline void spsc_ring_pop(spsc_ring_t* r) {
+    size_t const tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+}
+
+static inline bool spsc_ring_pop_into(spsc_ring_t* r, void* out) {
+    void const* elem = spsc_ring_peek(r);
+    if (elem == NULL)
+        return false;
+    memcpy(out, elem, r->elem_sz);
+    spsc_ring_pop(r);
+    return true;
+}
+
+#endif
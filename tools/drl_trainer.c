@@ -0,0 +1,503 @@
+// Online trainer of the drl policy (policy_drl.c). Learns from the
+// experience the xApp writes to shared memory (drl_exp_shm, see drl_exp.h)
+// and rewrites the network the xApp runs (drl_model), which the xApp loads
+// within 100 ms, off its indication path. Neither waits for the other.
+//
+// Build: gcc -O2 -o drl_trainer tools/drl_trainer.c -lm
+// Usage: drl_trainer [--shm /name] [--init in.drl] [--hidden N] [--gamma G] [--lr LR] [--batch B] [--ratio R]
+//                    [--target-steps N] [--save-ms MS] [--warmup N] [--seed S] model.drl
+//
+// Double DQN: outputs 0 and 1 of the network are the values of mMTC and
+// URLLC, learnt with a Huber loss against r + gamma * Q'(s2, argmax Q(s2)),
+// Q' a copy of the network refreshed every --target-steps steps. The ring
+// is the replay memory: minibatches are sampled from it in place, so the
+// trainer keeps no experience of its own. --ratio bounds the steps per new
+// experience, the trainer sleeps once they are spent.
+//
+// Without --init the network is in -> hidden -> hidden -> 2, ReLU, and the
+// input normalization is taken from the first --warmup experiences. A
+// third output of an --init network, the PRB demand, is not trained.
+//
+// The trainer may start before the xApp, and follows it across restarts.
+// SIGINT or SIGTERM saves the network one last time.
+
+#include "../drl_exp.h"
+#include "../drl_net.h"
+#include <math.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TRAINER_HUBER 1.0f
+#define TRAINER_ADAM_B1 0.9f
+#define TRAINER_ADAM_B2 0.999f
+#define TRAINER_ADAM_EPS 1e-8f
+#define TRAINER_IDLE_NS 10000000LL      // Sleep while out of steps
+#define TRAINER_ATTACH_NS 1000000000LL  // Between checks for a new ring
+
+typedef struct {
+    char const* shm;
+    char const* init;
+    char const* model;
+    uint32_t hidden;
+    float gamma;
+    float lr;
+    uint32_t batch;
+    double ratio;
+    uint64_t target_steps;
+    int64_t save_ms;
+    uint64_t warmup;
+    uint64_t seed;
+} opts_t;
+
+// Gradient and Adam moments of one weight or bias array
+typedef struct {
+    float* p;
+    float* g;
+    float* m;
+    float* v;
+    size_t n;
+} param_t;
+
+typedef struct {
+    drl_net_t net;
+    drl_net_t target;
+    param_t param[2 * DRL_NET_MAX_LAYERS];
+    size_t num_param;
+    uint64_t t;  // Adam steps
+    // Per layer input and output of the sample being learnt, and the
+    // gradient flowing back
+    float act[DRL_NET_MAX_LAYERS + 1][DRL_NET_MAX_WIDTH];
+    float grad[2][DRL_NET_MAX_WIDTH];
+} learner_t;
+
+typedef struct {
+    uint64_t steps;
+    uint64_t samples;
+    uint64_t torn;  // Overwritten while read, or not there
+    double loss;
+    double q;
+    uint64_t urllc;
+} stats_t;
+
+static volatile sig_atomic_t stop;
+
+static void on_signal(int sig) {
+    (void)sig;
+    stop = 1;
+}
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [--shm /name] [--init in.drl] [--hidden N] [--gamma G] [--lr LR] [--batch B] [--ratio R] "
+            "[--target-steps N] [--save-ms MS] [--warmup N] [--seed S] model.drl\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void sleep_ns(int64_t ns) {
+    struct timespec const ts = {ns / 1000000000, ns % 1000000000};
+    nanosleep(&ts, NULL);
+}
+
+// xorshift64*
+static uint64_t rnd(uint64_t* s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545f4914f6cdd1dULL;
+}
+
+static float rnd_normal(uint64_t* s) {
+    float const u1 = ((float)(rnd(s) >> 40) + 1.0f) / (float)(1u << 24);
+    float const u2 = (float)(rnd(s) >> 40) / (float)(1u << 24);
+    return sqrtf(-2.0f * logf(u1)) * cosf(6.2831853f * u2);
+}
+
+static float* zeros(size_t n) {
+    float* v = calloc(n, sizeof(float));
+    assert(v != NULL && "Memory exhausted");
+    return v;
+}
+
+// in -> hidden -> hidden -> 2, He initialized
+static void net_fresh(drl_net_t* net, uint32_t inputs, uint32_t hidden, uint64_t* rng) {
+    memset(net, 0, sizeof(*net));
+    uint32_t const dims[4] = {inputs, hidden, hidden, 2};
+    net->inputs = inputs;
+    net->outputs = 2;
+    net->num_layers = 3;
+    net->max_width = inputs > hidden ? inputs : hidden;
+    net->mean = zeros(inputs);
+    net->scale = zeros(inputs);
+    for (uint32_t k = 0; k < 3; k++) {
+        drl_layer_t* l = &net->layer[k];
+        l->in = dims[k];
+        l->out = dims[k + 1];
+        l->act = k < 2 ? DRL_ACT_RELU : DRL_ACT_LINEAR;
+        l->w = zeros((size_t)l->in * l->out);
+        l->b = zeros(l->out);
+        float const sd = sqrtf(2.0f / (float)l->in);
+        for (size_t i = 0; i < (size_t)l->in * l->out; i++)
+            l->w[i] = sd * rnd_normal(rng);
+    }
+}
+
+// Same shape as src, its weights copied by net_copy()
+static void net_clone(drl_net_t* dst, drl_net_t const* src) {
+    memset(dst, 0, sizeof(*dst));
+    dst->inputs = src->inputs;
+    dst->outputs = src->outputs;
+    dst->num_layers = src->num_layers;
+    dst->max_width = src->max_width;
+    dst->mean = zeros(src->inputs);
+    dst->scale = zeros(src->inputs);
+    for (uint32_t k = 0; k < src->num_layers; k++) {
+        dst->layer[k] = src->layer[k];
+        dst->layer[k].w = zeros((size_t)src->layer[k].in * src->layer[k].out);
+        dst->layer[k].b = zeros(src->layer[k].out);
+    }
+}
+
+static void net_copy(drl_net_t* dst, drl_net_t const* src) {
+    memcpy(dst->mean, src->mean, src->inputs * sizeof(float));
+    memcpy(dst->scale, src->scale, src->inputs * sizeof(float));
+    for (uint32_t k = 0; k < src->num_layers; k++) {
+        drl_layer_t const* l = &src->layer[k];
+        memcpy(dst->layer[k].w, l->w, (size_t)l->in * l->out * sizeof(float));
+        memcpy(dst->layer[k].b, l->b, l->out * sizeof(float));
+    }
+}
+
+static void learner_init(learner_t* lr) {
+    net_clone(&lr->target, &lr->net);
+    net_copy(&lr->target, &lr->net);
+    for (uint32_t k = 0; k < lr->net.num_layers; k++) {
+        drl_layer_t* l = &lr->net.layer[k];
+        size_t const n[2] = {(size_t)l->in * l->out, l->out};
+        float* const p[2] = {l->w, l->b};
+        for (int j = 0; j < 2; j++)
+            lr->param[lr->num_param++] = (param_t){p[j], zeros(n[j]), zeros(n[j]), zeros(n[j]), n[j]};
+    }
+}
+
+// Network outputs for the raw features s, every layer's output kept in act
+static float const* forward(drl_net_t const* net, float const* s, float act[][DRL_NET_MAX_WIDTH]) {
+    for (uint32_t i = 0; i < net->inputs; i++)
+        act[0][i] = (s[i] - net->mean[i]) * net->scale[i];
+    for (uint32_t k = 0; k < net->num_layers; k++) {
+        drl_layer_t const* l = &net->layer[k];
+        for (uint32_t o = 0; o < l->out; o++) {
+            float const* w = l->w + (size_t)o * l->in;
+            float z = l->b[o];
+            for (uint32_t i = 0; i < l->in; i++)
+                z += w[i] * act[k][i];
+            if (l->act == DRL_ACT_RELU)
+                z = z > 0 ? z : 0;
+            else if (l->act == DRL_ACT_TANH)
+                z = tanhf(z);
+            act[k + 1][o] = z;
+        }
+    }
+    return act[net->num_layers];
+}
+
+// Adds the gradient of d(loss)/d(output a) = g to the parameters', from the
+// activations forward() left in lr->act
+static void backward(learner_t* lr, uint32_t a, float g) {
+    drl_net_t const* net = &lr->net;
+    float* gy = lr->grad[0];
+    float* gx = lr->grad[1];
+    memset(gy, 0, net->outputs * sizeof(float));
+    gy[a] = g;
+    for (uint32_t k = net->num_layers; k-- > 0;) {
+        drl_layer_t const* l = &net->layer[k];
+        float const* x = lr->act[k];
+        float const* y = lr->act[k + 1];
+        if (l->act == DRL_ACT_RELU) {
+            for (uint32_t o = 0; o < l->out; o++)
+                gy[o] = y[o] > 0 ? gy[o] : 0;
+        } else if (l->act == DRL_ACT_TANH) {
+            for (uint32_t o = 0; o < l->out; o++)
+                gy[o] *= 1 - y[o] * y[o];
+        }
+        float* gw = lr->param[2 * k].g;
+        float* gb = lr->param[2 * k + 1].g;
+        memset(gx, 0, l->in * sizeof(float));
+        for (uint32_t o = 0; o < l->out; o++) {
+            if (gy[o] == 0)
+                continue;
+            float const* w = l->w + (size_t)o * l->in;
+            float* gwo = gw + (size_t)o * l->in;
+            for (uint32_t i = 0; i < l->in; i++) {
+                gwo[i] += gy[o] * x[i];
+                gx[i] += gy[o] * w[i];
+            }
+            gb[o] += gy[o];
+        }
+        float* t = gy;
+        gy = gx;
+        gx = t;
+    }
+}
+
+static void adam(learner_t* lr, float rate, uint32_t n) {
+    lr->t++;
+    float const c1 = 1 - powf(TRAINER_ADAM_B1, (float)lr->t);
+    float const c2 = 1 - powf(TRAINER_ADAM_B2, (float)lr->t);
+    for (size_t j = 0; j < lr->num_param; j++) {
+        param_t* p = &lr->param[j];
+        for (size_t i = 0; i < p->n; i++) {
+            float const g = p->g[i] / (float)n;
+            p->m[i] = TRAINER_ADAM_B1 * p->m[i] + (1 - TRAINER_ADAM_B1) * g;
+            p->v[i] = TRAINER_ADAM_B2 * p->v[i] + (1 - TRAINER_ADAM_B2) * g * g;
+            p->p[i] -= rate * (p->m[i] / c1) / (sqrtf(p->v[i] / c2) + TRAINER_ADAM_EPS);
+        }
+        memset(p->g, 0, p->n * sizeof(float));
+    }
+}
+
+// Index of a random experience still in the ring. The oldest 1/16 are left
+// out, producers are about to overwrite them.
+static uint64_t sample_idx(drl_exp_ring_t const* r, uint64_t head, uint64_t* rng) {
+    uint64_t const cap = r->mask + 1;
+    uint64_t const span = head < cap - cap / 16 ? head : cap - cap / 16;
+    return head - 1 - rnd(rng) % span;
+}
+
+// Normalization from the experiences in the ring
+static void normalize(drl_net_t* net, drl_exp_ring_t const* r, uint64_t head) {
+    uint32_t const n_in = net->inputs;
+    double sum[DRL_EXP_MAX_FEAT] = {0};
+    double sq[DRL_EXP_MAX_FEAT] = {0};
+    uint64_t n = 0;
+    uint64_t const cap = r->mask + 1;
+    for (uint64_t idx = head > cap / 2 ? head - cap / 2 : 0; idx < head; idx++) {
+        drl_exp_t const* e = drl_exp_get(r, idx);
+        if (e == NULL)
+            continue;
+        float s[DRL_EXP_MAX_FEAT];
+        memcpy(s, e->s, sizeof(s));
+        if (!drl_exp_intact(e, idx))
+            continue;
+        for (uint32_t i = 0; i < n_in; i++) {
+            sum[i] += s[i];
+            sq[i] += (double)s[i] * s[i];
+        }
+        n++;
+    }
+    for (uint32_t i = 0; i < n_in; i++) {
+        double const mean = n > 0 ? sum[i] / (double)n : 0;
+        double const var = n > 0 ? sq[i] / (double)n - mean * mean : 0;
+        net->mean[i] = (float)mean;
+        net->scale[i] = var > 1e-12 ? (float)(1 / sqrt(var)) : 1.0f;
+    }
+}
+
+// One minibatch
+static void step(learner_t* lr, opts_t const* o, drl_exp_ring_t const* r, uint64_t* rng, stats_t* st) {
+    static float target_act[DRL_NET_MAX_LAYERS + 1][DRL_NET_MAX_WIDTH];
+    uint64_t const head = drl_exp_head(r);
+    uint32_t n = 0;
+    for (uint32_t tries = 0; n < o->batch && tries < 4 * o->batch; tries++) {
+        uint64_t const idx = sample_idx(r, head, rng);
+        drl_exp_t const* e = drl_exp_get(r, idx);
+        if (e == NULL) {
+            st->torn++;
+            continue;
+        }
+        float s[DRL_EXP_MAX_FEAT];
+        float s2[DRL_EXP_MAX_FEAT];
+        memcpy(s, e->s, sizeof(s));
+        memcpy(s2, e->s2, sizeof(s2));
+        float const reward = e->reward;
+        uint32_t const action = e->action;
+        if (!drl_exp_intact(e, idx) || action > 1 || !isfinite(reward)) {
+            st->torn++;
+            continue;
+        }
+        // Double DQN target
+        float const* q2 = forward(&lr->net, s2, lr->act);
+        uint32_t const best = q2[1] > q2[0];
+        float const y = reward + o->gamma * forward(&lr->target, s2, target_act)[best];
+
+        float const* q = forward(&lr->net, s, lr->act);
+        float const d = q[action] - y;
+        float const g = d > TRAINER_HUBER ? TRAINER_HUBER : d < -TRAINER_HUBER ? -TRAINER_HUBER : d;
+        st->loss += fabsf(d) <= TRAINER_HUBER ? 0.5 * d * d : TRAINER_HUBER * (fabsf(d) - 0.5 * TRAINER_HUBER);
+        st->q += q[action];
+        st->urllc += q[1] > q[0];
+        backward(lr, action, g);
+        n++;
+    }
+    if (n == 0)
+        return;
+    adam(lr, o->lr, n);
+    st->samples += n;
+    st->steps++;
+    if (st->steps % o->target_steps == 0)
+        net_copy(&lr->target, &lr->net);
+}
+
+static void report(stats_t* st, uint64_t head, uint64_t fresh, int64_t dt_ns) {
+    double const n = st->samples > 0 ? (double)st->samples : 1;
+    fprintf(stderr, "[TRAINER]: %lu steps, %.0f experiences/s, loss %.4f, mean Q %.3f, URLLC %.1f%%, %lu torn, ring at %lu\n",
+            st->steps, (double)fresh * 1e9 / (double)dt_ns, st->loss / n, st->q / n, 100.0 * (double)st->urllc / n, st->torn,
+            head);
+    st->loss = 0;
+    st->q = 0;
+    st->urllc = 0;
+    st->samples = 0;
+    st->torn = 0;
+}
+
+// Blocks until o->shm exists, or a signal
+static bool attach(drl_exp_ring_t* r, opts_t const* o) {
+    fprintf(stderr, "[TRAINER]: Waiting for %s\n", o->shm);
+    while (!stop) {
+        if (drl_exp_attach(r, o->shm)) {
+            fprintf(stderr, "[TRAINER]: Attached to %s, %lu entries of %u features, %lu written\n", o->shm,
+                    (unsigned long)(r->mask + 1), r->hdr->num_feat, (unsigned long)drl_exp_head(r));
+            return true;
+        }
+        sleep_ns(TRAINER_ATTACH_NS);
+    }
+    return false;
+}
+
+int main(int argc, char* argv[]) {
+    opts_t o = {
+        .shm = "/xapp_drl_exp",
+        .hidden = 64,
+        .gamma = 0.9f,
+        .lr = 1e-3f,
+        .batch = 64,
+        .ratio = 4,
+        .target_steps = 500,
+        .save_ms = 10000,
+        .warmup = 1000,
+        .seed = 1,
+    };
+    for (int i = 1; i < argc; i++) {
+        char const* a = argv[i];
+        bool const has_val = i + 1 < argc;
+        if (strcmp(a, "--shm") == 0 && has_val)
+            o.shm = argv[++i];
+        else if (strcmp(a, "--init") == 0 && has_val)
+            o.init = argv[++i];
+        else if (strcmp(a, "--hidden") == 0 && has_val)
+            o.hidden = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(a, "--gamma") == 0 && has_val)
+            o.gamma = (float)atof(argv[++i]);
+        else if (strcmp(a, "--lr") == 0 && has_val)
+            o.lr = (float)atof(argv[++i]);
+        else if (strcmp(a, "--batch") == 0 && has_val)
+            o.batch = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(a, "--ratio") == 0 && has_val)
+            o.ratio = atof(argv[++i]);
+        else if (strcmp(a, "--target-steps") == 0 && has_val)
+            o.target_steps = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--save-ms") == 0 && has_val)
+            o.save_ms = atoll(argv[++i]);
+        else if (strcmp(a, "--warmup") == 0 && has_val)
+            o.warmup = strtoull(argv[++i], NULL, 0);
+        else if (strcmp(a, "--seed") == 0 && has_val)
+            o.seed = strtoull(argv[++i], NULL, 0);
+        else if (a[0] == '-' || o.model != NULL)
+            usage(argv[0]);
+        else
+            o.model = a;
+    }
+    if (o.model == NULL || o.hidden == 0 || o.hidden > DRL_NET_MAX_WIDTH || o.batch == 0 || o.target_steps == 0 || o.ratio <= 0
+        || o.save_ms <= 0 || !(o.gamma >= 0 && o.gamma < 1) || !(o.lr > 0))
+        usage(argv[0]);
+    uint64_t rng = o.seed != 0 ? o.seed : 1;
+
+    struct sigaction sa = {0};
+    sa.sa_handler = on_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    drl_exp_ring_t ring;
+    if (!attach(&ring, &o))
+        return EXIT_SUCCESS;
+
+    static learner_t lr;
+    bool ready = false;  // Network set up
+    if (o.init != NULL) {
+        if (!drl_net_load(&lr.net, o.init))
+            return EXIT_FAILURE;
+        if (lr.net.inputs > ring.hdr->num_feat || lr.net.outputs < 2) {
+            fprintf(stderr, "[TRAINER]: %s has %u inputs and %u outputs, expected up to %u and 2 or more\n", o.init,
+                    lr.net.inputs, lr.net.outputs, ring.hdr->num_feat);
+            return EXIT_FAILURE;
+        }
+        learner_init(&lr);
+        ready = true;
+    }
+
+    stats_t st = {0};
+    uint64_t seen = drl_exp_head(&ring);  // Experiences counted into credit
+    uint64_t fresh = 0;                   // Since the last save
+    double credit = 0;                    // Steps the new experiences allow
+    bool dirty = false;
+    int64_t last_save = mono_ns();
+    int64_t last_check = last_save;
+    while (!stop) {
+        uint64_t const head = drl_exp_head(&ring);
+        credit += (double)(head - seen) * o.ratio;
+        // No more than the ring still holds
+        if (credit > o.ratio * (double)(ring.mask + 1))
+            credit = o.ratio * (double)(ring.mask + 1);
+        fresh += head - seen;
+        seen = head;
+        int64_t const now = mono_ns();
+
+        if (!ready && head >= o.warmup) {
+            net_fresh(&lr.net, ring.hdr->num_feat, o.hidden, &rng);
+            normalize(&lr.net, &ring, head);
+            learner_init(&lr);
+            ready = true;
+            fprintf(stderr, "[TRAINER]: %u -> %u -> %u -> 2, normalized over %lu experiences\n", lr.net.inputs, o.hidden,
+                    o.hidden, (unsigned long)head);
+        }
+        if (ready && credit >= 1 && head > 0) {
+            step(&lr, &o, &ring, &rng, &st);
+            credit -= 1;
+            dirty = true;
+        } else {
+            sleep_ns(TRAINER_IDLE_NS);
+        }
+        // A restarted xApp made a new ring
+        if (now - last_check >= TRAINER_ATTACH_NS) {
+            last_check = now;
+            if (drl_exp_replaced(&ring, o.shm)) {
+                drl_exp_close(&ring);
+                fprintf(stderr, "[TRAINER]: %s is gone\n", o.shm);
+                if (!attach(&ring, &o))
+                    break;
+                seen = drl_exp_head(&ring);
+                credit = 0;
+            }
+        }
+        if (dirty && now - last_save >= o.save_ms * 1000000) {
+            if (drl_net_save(&lr.net, o.model))
+                report(&st, drl_exp_head(&ring), fresh, now - last_save);
+            fresh = 0;
+            dirty = false;
+            last_save = now;
+        }
+    }
+    if (dirty && drl_net_save(&lr.net, o.model))
+        fprintf(stderr, "[TRAINER]: Saved %s\n", o.model);
+    drl_exp_close(&ring);
+    return EXIT_SUCCESS;
+}
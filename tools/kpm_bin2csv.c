@@ -0,0 +1,67 @@
+// Exports a binary measurement file (.kpmb, see meas_sink.h) to CSV.
+//
+// Build: gcc -O2 -o kpm_bin2csv tools/kpm_bin2csv.c
+// Usage: kpm_bin2csv [--kpm-only] in.kpmb [out.csv]
+
+#include "../meas_sink.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [--kpm-only] in.kpmb [out.csv]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[]) {
+    bool kpm_only = false;
+    char const* in_path = NULL;
+    char const* out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--kpm-only") == 0)
+            kpm_only = true;
+        else if (in_path == NULL)
+            in_path = argv[i];
+        else if (out_path == NULL)
+            out_path = argv[i];
+        else
+            usage(argv[0]);
+    }
+    if (in_path == NULL)
+        usage(argv[0]);
+
+    meas_bin_reader_t r;
+    if (!meas_bin_reader_open(&r, in_path))
+        return EXIT_FAILURE;
+    FILE* out = out_path != NULL ? fopen(out_path, "w") : stdout;
+    if (out == NULL) {
+        perror(out_path);
+        return EXIT_FAILURE;
+    }
+
+    uint32_t const num_cols = r.hdr.num_cols;
+    uint32_t const out_cols = kpm_only && num_cols > MEAS_KPM_COLS ? MEAS_KPM_COLS : num_cols;
+    for (uint32_t c = 0; c < out_cols; c++)
+        fprintf(out, "%s%s", c > 0 ? "," : "", r.cols[c].name);
+    fputc('\n', out);
+
+    size_t blocks = 0, rows = 0;
+    while (meas_bin_reader_next(&r)) {
+        for (uint32_t i = 0; i < r.rows; i++) {
+            for (uint32_t c = 0; c < out_cols; c++) {
+                if (c > 0)
+                    fputc(',', out);
+                meas_col_fprint(out, (meas_col_e)r.cols[c].type, meas_bin_reader_val(&r, c, i));
+            }
+            fputc('\n', out);
+        }
+        blocks++;
+        rows += r.rows;
+    }
+
+    fprintf(stderr, "[BIN2CSV]: %zu rows in %zu blocks\n", rows, blocks);
+    meas_bin_reader_close(&r);
+    if (out != stdout)
+        fclose(out);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,691 @@
+// Validates a measurement CSV and converts it to the binary format (.kpmb,
+// see meas_sink.h), repairing integers a spreadsheet saved in E notation.
+//
+// Build: gcc -O2 -march=native -pthread -o kpm_csv2bin tools/kpm_csv2bin.c
+// Usage: kpm_csv2bin [--check] [--strict] [--generic] [--period-ms P] [--threads N] in.csv [out.kpmb]
+//
+// The xApp logs, per UE or in the older wide layout with ue<k>_* column
+// groups, become meas_row_t columns with one row per UE, as kpm_replay
+// reads them. Any other CSV, e.g. the experiment_N.csv of
+// traffic_gen_bursty.sh, keeps its own columns: timestamp in μs, the rest
+// F32 with empty fields as NaN.
+//
+// An integer saved as 1.76159E+15 is only known to within half of 1E+10.
+// It is repaired when the exact values around it in its column,
+// interpolated along indication_counter (else the line number), land
+// within that. With --period-ms, a timestamp without exact neighbours is
+// laid out at that period, provided every value stays within its own
+// bounds. Anything else keeps the rounded value and is reported.
+//
+// The file is split at line ends into one chunk per thread. Values are
+// kept row by row, as they are parsed, and only turned into columns on
+// output.
+
+#include "../meas_csv.h"
+#include "../meas_sink.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>  // NAN
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CSV_MAX_REPORTS 8       // Bad lines printed, the rest only counted
+#define CSV_MAX_THREADS 64
+#define CSV_MIN_CHUNK (1 << 20)  // Smaller files are parsed by one thread
+
+typedef enum {
+    VAL_OK,
+    VAL_EMPTY,
+    VAL_INVALID,
+    VAL_MANGLED,  // E notation, rounded
+    VAL_REPAIRED,
+    VAL_ESTIMATED,
+    VAL_NUM_ST,
+} val_st_e;
+
+typedef union {
+    int64_t i;
+    double f;
+} in_val_t;
+
+typedef struct {
+    char name[MEAS_BIN_COL_NAME_LEN];
+    int ue;        // ue<k>_ group of the wide layout, 0: the whole line
+    int meas_col;  // meas_cols index, -1: not converted
+    bool is_int;
+    int scale;  // Integers are kept as value * 10^scale
+    size_t cnt[VAL_NUM_ST];
+} in_col_t;
+
+typedef struct {
+    in_col_t* cols;
+    size_t num_cols;
+    size_t lines;  // Data lines
+    // lines x num_cols, row by row
+    in_val_t* val;
+    uint8_t* st;    // val_st_e
+    uint8_t* lost;  // See meas_csv_num_lost()
+    int num_ue;
+    bool meas;  // xApp layout, else generic
+    size_t bad_lines;
+} in_csv_t;
+
+static inline size_t at(in_csv_t const* in, size_t line, size_t col) {
+    return line * in->num_cols + col;
+}
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [--check] [--strict] [--generic] [--period-ms P] [--threads N] in.csv [out.kpmb]\n", prog);
+    exit(EXIT_FAILURE);
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int meas_col_idx(char const* name) {
+    if (strcmp(name, "ue_delay_dl_us") == 0)  // setTime's name for the delay column
+        name = "ue_delay_us";
+    for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+        if (strcmp(meas_cols[c].name, name) == 0)
+            return (int)c;
+    }
+    return -1;
+}
+
+static int col_find(in_csv_t const* in, char const* name, int ue) {
+    for (size_t c = 0; c < in->num_cols; c++) {
+        if (in->cols[c].ue == ue && strcmp(in->cols[c].name, name) == 0)
+            return (int)c;
+    }
+    return -1;
+}
+
+/////////////////////////////
+// Parsing
+/////////////////////////////
+
+// Timestamps in μs, whether the file has s, ms or μs
+static int time_scale(char const* f, size_t len) {
+    meas_csv_num_t n;
+    if (!meas_csv_num(f, len, &n))
+        return 0;
+    int digits = n.exp10;
+    for (int64_t m = n.mant; m > 0; m /= 10)
+        digits++;
+    return digits <= 11 ? 6 : digits <= 14 ? 3 : 0;
+}
+
+// The header, and the first data line for the units of a generic timestamp
+static void parse_header(in_csv_t* in, meas_csv_t* cs, bool generic) {
+    char const* f;
+    size_t len;
+    bool eol = false;
+    size_t mapped = 0;
+    in->num_ue = 1;
+    while (!eol && meas_csv_next(cs, &f, &len, &eol)) {
+        in->cols = realloc(in->cols, (in->num_cols + 1) * sizeof(in_col_t));
+        assert(in->cols != NULL && "Memory exhausted");
+        in_col_t* c = &in->cols[in->num_cols++];
+        memset(c, 0, sizeof(*c));
+        char tok[MEAS_BIN_COL_NAME_LEN + 8];
+        snprintf(tok, sizeof(tok), "%.*s", (int)len, f);
+        int k = 0, n = 0;
+        if (sscanf(tok, "ue%d_%n", &k, &n) == 1 && n > 0 && k > 0) {
+            snprintf(c->name, sizeof(c->name), "ue_%s", tok + n);
+            c->ue = k;
+            in->num_ue = k > in->num_ue ? k : in->num_ue;
+        } else {
+            snprintf(c->name, sizeof(c->name), "%.*s", MEAS_BIN_COL_NAME_LEN - 1, tok);
+        }
+        c->meas_col = meas_col_idx(c->name);
+        mapped += c->meas_col >= 0;
+    }
+    in->meas = !generic && 2 * mapped > in->num_cols;
+    if (in->meas) {
+        for (size_t i = 0; i < in->num_cols; i++) {
+            in_col_t* c = &in->cols[i];
+            c->is_int = c->meas_col >= 0 && meas_cols[c->meas_col].type != MEAS_COL_F32;
+        }
+        return;
+    }
+
+    in->num_ue = 1;
+    for (size_t i = 0; i < in->num_cols; i++) {
+        in_col_t* c = &in->cols[i];
+        // Named back, the ue<k>_ split only applies to the xApp layout
+        if (c->ue > 0) {
+            char name[MEAS_BIN_COL_NAME_LEN];
+            snprintf(name, sizeof(name), "ue%d_%s", c->ue, c->name + 3);
+            memcpy(c->name, name, sizeof(name));
+        }
+        c->ue = 0;
+        c->meas_col = -1;
+        c->is_int = strcmp(c->name, "timestamp") == 0;
+    }
+    meas_csv_t first = *cs;
+    for (size_t i = 0; i < in->num_cols && meas_csv_next(&first, &f, &len, &eol); i++) {
+        if (in->cols[i].is_int)
+            in->cols[i].scale = time_scale(f, len);
+        if (eol)
+            break;
+    }
+}
+
+// Empty and unparsable fields read as 0 in the xApp layout, as kpm_replay
+// has them, and as NaN floats otherwise
+static void set_missing(in_csv_t* in, size_t k, bool is_int, val_st_e st) {
+    if (is_int)
+        in->val[k].i = 0;
+    else
+        in->val[k].f = in->meas ? 0.0 : NAN;
+    in->lost[k] = 0;
+    in->st[k] = (uint8_t)st;
+}
+
+static void parse_field(in_csv_t* in, in_col_t const* c, size_t k, char const* f, size_t len) {
+    meas_csv_num_t n;
+    if (len == 0) {
+        set_missing(in, k, c->is_int, VAL_EMPTY);
+        return;
+    }
+    if (!meas_csv_num(f, len, &n)) {
+        set_missing(in, k, c->is_int, VAL_INVALID);
+        return;
+    }
+    if (!c->is_int) {
+        in->val[k].f = meas_csv_num_f64(&n, f, len);
+        in->lost[k] = 0;
+        in->st[k] = VAL_OK;
+        return;
+    }
+    if (!meas_csv_num_i64(&n, c->scale, &in->val[k].i)) {
+        set_missing(in, k, true, VAL_INVALID);
+        return;
+    }
+    int const lost = meas_csv_num_lost(&n, c->scale);
+    in->lost[k] = (uint8_t)lost;
+    in->st[k] = lost > 0 ? VAL_MANGLED : VAL_OK;
+}
+
+// Lines of one thread, parsed into the rows from row0 on
+typedef struct {
+    in_csv_t* in;
+    char const* buf;
+    size_t len;
+    size_t row0;
+    size_t rows;
+    size_t file_line0;
+    size_t bad_lines;
+    size_t bad_line[CSV_MAX_REPORTS];
+    size_t bad_fields[CSV_MAX_REPORTS];
+    pthread_t thread;
+} in_chunk_t;
+
+static void* parse_chunk(void* arg) {
+    in_chunk_t* ch = arg;
+    in_csv_t* in = ch->in;
+    meas_csv_t cs;
+    meas_csv_init(&cs, ch->buf, ch->len);
+    char const* f;
+    size_t flen;
+    bool eol;
+    size_t field = 0;
+    size_t file_line = ch->file_line0;
+    size_t k = at(in, ch->row0, 0);
+    while (meas_csv_next(&cs, &f, &flen, &eol)) {
+        if (field == 0 && eol && flen == 0) {
+            file_line++;
+            continue;
+        }
+        if (field < in->num_cols)
+            parse_field(in, &in->cols[field], k + field, f, flen);
+        field++;
+        if (!eol)
+            continue;
+        if (field != in->num_cols) {
+            if (ch->bad_lines < CSV_MAX_REPORTS) {
+                ch->bad_line[ch->bad_lines] = file_line;
+                ch->bad_fields[ch->bad_lines] = field;
+            }
+            ch->bad_lines++;
+            for (; field < in->num_cols; field++)
+                set_missing(in, k + field, in->cols[field].is_int, VAL_EMPTY);
+        }
+        ch->rows++;
+        k += in->num_cols;
+        file_line++;
+        field = 0;
+    }
+    return NULL;
+}
+
+static bool parse_csv(in_csv_t* in, char const* buf, size_t len, bool generic, int threads) {
+    meas_csv_t cs;
+    meas_csv_init(&cs, buf, len);
+    parse_header(in, &cs, generic);
+    if (in->num_cols == 0)
+        return false;
+
+    // Chunks of about the same size, each up to a line end
+    size_t const data = cs.pos < len ? cs.pos : len;
+    size_t nt = (len - data) / CSV_MIN_CHUNK + 1;
+    nt = nt < (size_t)threads ? nt : (size_t)threads;
+    in_chunk_t ch[CSV_MAX_THREADS];
+    memset(ch, 0, sizeof(ch));
+    size_t start = data, row0 = 0, file_line = 2;
+    for (size_t t = 0; t < nt; t++) {
+        size_t end = t + 1 == nt ? len : data + (len - data) * (t + 1) / nt;
+        end = end < start ? start : end;
+        char const* nl = end < len ? memchr(buf + end, '\n', len - end) : NULL;
+        end = nl != NULL ? (size_t)(nl - buf) + 1 : len;
+        size_t const lines = meas_csv_count_lines(buf + start, end - start);
+        ch[t] = (in_chunk_t){.in = in, .buf = buf + start, .len = end - start, .row0 = row0, .file_line0 = file_line};
+        row0 += lines;
+        file_line += lines;
+        start = end;
+    }
+
+    // Blank lines take no row, so there is room for every line
+    in->val = malloc((row0 + 1) * in->num_cols * sizeof(in_val_t));
+    in->st = malloc((row0 + 1) * in->num_cols);
+    in->lost = malloc((row0 + 1) * in->num_cols);
+    assert(in->val != NULL && in->st != NULL && in->lost != NULL && "Memory exhausted");
+    for (size_t t = 1; t < nt; t++) {
+        int const rc = pthread_create(&ch[t].thread, NULL, parse_chunk, &ch[t]);
+        assert(rc == 0);
+    }
+    parse_chunk(&ch[0]);
+    for (size_t t = 1; t < nt; t++)
+        pthread_join(ch[t].thread, NULL);
+
+    // Rows of each chunk right after those of the previous one
+    for (size_t t = 0; t < nt; t++) {
+        if (ch[t].row0 != in->lines) {
+            size_t const src = at(in, ch[t].row0, 0), dst = at(in, in->lines, 0), n = ch[t].rows * in->num_cols;
+            memmove(&in->val[dst], &in->val[src], n * sizeof(in_val_t));
+            memmove(&in->st[dst], &in->st[src], n);
+            memmove(&in->lost[dst], &in->lost[src], n);
+        }
+        in->lines += ch[t].rows;
+        for (size_t i = 0; i < ch[t].bad_lines && i < CSV_MAX_REPORTS; i++) {
+            if (in->bad_lines + i < CSV_MAX_REPORTS)
+                fprintf(stderr, "[CSV2BIN]: Line %zu has %zu fields, the header %zu\n", ch[t].bad_line[i],
+                        ch[t].bad_fields[i], in->num_cols);
+        }
+        in->bad_lines += ch[t].bad_lines;
+    }
+    return true;
+}
+
+/////////////////////////////
+// Repair
+/////////////////////////////
+
+// Half the spread of a value E notation dropped lost digits of
+static int64_t lost_half(uint8_t lost) {
+    return lost >= 19 ? INT64_MAX : meas_csv_pow10_i64[lost] / 2;
+}
+
+static int64_t round_i64(double v) {
+    return (int64_t)(v < 0 ? v - 0.5 : v + 0.5);
+}
+
+static void mark(in_csv_t* in, size_t k, int64_t v, val_st_e st) {
+    int64_t const d = v > in->val[k].i ? v - in->val[k].i : in->val[k].i - v;
+    if (d > lost_half(in->lost[k]))
+        return;
+    in->val[k].i = v;
+    in->st[k] = (uint8_t)st;
+}
+
+// Repairs the E notation values of integer column c. x is the position of
+// each line; step_us the --period-ms in μs, 0 without.
+static void col_repair(in_csv_t* in, size_t c, int64_t const* x, int64_t step_us) {
+    size_t const n = in->lines;
+#define ST(r) in->st[at(in, (r), c)]
+#define IV(r) in->val[at(in, (r), c)].i
+    // Slope of the exact values, for runs with an exact value on one side only
+    size_t first = n, last = n;
+    for (size_t i = 0; i < n; i++) {
+        if (ST(i) == VAL_OK) {
+            first = first == n ? i : first;
+            last = i;
+        }
+    }
+    bool const has_slope = first < n && x[last] != x[first];
+    double const slope = has_slope ? (double)(IV(last) - IV(first)) / (double)(x[last] - x[first]) : 0.0;
+    bool const is_time = step_us > 0 && strcmp(in->cols[c].name, "timestamp") == 0;
+
+    for (size_t i = 0; i < n;) {
+        if (ST(i) == VAL_OK) {
+            i++;
+            continue;
+        }
+        size_t j = i;
+        while (j < n && ST(j) != VAL_OK)
+            j++;
+        bool const has_a = i > 0;
+        bool const has_b = j < n;
+        size_t const a = i - 1, b = j;
+
+        if (!has_a && !has_b) {
+            // Not one exact value: lay the run out at the period, from the
+            // start that keeps every value within its bounds
+            if (!is_time)
+                break;
+            int64_t lo = INT64_MIN, hi = INT64_MAX;
+            for (size_t k = i; k < j; k++) {
+                if (ST(k) != VAL_MANGLED)
+                    continue;
+                int64_t const off = (x[k] - x[i]) * step_us;
+                int64_t const half = lost_half(in->lost[at(in, k, c)]);
+                lo = IV(k) - half - off > lo ? IV(k) - half - off : lo;
+                hi = IV(k) + half - off < hi ? IV(k) + half - off : hi;
+            }
+            if (lo <= hi) {
+                int64_t const t0 = lo + (hi - lo) / 2;
+                for (size_t k = i; k < j; k++) {
+                    if (ST(k) == VAL_MANGLED)
+                        mark(in, at(in, k, c), t0 + (x[k] - x[i]) * step_us, VAL_ESTIMATED);
+                }
+            }
+            i = j;
+            continue;
+        }
+
+        for (size_t k = i; k < j; k++) {
+            if (ST(k) != VAL_MANGLED)
+                continue;
+            if (has_a && has_b) {
+                double const frac = x[b] != x[a] ? (double)(x[k] - x[a]) / (double)(x[b] - x[a]) : 0.0;
+                mark(in, at(in, k, c), IV(a) + round_i64((double)(IV(b) - IV(a)) * frac), VAL_REPAIRED);
+                continue;
+            }
+            size_t const e = has_a ? a : b;
+            if (has_slope)
+                mark(in, at(in, k, c), IV(e) + round_i64(slope * (double)(x[k] - x[e])), VAL_REPAIRED);
+            else if (is_time)
+                mark(in, at(in, k, c), IV(e) + (x[k] - x[e]) * step_us, VAL_ESTIMATED);
+        }
+        i = j;
+    }
+#undef ST
+#undef IV
+}
+
+static void repair_csv(in_csv_t* in, int64_t period_ms) {
+    // indication_counter orders the lines when it is complete, else their number
+    int64_t* x = malloc((in->lines + 1) * sizeof(int64_t));
+    assert(x != NULL && "Memory exhausted");
+    int counter = in->meas ? col_find(in, "indication_counter", 0) : -1;
+    for (size_t i = 0; i < in->lines && counter >= 0; i++) {
+        if (in->st[at(in, i, counter)] != VAL_OK)
+            counter = -1;
+    }
+    for (size_t i = 0; i < in->lines; i++)
+        x[i] = counter >= 0 ? in->val[at(in, i, counter)].i : (int64_t)i;
+
+    for (size_t c = 0; c < in->num_cols; c++) {
+        bool mangled = false;
+        for (size_t i = 0; i < in->lines && in->cols[c].is_int && !mangled; i++)
+            mangled = in->st[at(in, i, c)] == VAL_MANGLED;
+        if (mangled)
+            col_repair(in, c, x, period_ms * 1000);
+    }
+    free(x);
+}
+
+/////////////////////////////
+// Report
+/////////////////////////////
+
+// False when something is left a strict run refuses
+static bool report(in_csv_t* in) {
+    static char const* const what[VAL_NUM_ST] = {"", "empty", "invalid", "left rounded", "repaired", "estimated"};
+    bool clean = in->bad_lines == 0;
+    if (in->bad_lines > CSV_MAX_REPORTS)
+        fprintf(stderr, "[CSV2BIN]: ... %zu lines with a wrong field count\n", in->bad_lines);
+    for (size_t i = 0; i < in->lines; i++) {
+        for (size_t c = 0; c < in->num_cols; c++)
+            in->cols[c].cnt[in->st[at(in, i, c)]]++;
+    }
+    for (size_t c = 0; c < in->num_cols; c++) {
+        in_col_t const* col = &in->cols[c];
+        if (col->cnt[VAL_OK] == in->lines)
+            continue;
+        // Only the counts that are not zero
+        char msg[256];
+        int len = snprintf(msg, sizeof(msg), "[CSV2BIN]: %s", col->name);
+        if (col->ue > 0)
+            len += snprintf(msg + len, sizeof(msg) - len, " of UE %d", col->ue);
+        len += snprintf(msg + len, sizeof(msg) - len, ":");
+        size_t const sci = col->cnt[VAL_MANGLED] + col->cnt[VAL_REPAIRED] + col->cnt[VAL_ESTIMATED];
+        if (sci > 0)
+            len += snprintf(msg + len, sizeof(msg) - len, " %zu in E notation,", sci);
+        for (int st = VAL_EMPTY; st < VAL_NUM_ST; st++) {
+            if (col->cnt[st] > 0)
+                len += snprintf(msg + len, sizeof(msg) - len, " %zu %s,", col->cnt[st], what[st]);
+        }
+        msg[len - 1] = '\n';
+        fputs(msg, stderr);
+        clean &= col->cnt[VAL_INVALID] == 0 && col->cnt[VAL_MANGLED] == 0;
+    }
+
+    // Timestamps running backwards, after the repair
+    for (int u = 0; u <= in->num_ue; u++) {
+        int const ts = col_find(in, "timestamp", u);
+        if (ts < 0 || !in->cols[ts].is_int)
+            continue;
+        size_t back = 0;
+        for (size_t i = 1; i < in->lines; i++)
+            back += in->val[at(in, i, ts)].i < in->val[at(in, i - 1, ts)].i;
+        if (back > 0)
+            fprintf(stderr, "[CSV2BIN]: timestamp goes back %zu times\n", back);
+    }
+    return clean;
+}
+
+/////////////////////////////
+// Output
+/////////////////////////////
+
+static void put_val(uint8_t* dst, meas_col_e type, in_val_t v, bool is_int) {
+    switch (type) {
+        case MEAS_COL_I32:
+            *(int32_t*)dst = is_int ? (int32_t)v.i : (int32_t)v.f;
+            break;
+        case MEAS_COL_I64:
+            *(int64_t*)dst = is_int ? v.i : (int64_t)v.f;
+            break;
+        case MEAS_COL_U64:
+            *(uint64_t*)dst = is_int ? (uint64_t)v.i : (uint64_t)v.f;
+            break;
+        case MEAS_COL_F32:
+            *(float*)dst = is_int ? (float)v.i : (float)v.f;
+            break;
+    }
+}
+
+static bool write_bin(in_csv_t const* in, char const* path, size_t* rows_out) {
+    // Output columns and, per UE, the CSV column each comes from
+    size_t const num_out = in->meas ? MEAS_NUM_COLS : in->num_cols;
+    meas_bin_col_t* out = calloc(num_out, sizeof(meas_bin_col_t));
+    int* src = malloc(num_out * in->num_ue * sizeof(int));
+    assert(out != NULL && src != NULL && "Memory exhausted");
+    size_t row_width = 0;
+    for (size_t c = 0; c < num_out; c++) {
+        if (in->meas) {
+            snprintf(out[c].name, sizeof(out[c].name), "%s", meas_cols[c].name);
+            out[c].type = meas_cols[c].type;
+            for (int u = 0; u < in->num_ue; u++) {
+                int* s = &src[c * in->num_ue + u];
+                *s = -1;
+                for (size_t k = 0; k < in->num_cols; k++) {
+                    in_col_t const* col = &in->cols[k];
+                    if (col->meas_col == (int)c && (col->ue == u + 1 || (col->ue == 0 && *s < 0)))
+                        *s = (int)k;
+                }
+            }
+        } else {
+            memcpy(out[c].name, in->cols[c].name, sizeof(out[c].name));
+            out[c].type = in->cols[c].is_int ? MEAS_COL_I64 : MEAS_COL_F32;
+            src[c] = (int)c;
+        }
+        out[c].width = (uint32_t)meas_col_width((meas_col_e)out[c].type);
+        row_width += out[c].width;
+    }
+
+    bool ok = false;
+    uint8_t* blk = NULL;
+    int const fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror(path);
+        goto out;
+    }
+    meas_bin_hdr_t hdr = {.version = MEAS_BIN_VERSION, .num_cols = (uint32_t)num_out};
+    memcpy(hdr.magic, MEAS_BIN_MAGIC, 4);
+    if (!meas_write_all(fd, &hdr, sizeof(hdr)) || !meas_write_all(fd, out, num_out * sizeof(meas_bin_col_t)))
+        goto fail;
+
+    size_t const rows = in->lines * (size_t)in->num_ue;
+    blk = malloc(sizeof(meas_bin_blk_t) + MEAS_SINK_BATCH_ROWS * row_width);
+    assert(blk != NULL && "Memory exhausted");
+    for (size_t r0 = 0; r0 < rows; r0 += MEAS_SINK_BATCH_ROWS) {
+        size_t const cnt = rows - r0 < MEAS_SINK_BATCH_ROWS ? rows - r0 : MEAS_SINK_BATCH_ROWS;
+        meas_bin_blk_t blk_hdr = {.rows = (uint32_t)cnt};
+        memcpy(blk_hdr.magic, MEAS_BIN_BLK_MAGIC, 4);
+        memcpy(blk, &blk_hdr, sizeof(blk_hdr));
+        uint8_t* p = blk + sizeof(blk_hdr);
+        for (size_t c = 0; c < num_out; c++) {
+            for (size_t r = r0; r < r0 + cnt; r++, p += out[c].width) {
+                int const s = src[c * in->num_ue + r % in->num_ue];
+                if (s >= 0)
+                    put_val(p, (meas_col_e)out[c].type, in->val[at(in, r / in->num_ue, s)], in->cols[s].is_int);
+                else
+                    memset(p, 0, out[c].width);
+            }
+        }
+        if (!meas_write_all(fd, blk, (size_t)(p - blk)))
+            goto fail;
+    }
+    if (fdatasync(fd) != 0)
+        goto fail;
+    *rows_out = rows;
+    ok = true;
+    goto close;
+
+fail:
+    perror(path);
+close:
+    close(fd);
+out:
+    free(blk);
+    free(src);
+    free(out);
+    return ok;
+}
+
+// The file followed by MEAS_CSV_PAD readable bytes, for meas_csv_num()
+static char const* map_padded(int fd, size_t len) {
+    size_t const page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t const total = (len + MEAS_CSV_PAD + page - 1) / page * page;
+    char* base = mmap(NULL, total, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+        return NULL;
+    if (len > 0 && mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_POPULATE, fd, 0) == MAP_FAILED) {
+        munmap(base, total);
+        return NULL;
+    }
+    return base;
+}
+
+int main(int argc, char* argv[]) {
+    bool check_only = false, strict = false, generic = false;
+    int64_t period_ms = 0;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    char const* in_path = NULL;
+    char const* out_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0)
+            check_only = true;
+        else if (strcmp(argv[i], "--strict") == 0)
+            strict = true;
+        else if (strcmp(argv[i], "--generic") == 0)
+            generic = true;
+        else if (strcmp(argv[i], "--period-ms") == 0 && i + 1 < argc)
+            period_ms = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            threads = atol(argv[++i]);
+        else if (argv[i][0] == '-' || out_path != NULL)
+            usage(argv[0]);
+        else if (in_path == NULL)
+            in_path = argv[i];
+        else
+            out_path = argv[i];
+    }
+    if (in_path == NULL || period_ms < 0 || threads < 1)
+        usage(argv[0]);
+    threads = threads < CSV_MAX_THREADS ? threads : CSV_MAX_THREADS;
+
+    char out_buf[512];
+    if (out_path == NULL) {
+        size_t len = strlen(in_path);
+        if (len > 4 && strcmp(in_path + len - 4, ".csv") == 0)
+            len -= 4;
+        snprintf(out_buf, sizeof(out_buf), "%.*s.kpmb", (int)len, in_path);
+        out_path = out_buf;
+    }
+
+    int const fd = open(in_path, O_RDONLY | O_CLOEXEC);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        perror(in_path);
+        return EXIT_FAILURE;
+    }
+    size_t const len = (size_t)sb.st_size;
+    char const* buf = map_padded(fd, len);
+    close(fd);
+    if (buf == NULL) {
+        perror(in_path);
+        return EXIT_FAILURE;
+    }
+
+    int64_t const t0 = mono_ns();
+    in_csv_t in = {0};
+    if (!parse_csv(&in, buf, len, generic, (int)threads)) {
+        fprintf(stderr, "[CSV2BIN]: %s has no header\n", in_path);
+        return EXIT_FAILURE;
+    }
+    int64_t const t1 = mono_ns();
+    repair_csv(&in, period_ms);
+    bool const clean = report(&in);
+    fprintf(stderr, "[CSV2BIN]: %zu lines, %zu columns (%s), %.1f MB parsed in %.1f ms, %.0f MB/s\n", in.lines,
+            in.num_cols, in.meas ? "xApp" : "generic", len / 1e6, (t1 - t0) / 1e6,
+            t1 > t0 ? len / 1e6 / ((t1 - t0) / 1e9) : 0.0);
+
+    bool ok = !strict || clean;
+    if (strict && !clean)
+        fprintf(stderr, "[CSV2BIN]: --strict: not converting %s\n", in_path);
+    if (ok && !check_only) {
+        size_t rows = 0;
+        ok = write_bin(&in, out_path, &rows);
+        if (ok)
+            fprintf(stderr, "[CSV2BIN]: %zu rows written to %s in %.1f ms\n", rows, out_path, (mono_ns() - t1) / 1e6);
+    }
+
+    munmap((void*)buf, len + MEAS_CSV_PAD);
+    free(in.val);
+    free(in.st);
+    free(in.lost);
+    free(in.cols);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,641 @@
+// Labels xApp measurements with the traffic generator's ground truth: every
+// row of an xApp log gets the columns of the experiment_N.csv row of
+// traffic_gen_bursty.sh nearest to it in time, within a tolerance. The
+// result is a CSV ready for training.
+//
+// Build: gcc -O2 -o kpm_join tools/kpm_join.c
+// Usage: kpm_join [--tolerance-ms T] [--offset-ms O] [--max-skew-ms S] [--cols a,b,...] [--keep-unmatched]
+//                 xapp.{csv,kpmb} truth.csv [out.csv]
+//
+// Both files are read once, front to back, as they were written: in time
+// order. Only the truth rows within reach of the current xApp time stay in
+// memory, so files of any size join in a few MB. Either file may be out
+// of order by up to --max-skew-ms: node shards log concurrently, and the
+// generator's wall clock may step back. Rows further behind are counted
+// and left out.
+//
+// Timestamps are in s, ms or μs, told apart by their magnitude: the xApps
+// log time_now_us(), the generator date +%s.%3N. --offset-ms is how far
+// the generator's clock runs ahead of the xApp's.
+
+#include "../meas_csv.h"
+#include "../meas_sink.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define JOIN_READ_SIZE (1 << 20)
+#define JOIN_MAX_COLS 256
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [--tolerance-ms T] [--offset-ms O] [--max-skew-ms S] [--cols a,b,...] [--keep-unmatched] "
+            "xapp.{csv,kpmb} truth.csv [out.csv]\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/////////////////////////////
+// Line reader
+/////////////////////////////
+
+// Reads a file line by line through one buffer, which only grows for a
+// line longer than it. MEAS_CSV_PAD bytes past every line stay readable.
+typedef struct {
+    FILE* f;
+    char const* path;
+    char* buf;
+    size_t cap;  // Without the padding
+    size_t beg, end;
+    size_t bytes;
+    bool eof;
+} line_rd_t;
+
+static bool rd_open(line_rd_t* rd, char const* path) {
+    memset(rd, 0, sizeof(*rd));
+    rd->f = fopen(path, "rb");
+    if (rd->f == NULL) {
+        perror(path);
+        return false;
+    }
+    posix_fadvise(fileno(rd->f), 0, 0, POSIX_FADV_SEQUENTIAL);
+    rd->path = path;
+    rd->cap = JOIN_READ_SIZE;
+    rd->buf = calloc(rd->cap + MEAS_CSV_PAD, 1);
+    assert(rd->buf != NULL && "Memory exhausted");
+    return true;
+}
+
+static void rd_close(line_rd_t* rd) {
+    if (rd->f != NULL)
+        fclose(rd->f);
+    free(rd->buf);
+    memset(rd, 0, sizeof(*rd));
+}
+
+// Next line without its "\r\n", valid until the next call. False at the
+// end of the file.
+static bool rd_line(line_rd_t* rd, char** line, size_t* len) {
+    size_t scanned = rd->beg;
+    for (;;) {
+        char* nl = memchr(rd->buf + scanned, '\n', rd->end - scanned);
+        if (nl != NULL || (rd->eof && rd->beg < rd->end)) {
+            size_t const stop = nl != NULL ? (size_t)(nl - rd->buf) : rd->end;
+            *line = rd->buf + rd->beg;
+            *len = stop - rd->beg;
+            if (*len > 0 && (*line)[*len - 1] == '\r')
+                (*len)--;
+            rd->beg = nl != NULL ? stop + 1 : stop;
+            return true;
+        }
+        if (rd->eof)
+            return false;
+        scanned = rd->end - rd->beg;
+        memmove(rd->buf, rd->buf + rd->beg, rd->end - rd->beg);
+        rd->end -= rd->beg;
+        rd->beg = 0;
+        if (rd->end == rd->cap) {
+            rd->buf = realloc(rd->buf, 2 * rd->cap + MEAS_CSV_PAD);
+            assert(rd->buf != NULL && "Memory exhausted");
+            memset(rd->buf + rd->cap, 0, rd->cap + MEAS_CSV_PAD);
+            rd->cap *= 2;
+        }
+        size_t const n = fread(rd->buf + rd->end, 1, rd->cap - rd->end, rd->f);
+        if (n == 0) {
+            if (ferror(rd->f))
+                perror(rd->path);
+            rd->eof = true;
+        }
+        // Stale bytes past the data would otherwise look like digits
+        memset(rd->buf + rd->end + n, 0, MEAS_CSV_PAD);
+        rd->end += n;
+        rd->bytes += n;
+    }
+}
+
+// Field col of a line
+static bool field_at(char const* line, size_t len, int col, char const** f, size_t* flen) {
+    char const* p = line;
+    char const* const end = line + len;
+    for (int c = 0; c < col; c++) {
+        p = memchr(p, ',', (size_t)(end - p));
+        if (p == NULL)
+            return false;
+        p++;
+    }
+    char const* const comma = memchr(p, ',', (size_t)(end - p));
+    *f = p;
+    *flen = (size_t)((comma != NULL ? comma : end) - p);
+    return true;
+}
+
+static int header_find(char const* line, size_t len, char const* name) {
+    char const* f;
+    size_t flen;
+    for (int c = 0; field_at(line, len, c, &f, &flen); c++) {
+        if (flen == strlen(name) && memcmp(f, name, flen) == 0)
+            return c;
+    }
+    return -1;
+}
+
+/////////////////////////////
+// Timestamps
+/////////////////////////////
+
+typedef enum {
+    TS_OK,
+    TS_INVALID,
+    TS_ROUNDED,  // E notation lost too many digits to place it
+} ts_st_e;
+
+// Scale to μs for the magnitude of n: s up to 11 digits, ms up to 14
+static int ts_scale(meas_csv_num_t const* n) {
+    int digits = n->exp10;
+    for (int64_t m = n->mant; m > 0; m /= 10)
+        digits++;
+    return digits <= 11 ? 6 : digits <= 14 ? 3 : 0;
+}
+
+// *scale is fixed by the first valid timestamp of a file, -1 before
+static ts_st_e ts_parse(char const* f, size_t len, int* scale, int64_t tolerance_us, int64_t* t_us) {
+    meas_csv_num_t n;
+    if (!meas_csv_num(f, len, &n) || n.neg)
+        return TS_INVALID;
+    if (*scale < 0)
+        *scale = ts_scale(&n);
+    int const lost = meas_csv_num_lost(&n, *scale);
+    if (lost >= 19 || (lost > 0 && meas_csv_pow10_i64[lost] / 2 > tolerance_us))
+        return TS_ROUNDED;
+    return meas_csv_num_i64(&n, *scale, t_us) ? TS_OK : TS_INVALID;
+}
+
+/////////////////////////////
+// Ground truth window
+/////////////////////////////
+
+typedef struct {
+    int64_t t_us;
+    char* text;  // ",v1,v2,..." of the selected columns
+    size_t len;
+    size_t cap;
+} gt_row_t;
+
+// Truth rows from the eviction horizon up to the first one past the
+// current xApp time plus the tolerance and skew, sorted by time. Slots past n keep
+// their text buffers for reuse.
+typedef struct {
+    gt_row_t* rows;
+    size_t n;
+    size_t cap;
+    size_t peak;
+} gt_win_t;
+
+typedef struct {
+    line_rd_t rd;
+    int ts_col;
+    int scale;
+    int sel[JOIN_MAX_COLS];  // Output columns
+    size_t num_sel;
+    bool eof;
+    int64_t max_t;
+    size_t read, bad, rounded, unordered, late;
+} gt_in_t;
+
+static void gt_win_push(gt_win_t* w, int64_t t_us, char const* line, size_t len, gt_in_t const* gt) {
+    if (w->n == w->cap) {
+        size_t const cap = w->cap == 0 ? 64 : 2 * w->cap;
+        w->rows = realloc(w->rows, cap * sizeof(gt_row_t));
+        assert(w->rows != NULL && "Memory exhausted");
+        memset(w->rows + w->cap, 0, (cap - w->cap) * sizeof(gt_row_t));
+        w->cap = cap;
+    }
+    gt_row_t* r = &w->rows[w->n];
+    r->t_us = t_us;
+    r->len = 0;
+    for (size_t k = 0; k < gt->num_sel; k++) {
+        char const* f = NULL;
+        size_t flen = 0;
+        field_at(line, len, gt->sel[k], &f, &flen);
+        if (r->len + flen + 1 > r->cap) {
+            r->cap = 2 * (r->len + flen + 1);
+            r->text = realloc(r->text, r->cap);
+            assert(r->text != NULL && "Memory exhausted");
+        }
+        r->text[r->len++] = ',';
+        memcpy(r->text + r->len, f, flen);
+        r->len += flen;
+    }
+    // A wall clock may step back: keep the window sorted
+    size_t i = w->n++;
+    w->peak = w->n > w->peak ? w->n : w->peak;
+    for (; i > 0 && w->rows[i - 1].t_us > t_us; i--) {
+        gt_row_t const tmp = w->rows[i - 1];
+        w->rows[i - 1] = w->rows[i];
+        w->rows[i] = tmp;
+    }
+}
+
+static void gt_win_evict(gt_win_t* w, int64_t horizon_us) {
+    size_t k = 0;
+    while (k < w->n && w->rows[k].t_us < horizon_us)
+        k++;
+    if (k == 0)
+        return;
+    // Evicted slots move past n with their buffers
+    gt_row_t* tmp = malloc(k * sizeof(gt_row_t));
+    assert(tmp != NULL && "Memory exhausted");
+    memcpy(tmp, w->rows, k * sizeof(gt_row_t));
+    memmove(w->rows, w->rows + k, (w->n - k) * sizeof(gt_row_t));
+    memcpy(w->rows + w->n - k, tmp, k * sizeof(gt_row_t));
+    free(tmp);
+    w->n -= k;
+}
+
+// Reads truth rows until one lies past until_us
+static void gt_fill(gt_in_t* gt, gt_win_t* w, int64_t until_us, int64_t horizon_us, int64_t offset_us, int64_t tolerance_us) {
+    while (!gt->eof && (w->n == 0 || w->rows[w->n - 1].t_us <= until_us)) {
+        char* line;
+        size_t len;
+        if (!rd_line(&gt->rd, &line, &len)) {
+            gt->eof = true;
+            break;
+        }
+        if (len == 0)
+            continue;
+        gt->read++;
+        char const* f;
+        size_t flen;
+        int64_t t_us = 0;
+        ts_st_e const st = field_at(line, len, gt->ts_col, &f, &flen) ? ts_parse(f, flen, &gt->scale, tolerance_us, &t_us)
+                                                                       : TS_INVALID;
+        if (st != TS_OK) {
+            gt->bad += st == TS_INVALID;
+            gt->rounded += st == TS_ROUNDED;
+            continue;
+        }
+        t_us -= offset_us;
+        bool const back = t_us < gt->max_t;
+        gt->unordered += back;
+        gt->max_t = t_us > gt->max_t ? t_us : gt->max_t;
+        // Rows before the xApp log are of no use either
+        if (t_us < horizon_us) {
+            gt->late += back;
+            continue;
+        }
+        gt_win_push(w, t_us, line, len, gt);
+    }
+}
+
+// Row nearest to t_us within the tolerance, the earlier one on a tie
+static gt_row_t const* gt_nearest(gt_win_t const* w, int64_t t_us, int64_t tolerance_us) {
+    size_t lo = 0, hi = w->n;
+    while (lo < hi) {
+        size_t const mid = lo + (hi - lo) / 2;
+        if (w->rows[mid].t_us < t_us)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    gt_row_t const* best = NULL;
+    if (lo < w->n)
+        best = &w->rows[lo];
+    if (lo > 0 && (best == NULL || t_us - w->rows[lo - 1].t_us <= best->t_us - t_us))
+        best = &w->rows[lo - 1];
+    if (best == NULL || llabs(best->t_us - t_us) > tolerance_us)
+        return NULL;
+    return best;
+}
+
+static bool gt_open(gt_in_t* gt, char const* path, char const* cols, FILE* out) {
+    memset(gt, 0, sizeof(*gt));
+    gt->scale = -1;
+    gt->max_t = INT64_MIN;
+    if (!rd_open(&gt->rd, path))
+        return false;
+    char* hdr;
+    size_t hlen;
+    if (!rd_line(&gt->rd, &hdr, &hlen) || (gt->ts_col = header_find(hdr, hlen, "timestamp")) < 0) {
+        fprintf(stderr, "[JOIN]: %s has no timestamp column\n", path);
+        return false;
+    }
+    if (cols == NULL) {
+        char const* f;
+        size_t flen;
+        for (int c = 0; field_at(hdr, hlen, c, &f, &flen) && gt->num_sel < JOIN_MAX_COLS; c++)
+            gt->sel[gt->num_sel++] = c;
+    } else {
+        for (char const* p = cols; *p != '\0' && gt->num_sel < JOIN_MAX_COLS;) {
+            size_t const n = strcspn(p, ",");
+            char name[MEAS_BIN_COL_NAME_LEN];
+            snprintf(name, sizeof(name), "%.*s", (int)n, p);
+            int const c = header_find(hdr, hlen, name);
+            if (c < 0) {
+                fprintf(stderr, "[JOIN]: %s has no column %s\n", path, name);
+                return false;
+            }
+            gt->sel[gt->num_sel++] = c;
+            p += n + (p[n] == ',');
+        }
+    }
+    // The truth timestamp is kept as gt_timestamp
+    for (size_t k = 0; k < gt->num_sel; k++) {
+        char const* f;
+        size_t flen;
+        field_at(hdr, hlen, gt->sel[k], &f, &flen);
+        fprintf(out, ",%s%.*s", gt->sel[k] == gt->ts_col ? "gt_" : "", (int)flen, f);
+    }
+    fputs(",gt_dt_us\n", out);
+    return true;
+}
+
+/////////////////////////////
+// xApp log
+/////////////////////////////
+
+typedef struct {
+    bool bin;
+    line_rd_t rd;  // CSV
+    int ts_col;
+    int scale;
+    meas_bin_reader_t br;  // .kpmb
+    uint32_t blk_row;
+    uint32_t ts_idx;
+    char* line;  // Current CSV row
+    size_t len;
+    size_t rows, bad, rounded;
+} xapp_in_t;
+
+static bool is_bin(char const* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL)
+        return false;
+    char magic[4] = {0};
+    size_t const n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    return n == sizeof(magic) && memcmp(magic, MEAS_BIN_MAGIC, 4) == 0;
+}
+
+// Opens the log and writes its header
+static bool xapp_open(xapp_in_t* x, char const* path, FILE* out) {
+    memset(x, 0, sizeof(*x));
+    x->scale = -1;
+    x->bin = is_bin(path);
+    if (x->bin) {
+        if (!meas_bin_reader_open(&x->br, path))
+            return false;
+        x->ts_idx = x->br.hdr.num_cols;
+        for (uint32_t c = 0; c < x->br.hdr.num_cols; c++) {
+            fprintf(out, "%s%s", c > 0 ? "," : "", x->br.cols[c].name);
+            if (strcmp(x->br.cols[c].name, "timestamp") == 0 && x->br.cols[c].type == MEAS_COL_I64)
+                x->ts_idx = c;
+        }
+        if (x->ts_idx == x->br.hdr.num_cols) {
+            fprintf(stderr, "[JOIN]: %s has no timestamp column\n", path);
+            return false;
+        }
+        return true;
+    }
+    if (!rd_open(&x->rd, path))
+        return false;
+    char* hdr;
+    size_t hlen;
+    if (!rd_line(&x->rd, &hdr, &hlen) || (x->ts_col = header_find(hdr, hlen, "timestamp")) < 0) {
+        fprintf(stderr, "[JOIN]: %s has no timestamp column\n", path);
+        return false;
+    }
+    fwrite(hdr, 1, hlen, out);
+    return true;
+}
+
+// Next row with a usable timestamp, in μs. False at the end of the log.
+static bool xapp_next(xapp_in_t* x, int64_t tolerance_us, int64_t* t_us) {
+    if (x->bin) {
+        while (x->blk_row >= x->br.rows) {
+            if (!meas_bin_reader_next(&x->br))
+                return false;
+            x->blk_row = 0;
+        }
+        memcpy(t_us, meas_bin_reader_val(&x->br, x->ts_idx, x->blk_row++), sizeof(*t_us));
+        x->rows++;
+        return true;
+    }
+    while (rd_line(&x->rd, &x->line, &x->len)) {
+        if (x->len == 0)
+            continue;
+        x->rows++;
+        char const* f;
+        size_t flen;
+        ts_st_e const st = field_at(x->line, x->len, x->ts_col, &f, &flen) ? ts_parse(f, flen, &x->scale, tolerance_us, t_us)
+                                                                           : TS_INVALID;
+        if (st == TS_OK)
+            return true;
+        x->bad += st == TS_INVALID;
+        x->rounded += st == TS_ROUNDED;
+    }
+    return false;
+}
+
+static size_t fmt_u64(char* p, uint64_t v) {
+    char tmp[20];
+    size_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v > 0);
+    for (size_t k = 0; k < n; k++)
+        p[k] = tmp[n - 1 - k];
+    return n;
+}
+
+static size_t fmt_i64(char* p, int64_t v) {
+    if (v >= 0)
+        return fmt_u64(p, (uint64_t)v);
+    *p = '-';
+    return 1 + fmt_u64(p + 1, -(uint64_t)v);
+}
+
+// "%.2f" of a float. Times 100 it is still exact in a double, so rounding
+// that half to even, as printf does, gives the same digits.
+static size_t fmt_f32(char* p, size_t cap, float v) {
+    bool const neg = v < 0 || (v == 0 && 1 / v < 0);
+    double const a = neg ? -(double)v : (double)v;
+    if (!(a < 1e15))  // Also NaN
+        return (size_t)snprintf(p, cap, "%.2f", v);
+    // Rounds to an integer in the default rounding mode
+    uint64_t const cents = (uint64_t)((a * 100 + 4503599627370496.0) - 4503599627370496.0);
+    size_t n = 0;
+    if (neg)
+        p[n++] = '-';
+    n += fmt_u64(p + n, cents / 100);
+    p[n++] = '.';
+    p[n++] = (char)('0' + cents / 10 % 10);
+    p[n++] = (char)('0' + cents % 10);
+    return n;
+}
+
+// One value as meas_col_fprint() prints it. printf would dominate the join
+// of a .kpmb log.
+static size_t fmt_col(char* p, size_t cap, meas_col_e type, void const* val) {
+    switch (type) {
+        case MEAS_COL_I32: {
+            int32_t v;
+            memcpy(&v, val, sizeof(v));
+            return fmt_i64(p, v);
+        }
+        case MEAS_COL_I64: {
+            int64_t v;
+            memcpy(&v, val, sizeof(v));
+            return fmt_i64(p, v);
+        }
+        case MEAS_COL_U64: {
+            uint64_t v;
+            memcpy(&v, val, sizeof(v));
+            return fmt_u64(p, v);
+        }
+        case MEAS_COL_F32: {
+            float v;
+            memcpy(&v, val, sizeof(v));
+            return fmt_f32(p, cap, v);
+        }
+    }
+    return 0;
+}
+
+// The current row as the xApp wrote it
+static void xapp_emit(xapp_in_t const* x, FILE* out) {
+    if (!x->bin) {
+        fwrite(x->line, 1, x->len, out);
+        return;
+    }
+    char buf[4096];
+    size_t n = 0;
+    uint32_t const i = x->blk_row - 1;
+    for (uint32_t c = 0; c < x->br.hdr.num_cols; c++) {
+        // Room for "%.2f" of FLT_MAX, past which the row is written out
+        if (sizeof(buf) - n < 64) {
+            fwrite(buf, 1, n, out);
+            n = 0;
+        }
+        if (c > 0)
+            buf[n++] = ',';
+        n += fmt_col(buf + n, sizeof(buf) - n, (meas_col_e)x->br.cols[c].type, meas_bin_reader_val(&x->br, c, i));
+    }
+    fwrite(buf, 1, n, out);
+}
+
+int main(int argc, char* argv[]) {
+    int64_t tolerance_ms = 100, offset_ms = 0, skew_ms = 1000;
+    bool keep_unmatched = false;
+    char const* cols = NULL;
+    char const* paths[3] = {NULL};
+    size_t num_paths = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tolerance-ms") == 0 && i + 1 < argc)
+            tolerance_ms = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--offset-ms") == 0 && i + 1 < argc)
+            offset_ms = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--max-skew-ms") == 0 && i + 1 < argc)
+            skew_ms = atoll(argv[++i]);
+        else if (strcmp(argv[i], "--cols") == 0 && i + 1 < argc)
+            cols = argv[++i];
+        else if (strcmp(argv[i], "--keep-unmatched") == 0)
+            keep_unmatched = true;
+        else if (argv[i][0] == '-' || num_paths == 3)
+            usage(argv[0]);
+        else
+            paths[num_paths++] = argv[i];
+    }
+    if (num_paths < 2 || tolerance_ms < 0 || skew_ms < 0)
+        usage(argv[0]);
+    int64_t const tolerance_us = tolerance_ms * 1000, offset_us = offset_ms * 1000, skew_us = skew_ms * 1000;
+
+    FILE* out = paths[2] != NULL ? fopen(paths[2], "w") : stdout;
+    if (out == NULL) {
+        perror(paths[2]);
+        return EXIT_FAILURE;
+    }
+    setvbuf(out, NULL, _IOFBF, JOIN_READ_SIZE);
+
+    int64_t const t0 = mono_ns();
+    xapp_in_t x;
+    gt_in_t gt;
+    if (!xapp_open(&x, paths[0], out) || !gt_open(&gt, paths[1], cols, out))
+        return EXIT_FAILURE;
+
+    gt_win_t win = {0};
+    int64_t max_t = INT64_MIN;
+    size_t matched = 0, unmatched = 0, late = 0;
+    int64_t dt_sum = 0, dt_max = 0;
+    int64_t t_us;
+    while (xapp_next(&x, tolerance_us, &t_us)) {
+        // Rows behind by more than the skew may have lost their truth rows
+        gt_row_t const* r = NULL;
+        if (max_t == INT64_MIN || t_us >= max_t - skew_us) {
+            if (t_us > max_t)
+                max_t = t_us;
+            int64_t const horizon = max_t - skew_us - tolerance_us;
+            gt_win_evict(&win, horizon);
+            gt_fill(&gt, &win, t_us + tolerance_us + skew_us, horizon, offset_us, tolerance_us);
+            r = gt_nearest(&win, t_us, tolerance_us);
+        } else {
+            late++;
+        }
+        if (r == NULL) {
+            unmatched++;
+            if (!keep_unmatched)
+                continue;
+            xapp_emit(&x, out);
+            for (size_t k = 0; k < gt.num_sel; k++)
+                fputc(',', out);
+            fputs(",\n", out);
+            continue;
+        }
+        int64_t const dt = t_us - r->t_us;
+        matched++;
+        dt_sum += dt;
+        dt_max = llabs(dt) > dt_max ? llabs(dt) : dt_max;
+        xapp_emit(&x, out);
+        fwrite(r->text, 1, r->len, out);
+        fprintf(out, ",%ld\n", (long)dt);
+    }
+    int64_t const t1 = mono_ns();
+
+    bool ok = fflush(out) == 0;
+    if (!ok)
+        perror(paths[2] != NULL ? paths[2] : "stdout");
+    size_t const bytes = x.bin ? (size_t)ftell(x.br.f) : x.rd.bytes;
+    fprintf(stderr, "[JOIN]: %zu xApp rows: %zu labelled, %zu %s (%zu behind by more than %ld ms)\n", x.rows, matched, unmatched,
+            keep_unmatched ? "without labels" : "dropped", late, (long)skew_ms);
+    if (matched > 0)
+        fprintf(stderr, "[JOIN]: xApp minus truth time %+.1f ms on average, %.1f ms at most\n", (double)dt_sum / matched / 1e3,
+                dt_max / 1e3);
+    fprintf(stderr, "[JOIN]: %zu truth rows, %zu out of order, %zu too late for the window\n", gt.read, gt.unordered, gt.late);
+    if (x.bad + gt.bad > 0)
+        fprintf(stderr, "[JOIN]: Skipped rows without a valid timestamp: %zu xApp, %zu truth\n", x.bad, gt.bad);
+    if (x.rounded + gt.rounded > 0)
+        fprintf(stderr, "[JOIN]: Skipped timestamps in E notation: %zu xApp, %zu truth (see kpm_csv2bin)\n", x.rounded,
+                gt.rounded);
+    fprintf(stderr, "[JOIN]: %.1f MB joined in %.1f ms, window of %zu rows at most\n", (bytes + gt.rd.bytes) / 1e6,
+            (t1 - t0) / 1e6, win.peak);
+
+    for (size_t k = 0; k < win.cap; k++)
+        free(win.rows[k].text);
+    free(win.rows);
+    if (x.bin)
+        meas_bin_reader_close(&x.br);
+    else
+        rd_close(&x.rd);
+    rd_close(&gt.rd);
+    if (out != stdout)
+        ok &= fclose(out) == 0;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
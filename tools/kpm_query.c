@@ -0,0 +1,141 @@
+// Range queries on a measurement store (sink = tsdb, see meas_tsdb.h).
+// Prints the matching rows as CSV, straight from the mapped column files.
+//
+// Build: gcc -O2 -o kpm_query tools/kpm_query.c
+// Usage: kpm_query [--table raw|1s|10s|1m] [--ue RAN_UE_ID] [--from US] [--to US]
+//                  [--last S] [--cols a,b,...] [--count] store.tsdb
+//
+// --from and --to are timestamps in μs, --last the seconds before the
+// newest row. Without --cols, every column is printed.
+
+#include "../meas_tsdb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void usage(char const* prog) {
+    fprintf(stderr,
+            "Usage: %s [--table raw|1s|10s|1m] [--ue RAN_UE_ID] [--from US] [--to US] [--last S] [--cols a,b,...] [--count] "
+            "store.tsdb\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Newest time of the table, from its index
+static int64_t table_t_max(meas_tsdb_table_t const* t) {
+    int64_t t_max = INT64_MIN;
+    for (size_t i = 0; i < meas_tsdb_idx_len(t->rows); i++) {
+        if (t->idx[i].t_max > t_max)
+            t_max = t->idx[i].t_max;
+    }
+    return t_max;
+}
+
+int main(int argc, char* argv[]) {
+    char const* table = "raw";
+    char const* store = NULL;
+    char const* col_list = NULL;
+    bool by_ue = false;
+    uint64_t ue = 0;
+    int64_t t0 = INT64_MIN;
+    int64_t t1 = INT64_MAX;
+    double last_s = -1;
+    bool count_only = false;
+    for (int i = 1; i < argc; i++) {
+        char const* a = argv[i];
+        bool const has_val = i + 1 < argc;
+        if (strcmp(a, "--table") == 0 && has_val)
+            table = argv[++i];
+        else if (strcmp(a, "--ue") == 0 && has_val)
+            by_ue = true, ue = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(a, "--from") == 0 && has_val)
+            t0 = strtoll(argv[++i], NULL, 10);
+        else if (strcmp(a, "--to") == 0 && has_val)
+            t1 = strtoll(argv[++i], NULL, 10);
+        else if (strcmp(a, "--last") == 0 && has_val)
+            last_s = strtod(argv[++i], NULL);
+        else if (strcmp(a, "--cols") == 0 && has_val)
+            col_list = argv[++i];
+        else if (strcmp(a, "--count") == 0)
+            count_only = true;
+        else if (a[0] == '-' || store != NULL)
+            usage(argv[0]);
+        else
+            store = a;
+    }
+    if (store == NULL)
+        usage(argv[0]);
+
+    int64_t const t_open = mono_ns();
+    char dir[MEAS_TSDB_PATH_LEN];
+    snprintf(dir, sizeof(dir), "%s/%s", store, table);
+    meas_tsdb_table_t t;
+    if (!meas_tsdb_table_open(&t, dir)) {
+        meas_tsdb_table_close(&t);
+        return EXIT_FAILURE;
+    }
+    if (last_s >= 0 && t.rows > 0) {
+        int64_t const newest = table_t_max(&t);
+        t0 = newest - (int64_t)(last_s * 1e6);
+        t1 = newest;
+    }
+
+    uint32_t cols[MEAS_TSDB_MAX_COLS];
+    uint32_t num_cols = 0;
+    if (col_list == NULL) {
+        for (uint32_t c = 0; c < t.num_cols; c++)
+            cols[num_cols++] = c;
+    } else {
+        char buf[1024];
+        snprintf(buf, sizeof(buf), "%s", col_list);
+        for (char* tok = strtok(buf, ","); tok != NULL && num_cols < MEAS_TSDB_MAX_COLS; tok = strtok(NULL, ",")) {
+            int const c = meas_tsdb_col_find(&t, tok);
+            if (c < 0) {
+                fprintf(stderr, "[QUERY]: %s has no column %s\n", dir, tok);
+                meas_tsdb_table_close(&t);
+                return EXIT_FAILURE;
+            }
+            cols[num_cols++] = (uint32_t)c;
+        }
+    }
+    int const ue_col = by_ue ? meas_tsdb_col_find(&t, "ue_ran_ue_id") : -1;
+
+    if (!count_only) {
+        for (uint32_t k = 0; k < num_cols; k++)
+            printf("%s%s", k > 0 ? "," : "", t.meta->col[cols[k]].name);
+        putchar('\n');
+    }
+
+    int64_t const t_scan = mono_ns();
+    meas_tsdb_scan_t scan;
+    meas_tsdb_scan_init(&scan, &t, t0, t1, ue_col, ue);
+    uint64_t row;
+    uint64_t matched = 0;
+    while (meas_tsdb_scan_next(&scan, &row)) {
+        matched++;
+        if (count_only)
+            continue;
+        for (uint32_t k = 0; k < num_cols; k++) {
+            meas_tsdb_col_t const* col = &t.meta->col[cols[k]];
+            if (k > 0)
+                putchar(',');
+            meas_col_fprint(stdout, (meas_col_e)col->type, (uint8_t const*)meas_tsdb_col(&t, cols[k]) + row * col->width);
+        }
+        putchar('\n');
+    }
+    int64_t const t_end = mono_ns();
+
+    if (count_only)
+        printf("%lu\n", (unsigned long)matched);
+    fprintf(stderr, "[QUERY]: %lu of %lu rows in %s, %lu scanned, open %.3f ms, scan %.3f ms\n", (unsigned long)matched,
+            (unsigned long)t.rows, table, (unsigned long)scan.scanned, (t_scan - t_open) / 1e6, (t_end - t_scan) / 1e6);
+    meas_tsdb_table_close(&t);
+    return EXIT_SUCCESS;
+}
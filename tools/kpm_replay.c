@@ -0,0 +1,629 @@
+// Offline replay of recorded KPM measurements through an xApp's own
+// callback and RC policy, without a gNB, a core or a nearRT-RIC.
+//
+// The xApp source is included with its main() compiled out. Recorded rows
+// are rebuilt into KPM format-3 indications and fed to the callback of a
+// single node shard. For the RC xApps, that shard's worker controls one
+// emulated E2 node and control_sm_xapp_api() below only counts and times
+// the requests.
+//
+// Inputs: the per-UE CSV and .kpmb files the xApps write now, and the
+// older wide CSVs with ue1_*, ue2_* column groups.
+//
+// Build it next to the xApps in the FlexRIC tree, linked with the KPM and
+// RC SM IE sources and FlexRIC util, but not with the xApp library:
+//   -DREPLAY_XAPP='"../xapp_kpm_rc_setTime.c"' picks another xApp's
+//   defaults (default: xapp_RC_KPM_Infinity.c), --policy another policy.
+// Link with -ldl for plugin policies.
+//
+// Usage: kpm_replay [--speed recorded|N|max] [--repeat N] [-o meas_base] [xApp options] input
+//
+// xApp options are those of xapp_cfg.h (--config file, --period-ms 100,
+// ...), and SIGHUP reloads them as in the xApp. Recorded rows keep their
+// own spacing whatever the report period, so adaptive sampling is off
+// unless --fast-period-ms is given, and so is /metrics unless
+// --metrics-port is.
+
+#define XAPP_NO_MAIN
+#ifndef REPLAY_XAPP
+#define REPLAY_XAPP "../xapp_RC_KPM_Infinity.c"
+#endif
+#include REPLAY_XAPP
+
+// Recorded gaps outside (0, REPLAY_MAX_GAP_US] fall back to the report
+// period. Spreadsheet-mangled timestamps (1.76159E+15) end up there, as do
+// the latencies of seconds-based collectStartTime, see collect_latency_us().
+#define REPLAY_MAX_GAP_US 10000000
+#define REPLAY_DRAIN_MS 500
+
+/////////////////////////////
+// Latency statistics
+/////////////////////////////
+
+typedef struct {
+    char const* name;
+    int64_t* ns;
+    size_t len, cap;
+} replay_stage_t;
+
+static void stage_add(replay_stage_t* st, int64_t ns) {
+    if (st->len == st->cap) {
+        st->cap = st->cap == 0 ? 1024 : st->cap * 2;
+        st->ns = realloc(st->ns, st->cap * sizeof(int64_t));
+        assert(st->ns != NULL && "Memory exhausted");
+    }
+    st->ns[st->len++] = ns;
+}
+
+static int cmp_i64(void const* a, void const* b) {
+    int64_t const x = *(int64_t const*)a, y = *(int64_t const*)b;
+    return (x > y) - (x < y);
+}
+
+static void stage_report(replay_stage_t* st) {
+    if (st->len == 0) {
+        printf("  %-10s %8d\n", st->name, 0);
+        return;
+    }
+    qsort(st->ns, st->len, sizeof(int64_t), cmp_i64);
+    double sum = 0;
+    for (size_t i = 0; i < st->len; i++)
+        sum += st->ns[i];
+    printf("  %-10s %8zu %10.2f %10.2f %10.2f %10.2f\n",
+           st->name, st->len,
+           sum / st->len / 1000.0,
+           st->ns[st->len / 2] / 1000.0,
+           st->ns[(size_t)(st->len * 0.99)] / 1000.0,
+           st->ns[st->len - 1] / 1000.0);
+    free(st->ns);
+    st->ns = NULL;
+    st->len = st->cap = 0;
+}
+
+static int64_t mono_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/////////////////////////////
+// Emulated xApp API
+/////////////////////////////
+
+static _Atomic int64_t last_dispatch_ns;
+static pthread_mutex_t ctrl_stats_mtx = PTHREAD_MUTEX_INITIALIZER;
+static replay_stage_t stage_ctrl = {.name = "control"};
+
+// Time from the most recent indication to the control request. Exact at
+// recorded speed, a lower bound when indications overtake the RC thread.
+sm_ans_xapp_t control_sm_xapp_api(global_e2_node_id_t* id, uint32_t rf_id, void* wr) {
+    (void)id;
+    (void)wr;
+    assert(rf_id == 3 && "Only RC control is emulated");
+    int64_t const ns = mono_ns() - atomic_load(&last_dispatch_ns);
+    pthread_mutex_lock(&ctrl_stats_mtx);
+    stage_add(&stage_ctrl, ns);
+    pthread_mutex_unlock(&ctrl_stats_mtx);
+    return (sm_ans_xapp_t){.success = true};
+}
+
+// The emulated node reports whatever the replay feeds, to its newest
+// subscription, as a node whose next report comes from the subscription
+// the xApp just swapped in
+static pthread_mutex_t subs_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct {
+    int handle;
+    sm_cb cb;
+} subs[NODE_SHARD_SUBS];
+static size_t num_subs;
+
+sm_ans_xapp_t report_sm_xapp_api(global_e2_node_id_t* id, uint32_t rf_id, void* data, sm_cb handler) {
+    (void)id;
+    static int handle;
+    kpm_sub_data_t const* sub = data;
+    assert(rf_id == 2 && "Only KPM reports are emulated");
+    pthread_mutex_lock(&subs_mtx);
+    assert(num_subs < NODE_SHARD_SUBS && "The replay emulates a single node");
+    subs[num_subs].handle = ++handle;
+    subs[num_subs++].cb = handler;
+    pthread_mutex_unlock(&subs_mtx);
+    printf("[REPLAY]: KPM subscription %d, report period %u [ms]\n", handle,
+           sub->ev_trg_def.kpm_ric_event_trigger_format_1.report_period_ms);
+    return (sm_ans_xapp_t){.success = true, .u.handle = handle};
+}
+
+void rm_report_sm_xapp_api(int const handle) {
+    pthread_mutex_lock(&subs_mtx);
+    for (size_t i = 0; i < num_subs; i++) {
+        if (subs[i].handle == handle) {
+            memmove(&subs[i], &subs[i + 1], (num_subs - i - 1) * sizeof(subs[0]));
+            num_subs--;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&subs_mtx);
+    printf("[REPLAY]: KPM subscription %d removed\n", handle);
+}
+
+// Callback of the newest subscription, NULL when there is none
+static sm_cb replay_sub_cb(void) {
+    pthread_mutex_lock(&subs_mtx);
+    sm_cb const cb = num_subs > 0 ? subs[num_subs - 1].cb : NULL;
+    pthread_mutex_unlock(&subs_mtx);
+    return cb;
+}
+
+/////////////////////////////
+// Recorded rows
+/////////////////////////////
+
+typedef struct {
+    meas_row_t* row;
+    size_t len, cap;
+} replay_rows_t;
+
+static meas_row_t* rows_push(replay_rows_t* rows) {
+    if (rows->len == rows->cap) {
+        rows->cap = rows->cap == 0 ? 1024 : rows->cap * 2;
+        rows->row = realloc(rows->row, rows->cap * sizeof(meas_row_t));
+        assert(rows->row != NULL && "Memory exhausted");
+    }
+    meas_row_t* r = &rows->row[rows->len++];
+    memset(r, 0, sizeof(*r));
+    return r;
+}
+
+static int meas_col_idx(char const* name) {
+    if (strcmp(name, "ue_delay_dl_us") == 0)  // setTime's name for the delay column
+        name = "ue_delay_us";
+    for (size_t c = 0; c < MEAS_NUM_COLS; c++) {
+        if (strcmp(meas_cols[c].name, name) == 0)
+            return (int)c;
+    }
+    return -1;
+}
+
+static void meas_col_set(meas_row_t* r, int c, double v) {
+    void* dst = (uint8_t*)r + meas_cols[c].offset;
+    switch (meas_cols[c].type) {
+        case MEAS_COL_I32:
+            *(int32_t*)dst = (int32_t)v;
+            break;
+        case MEAS_COL_I64:
+            *(int64_t*)dst = (int64_t)v;
+            break;
+        case MEAS_COL_U64:
+            *(uint64_t*)dst = (uint64_t)v;
+            break;
+        case MEAS_COL_F32:
+            *(float*)dst = (float)v;
+            break;
+    }
+}
+
+static double meas_col_get(void const* src, meas_col_e type) {
+    switch (type) {
+        case MEAS_COL_I32:
+            return *(int32_t const*)src;
+        case MEAS_COL_I64:
+            return (double)*(int64_t const*)src;
+        case MEAS_COL_U64:
+            return (double)*(uint64_t const*)src;
+        case MEAS_COL_F32:
+            return *(float const*)src;
+    }
+    return 0;
+}
+
+static bool load_bin(char const* path, replay_rows_t* rows) {
+    meas_bin_reader_t r;
+    if (!meas_bin_reader_open(&r, path))
+        return false;
+    int* map = calloc(r.hdr.num_cols, sizeof(int));
+    assert(map != NULL && "Memory exhausted");
+    for (uint32_t c = 0; c < r.hdr.num_cols; c++)
+        map[c] = meas_col_idx(r.cols[c].name);
+
+    while (meas_bin_reader_next(&r)) {
+        for (uint32_t i = 0; i < r.rows; i++) {
+            meas_row_t* row = rows_push(rows);
+            for (uint32_t c = 0; c < r.hdr.num_cols; c++) {
+                if (map[c] >= 0)
+                    meas_col_set(row, map[c], meas_col_get(meas_bin_reader_val(&r, c, i), (meas_col_e)r.cols[c].type));
+            }
+        }
+    }
+    free(map);
+    meas_bin_reader_close(&r);
+    return true;
+}
+
+// Both the per-UE CSV and the older wide CSV, where each line holds every
+// UE as a ue<k>_* column group
+typedef struct {
+    int ue;   // 0: shared by all UEs of the line
+    int col;  // meas_cols index, -1: ignored
+} csv_col_t;
+
+static bool load_csv(char const* path, replay_rows_t* rows) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    char* line = NULL;
+    size_t line_cap = 0;
+    if (getline(&line, &line_cap, f) < 0) {
+        fprintf(stderr, "[REPLAY]: %s is empty\n", path);
+        fclose(f);
+        return false;
+    }
+
+    csv_col_t* cols = NULL;
+    size_t num_cols = 0;
+    int num_ue = 1;
+    for (char* tok = strtok(line, ",\r\n"); tok != NULL; tok = strtok(NULL, ",\r\n")) {
+        cols = realloc(cols, (num_cols + 1) * sizeof(csv_col_t));
+        assert(cols != NULL && "Memory exhausted");
+        csv_col_t* c = &cols[num_cols++];
+        c->ue = 0;
+        char name[MEAS_BIN_COL_NAME_LEN + 8];
+        int k = 0, n = 0;
+        if (sscanf(tok, "ue%d_%n", &k, &n) == 1 && n > 0 && k > 0) {
+            snprintf(name, sizeof(name), "ue_%s", tok + n);
+            c->ue = k;
+            num_ue = k > num_ue ? k : num_ue;
+        } else {
+            snprintf(name, sizeof(name), "%s", tok);
+        }
+        c->col = meas_col_idx(name);
+    }
+
+    meas_row_t* line_rows = calloc(num_ue, sizeof(meas_row_t));
+    assert(line_rows != NULL && "Memory exhausted");
+    while (getline(&line, &line_cap, f) > 0) {
+        if (line[0] == '\n' || line[0] == '\r')
+            continue;
+        memset(line_rows, 0, num_ue * sizeof(meas_row_t));
+        char* p = line;
+        for (size_t i = 0; i < num_cols && p != NULL; i++) {
+            char* next = strchr(p, ',');
+            if (next != NULL)
+                *next++ = '\0';
+            if (cols[i].col >= 0) {
+                double const v = strtod(p, NULL);
+                if (cols[i].ue == 0) {
+                    for (int u = 0; u < num_ue; u++)
+                        meas_col_set(&line_rows[u], cols[i].col, v);
+                } else {
+                    meas_col_set(&line_rows[cols[i].ue - 1], cols[i].col, v);
+                }
+            }
+            p = next;
+        }
+        for (int u = 0; u < num_ue; u++)
+            *rows_push(rows) = line_rows[u];
+    }
+
+    free(line_rows);
+    free(cols);
+    free(line);
+    fclose(f);
+    return true;
+}
+
+static bool load_rows(char const* path, replay_rows_t* rows) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        perror(path);
+        return false;
+    }
+    char magic[4] = {0};
+    size_t const n = fread(magic, 1, sizeof(magic), f);
+    fclose(f);
+    if (n == sizeof(magic) && memcmp(magic, MEAS_BIN_MAGIC, 4) == 0)
+        return load_bin(path, rows);
+    return load_csv(path, rows);
+}
+
+/////////////////////////////
+// Indication builder
+/////////////////////////////
+
+// Records are sent in this order, which is also the subscription order
+static char const* const replay_meas_names[] = {
+    "RRU.PrbTotDl",
+    "RRU.PrbTotUl",
+    "DRB.PdcpSduVolumeDL",
+    "DRB.PdcpSduVolumeUL",
+    "DRB.RlcSduDelayDl",
+    "DRB.UEThpDl",
+    "DRB.UEThpUl",
+};
+#define REPLAY_NUM_MEAS (sizeof(replay_meas_names) / sizeof(replay_meas_names[0]))
+
+static byte_array_t ba_from_str(char const* s) {
+    return (byte_array_t){.len = strlen(s), .buf = (uint8_t*)s};
+}
+
+typedef struct {
+    size_t cap;
+    meas_report_per_ue_t* per_ue;
+    meas_data_lst_t* data;
+    meas_record_lst_t* rec;
+    uint64_t* ran_ue_id;
+    meas_info_format_1_lst_t info[REPLAY_NUM_MEAS];
+    sm_ag_if_rd_t rd;
+} replay_ind_t;
+
+static void replay_ind_init(replay_ind_t* b) {
+    memset(b, 0, sizeof(*b));
+    for (size_t m = 0; m < REPLAY_NUM_MEAS; m++) {
+        b->info[m].meas_type.type = NAME_MEAS_TYPE;
+        b->info[m].meas_type.name = ba_from_str(replay_meas_names[m]);
+    }
+    b->rd.type = INDICATION_MSG_AGENT_IF_ANS_V0;
+    b->rd.ind.type = KPM_STATS_V3_0;
+    b->rd.ind.kpm.ind.hdr.type = FORMAT_1_INDICATION_HEADER;
+    b->rd.ind.kpm.ind.msg.type = FORMAT_3_INDICATION_MESSAGE;
+}
+
+static void replay_ind_free(replay_ind_t* b) {
+    free(b->per_ue);
+    free(b->data);
+    free(b->rec);
+    free(b->ran_ue_id);
+}
+
+// Buffers are reused from one indication to the next
+static sm_ag_if_rd_t const* replay_ind_build(replay_ind_t* b, meas_row_t const* rows, size_t n) {
+    if (n > b->cap) {
+        b->cap = n;
+        b->per_ue = realloc(b->per_ue, n * sizeof(meas_report_per_ue_t));
+        b->data = realloc(b->data, n * sizeof(meas_data_lst_t));
+        b->rec = realloc(b->rec, n * REPLAY_NUM_MEAS * sizeof(meas_record_lst_t));
+        b->ran_ue_id = realloc(b->ran_ue_id, n * sizeof(uint64_t));
+        assert(b->per_ue != NULL && b->data != NULL && b->rec != NULL && b->ran_ue_id != NULL && "Memory exhausted");
+    }
+
+    int64_t lat = rows[0].latency_us;
+    if (lat < 0 || lat > REPLAY_MAX_GAP_US)
+        lat = 0;
+    kpm_ind_data_t* ind = &b->rd.ind.kpm.ind;
+    ind->hdr.kpm_ric_ind_hdr_format_1.collectStartTime = time_now_us() - lat;
+    ind->msg.frm_3.ue_meas_report_lst_len = n;
+    ind->msg.frm_3.meas_report_per_ue = b->per_ue;
+
+    for (size_t i = 0; i < n; i++) {
+        meas_row_t const* r = &rows[i];
+        meas_record_lst_t* rec = &b->rec[i * REPLAY_NUM_MEAS];
+        rec[0] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)r->ue_prb_dl};
+        rec[1] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)r->ue_prb_ul};
+        rec[2] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)r->ue_pdcp_dl_kb};
+        rec[3] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)r->ue_pdcp_ul_kb};
+        rec[4] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = r->ue_delay_us};
+        rec[5] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = r->ue_thp_dl_kbps};
+        rec[6] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = r->ue_thp_ul_kbps};
+
+        b->data[i] = (meas_data_lst_t){.meas_record_len = REPLAY_NUM_MEAS, .meas_record_lst = rec};
+        b->ran_ue_id[i] = r->ue_ran_ue_id;
+
+        meas_report_per_ue_t* ue = &b->per_ue[i];
+        memset(ue, 0, sizeof(*ue));
+        ue->ue_meas_report_lst.type = GNB_UE_ID_E2SM;
+        ue->ue_meas_report_lst.gnb.amf_ue_ngap_id = r->ue_ngap_id;
+        ue->ue_meas_report_lst.gnb.ran_ue_id = &b->ran_ue_id[i];
+        ue->ind_msg_format_1.meas_data_lst_len = 1;
+        ue->ind_msg_format_1.meas_data_lst = &b->data[i];
+        ue->ind_msg_format_1.meas_info_lst_len = REPLAY_NUM_MEAS;
+        ue->ind_msg_format_1.meas_info_lst = b->info;
+    }
+    return &b->rd;
+}
+
+/////////////////////////////
+// Emulated E2 node
+/////////////////////////////
+
+// What a gNB with KPM report style 4 and RC "Radio Bearer Control" announces
+typedef struct {
+    meas_info_for_action_lst_t meas[REPLAY_NUM_MEAS];
+    ric_report_style_item_t report;
+    ric_event_trigger_style_item_t ev_trig;
+    seq_ran_param_3_t rc_param[2];
+    seq_ctrl_act_2_t rc_act;
+    seq_ctrl_style_t rc_style;
+    ran_func_def_ctrl_t rc_ctrl;
+    sm_ran_function_t rf[2];
+    e2_node_connected_xapp_t node;
+} replay_node_t;
+
+static void replay_node_init(replay_node_t* e) {
+    memset(e, 0, sizeof(*e));
+    for (size_t m = 0; m < REPLAY_NUM_MEAS; m++)
+        e->meas[m].name = ba_from_str(replay_meas_names[m]);
+    e->report.report_style_type = STYLE_4_RIC_SERVICE_REPORT;
+    e->report.act_def_format_type = FORMAT_4_ACTION_DEFINITION;
+    e->report.meas_info_for_action_lst_len = REPLAY_NUM_MEAS;
+    e->report.meas_info_for_action_lst = e->meas;
+    e->report.ind_hdr_format_type = FORMAT_1_INDICATION_HEADER;
+    e->report.ind_msg_format_type = FORMAT_3_INDICATION_MESSAGE;
+    e->ev_trig.format_type = FORMAT_1_RIC_EVENT_TRIGGER;
+
+    e->rf[0].id = 2;
+    e->rf[0].defn.type = KPM_RAN_FUNC_DEF_E;
+    e->rf[0].defn.kpm.sz_ric_event_trigger_style_list = 1;
+    e->rf[0].defn.kpm.ric_event_trigger_style_list = &e->ev_trig;
+    e->rf[0].defn.kpm.sz_ric_report_style_list = 1;
+    e->rf[0].defn.kpm.ric_report_style_list = &e->report;
+
+    e->rc_param[0] = (seq_ran_param_3_t){.id = 1, .name = ba_from_str("DRB ID")};
+    e->rc_param[1] = (seq_ran_param_3_t){.id = 2, .name = ba_from_str("List of QoS Flows to be modified in DRB")};
+    e->rc_act.id = 2;
+    e->rc_act.name = ba_from_str("QoS flow mapping configuration");
+    e->rc_act.sz_seq_assoc_ran_param = 2;
+    e->rc_act.assoc_ran_param = e->rc_param;
+    e->rc_style.style_type = 1;
+    e->rc_style.name = ba_from_str("Radio Bearer Control");
+    e->rc_style.hdr = FORMAT_1_E2SM_RC_CTRL_HDR;
+    e->rc_style.msg = FORMAT_1_E2SM_RC_CTRL_MSG;
+    e->rc_style.sz_seq_ctrl_act = 1;
+    e->rc_style.seq_ctrl_act = &e->rc_act;
+    e->rc_ctrl.sz_seq_ctrl_style = 1;
+    e->rc_ctrl.seq_ctrl_style = &e->rc_style;
+
+    e->rf[1].id = 3;
+    e->rf[1].defn.type = RC_RAN_FUNC_DEF_E;
+    e->rf[1].defn.rc.ctrl = &e->rc_ctrl;
+
+    e->node.id.type = ngran_gNB;
+    e->node.len_rf = 2;
+    e->node.rf = e->rf;
+}
+
+/////////////////////////////
+// Replay
+/////////////////////////////
+
+static void usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [--speed recorded|N|max] [--repeat N] [-o meas_base] [xApp options] input.{csv,kpmb}\n", prog);
+    xapp_cfg_usage(prog);
+    exit(EXIT_FAILURE);
+}
+
+static void sleep_until_ns(int64_t t) {
+    struct timespec ts = {.tv_sec = t / 1000000000, .tv_nsec = t % 1000000000};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+        ;
+}
+
+int main(int argc, char* argv[]) {
+    // Recorded rows keep their spacing, the period must not change under them
+    cfg.fast_period_ms = 0;
+    // A replay next to the xApp must not take its port
+    cfg.metrics_port = 0;
+    if (!xapp_cfg_args(&cfg, &argc, argv))
+        usage(argv[0]);
+    xapp_cfg_watch(on_config_reload);
+
+    double speed = 1.0;  // 0: as fast as possible
+    int repeat = 1;
+    char const* meas_base = NULL;
+    char const* in_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            char const* v = argv[++i];
+            speed = strcmp(v, "max") == 0 ? 0.0 : strcmp(v, "recorded") == 0 ? 1.0 : atof(v);
+            if (speed < 0)
+                usage(argv[0]);
+        } else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+            repeat = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            meas_base = argv[++i];
+        } else if (in_path == NULL && argv[i][0] != '-') {
+            in_path = argv[i];
+        } else {
+            usage(argv[0]);
+        }
+    }
+    if (in_path == NULL || repeat < 1)
+        usage(argv[0]);
+
+    replay_rows_t rows = {0};
+    if (!load_rows(in_path, &rows) || rows.len == 0) {
+        fprintf(stderr, "[REPLAY]: No rows in %s\n", in_path);
+        return EXIT_FAILURE;
+    }
+
+    // Consecutive rows of the same indication form one indication
+    size_t* ind_start = calloc(rows.len + 1, sizeof(size_t));
+    assert(ind_start != NULL && "Memory exhausted");
+    size_t num_ind = 0;
+    for (size_t i = 0; i < rows.len; i++) {
+        if (i == 0 || rows.row[i].indication_counter != rows.row[i - 1].indication_counter
+                   || rows.row[i].timestamp != rows.row[i - 1].timestamp)
+            ind_start[num_ind++] = i;
+    }
+    ind_start[num_ind] = rows.len;
+    printf("[REPLAY]: %zu indications, %zu UE reports from %s\n", num_ind, rows.len, in_path);
+
+    xlog_start();
+    xapp_cfg_log(&cfg);
+    if (!xapp_init(meas_base)) {
+        xlog_stop();
+        return EXIT_FAILURE;
+    }
+
+    replay_node_t enode;
+    replay_node_init(&enode);
+    shard_t* shard;
+    {
+        lock_guard(&sub_mtx);
+        shard = shard_open(&enode.node, &enode.rf[0].defn.kpm);
+    }
+    subscriptions_start();
+    metrics_start();
+
+    replay_ind_t b;
+    replay_ind_init(&b);
+    replay_stage_t stage_build = {.name = "build"};
+    replay_stage_t stage_cb = {.name = "callback"};
+
+    int64_t const t_start = mono_ns();
+    int64_t offset_us = 0;
+    for (int r = 0; r < repeat; r++) {
+        for (size_t k = 0; k < num_ind; k++) {
+            meas_row_t const* first = &rows.row[ind_start[k]];
+            size_t const n = ind_start[k + 1] - ind_start[k];
+
+            if (speed > 0) {
+                int64_t gap = k > 0 ? first->timestamp - rows.row[ind_start[k - 1]].timestamp : 0;
+                if (gap <= 0 || gap > REPLAY_MAX_GAP_US) {
+                    pthread_mutex_lock(&shard->mtx);
+                    gap = (r > 0 || k > 0) ? (int64_t)shard->period_ms * 1000 : 0;
+                    pthread_mutex_unlock(&shard->mtx);
+                }
+                offset_us += gap;
+                sleep_until_ns(t_start + (int64_t)(offset_us * 1000 / speed));
+            }
+
+            int64_t const t0 = mono_ns();
+            sm_ag_if_rd_t const* rd = replay_ind_build(&b, first, n);
+            int64_t const t1 = mono_ns();
+            atomic_store(&last_dispatch_ns, t1);
+            sm_cb const cb = replay_sub_cb();
+            if (cb != NULL)
+                cb(rd);
+            int64_t const t2 = mono_ns();
+            stage_add(&stage_build, t1 - t0);
+            stage_add(&stage_cb, t2 - t1);
+        }
+    }
+    int64_t const t_end = mono_ns();
+
+    // Let the RC thread act on the last indications
+    usleep(REPLAY_DRAIN_MS * 1000);
+    subscriptions_stop();
+
+    double const secs = (t_end - t_start) / 1e9;
+    size_t const total = num_ind * (size_t)repeat;
+    printf("\n[REPLAY]: %zu indications in %.3f s = %.1f indications/s\n", total, secs, total / secs);
+    printf("  %-10s %8s %10s %10s %10s %10s  [us]\n", "stage", "count", "mean", "p50", "p99", "max");
+    stage_report(&stage_build);
+    stage_report(&stage_cb);
+    pthread_mutex_lock(&ctrl_stats_mtx);
+    stage_report(&stage_ctrl);
+    pthread_mutex_unlock(&ctrl_stats_mtx);
+    {
+        // The xApp's own stage histograms, as its [LATENCY] lines
+        lock_guard(&sub_mtx);
+        stage_summary(true);
+    }
+
+    xapp_free();
+    replay_ind_free(&b);
+    free(ind_start);
+    free(rows.row);
+    xlog_stop();
+    return EXIT_SUCCESS;
+}
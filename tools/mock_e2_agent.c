@@ -0,0 +1,395 @@
+// Stand-in E2 node for load testing the xApps without radios, a core or
+// Docker. It announces KPM (RAN function 2, report style 4) and RC (RAN
+// function 3, "Radio Bearer Control") like nr-softmodem does, reports
+// format-3 indications for any number of UEs, and counts RC controls.
+//
+// Traffic follows traffic_gen_bursty.sh: odd UEs are mMTC at a fixed
+// 2 Mbps, even UEs are URLLC at 8 Mbps with 16 Mbps bursts during the last
+// 20 s of every 70 s cycle. The indication period is the report period
+// the xApp subscribes with.
+//
+// Built like FlexRIC's emulator agent. Point -p at a directory holding
+// only the KPM and RC SM plugins, since no other SM is emulated:
+//   mock_e2_agent --ues 2000 [--stagger] [--prb-scale 12] -c flexric.conf -p sm_kpm_rc/
+//
+// --stagger spreads the URLLC bursts over the cycle instead of aligning
+// them. --prb-scale multiplies the PRB counts, e.g. 12 to report
+// subcarriers the way xapp_kpm_rc_setTime.c expects.
+
+#include "../../../../../src/agent/e2_agent_api.h"
+#include "../../../../../src/sm/kpm_sm/kpm_data_ie_wrapper.h"
+#include "../../../../../src/sm/rc_sm/rc_data_ie.h"
+#include "../../../../../src/util/time_now_us.h"
+#include "../xlog.h"
+
+#include <assert.h>
+#include <math.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MOCK_TOTAL_PRB 106
+// UL throughput one PRB carries, for the synthetic PRB usage
+#define MOCK_KBPS_PER_PRB 300.0
+#define MOCK_STATS_PERIOD_S 10
+
+typedef struct {
+    int num_ues;
+    double mmtc_kbps;
+    double urllc_base_kbps;
+    double urllc_burst_kbps;
+    int cycle_s;
+    int burst_s;  // At the end of each cycle
+    bool stagger;
+    int prb_scale;
+} mock_profile_t;
+
+static mock_profile_t profile = {
+    .num_ues = 2,
+    .mmtc_kbps = 2000,
+    .urllc_base_kbps = 8000,
+    .urllc_burst_kbps = 16000,
+    .cycle_s = 70,
+    .burst_s = 20,
+    .stagger = false,
+    .prb_scale = 1,
+};
+
+static int64_t start_us;
+static uint64_t rnd_state = 0x9e3779b97f4a7c15;
+static atomic_uint_fast64_t ind_cnt;
+static atomic_uint_fast64_t ue_report_cnt;
+static atomic_uint_fast64_t ctrl_cnt;
+
+/////////////////////////////
+// Synthetic traffic
+/////////////////////////////
+
+// Uniform in [-1, 1). Only the agent's indication thread draws from it.
+static double noise(void) {
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 7;
+    rnd_state ^= rnd_state << 17;
+    return (double)(rnd_state >> 11) / (double)(1ull << 52) - 1.0;
+}
+
+static bool is_urllc(int ue) {
+    return ue % 2 == 1;  // UE1 mMTC, UE2 URLLC, ...
+}
+
+static bool in_burst(int ue, int64_t now) {
+    if (!is_urllc(ue))
+        return false;
+    double t = (now - start_us) / 1e6;
+    if (profile.stagger)
+        t += (double)profile.cycle_s * ue / profile.num_ues;
+    double const pos = fmod(t, profile.cycle_s);
+    return pos >= profile.cycle_s - profile.burst_s;
+}
+
+typedef enum {
+    KPI_PRB_DL,
+    KPI_PRB_UL,
+    KPI_PDCP_DL,
+    KPI_PDCP_UL,
+    KPI_RLC_DELAY_DL,
+    KPI_THP_DL,
+    KPI_THP_UL,
+    KPI_UNKNOWN,
+    KPI_END,
+} mock_kpi_e;
+
+static char const* const kpi_names[KPI_UNKNOWN] = {
+    "RRU.PrbTotDl",
+    "RRU.PrbTotUl",
+    "DRB.PdcpSduVolumeDL",
+    "DRB.PdcpSduVolumeUL",
+    "DRB.RlcSduDelayDl",
+    "DRB.UEThpDl",
+    "DRB.UEThpUl",
+};
+
+static mock_kpi_e kpi_from_name(byte_array_t name) {
+    for (int k = 0; k < KPI_UNKNOWN; k++) {
+        if (cmp_str_ba(kpi_names[k], name) == 0)
+            return (mock_kpi_e)k;
+    }
+    return KPI_UNKNOWN;
+}
+
+static void fill_ue_kpis(int ue, int64_t now, uint32_t period_ms, meas_record_lst_t out[KPI_END]) {
+    bool const burst = in_burst(ue, now);
+    double const rate = !is_urllc(ue) ? profile.mmtc_kbps : burst ? profile.urllc_burst_kbps : profile.urllc_base_kbps;
+    double const thp_ul = rate * (1.0 + 0.03 * noise());
+    double const thp_dl = thp_ul * 0.001 * (1.0 + 0.2 * noise());  // Transport-layer feedback only
+    double const secs = period_ms / 1000.0;
+
+    int prb_ul = (int)ceil(thp_ul / MOCK_KBPS_PER_PRB);
+    prb_ul = prb_ul > MOCK_TOTAL_PRB ? MOCK_TOTAL_PRB : prb_ul;
+
+    out[KPI_PRB_DL] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)(1 * profile.prb_scale)};
+    out[KPI_PRB_UL] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)(prb_ul * profile.prb_scale)};
+    out[KPI_PDCP_DL] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)(thp_dl * secs)};
+    out[KPI_PDCP_UL] = (meas_record_lst_t){.value = INTEGER_MEAS_VALUE, .int_val = (uint32_t)(thp_ul * secs)};
+    out[KPI_RLC_DELAY_DL] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = (burst ? 600.0 : 200.0) * (1.0 + 0.1 * noise())};
+    out[KPI_THP_DL] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = thp_dl};
+    out[KPI_THP_UL] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = thp_ul};
+    out[KPI_UNKNOWN] = (meas_record_lst_t){.value = REAL_MEAS_VALUE, .real_val = 0};
+}
+
+/////////////////////////////
+// KPM
+/////////////////////////////
+
+static byte_array_t ba_from_str(char const* s) {
+    byte_array_t ba = {.len = strlen(s)};
+    ba.buf = malloc(ba.len);
+    assert(ba.buf != NULL && "Memory exhausted");
+    memcpy(ba.buf, s, ba.len);
+    return ba;
+}
+
+static ue_id_e2sm_t fill_ue_id(int ue) {
+    ue_id_e2sm_t id = {.type = GNB_UE_ID_E2SM};
+    id.gnb.amf_ue_ngap_id = 21 + (uint64_t)ue;
+    id.gnb.guami.plmn_id = (e2sm_plmn_t){.mcc = 505, .mnc = 1, .mnc_digit_len = 2};
+    id.gnb.guami.amf_region_id = 128;
+    id.gnb.guami.amf_set_id = 1;
+    id.gnb.guami.amf_ptr = 1;
+    id.gnb.ran_ue_id = malloc(sizeof(uint64_t));
+    assert(id.gnb.ran_ue_id != NULL && "Memory exhausted");
+    *id.gnb.ran_ue_id = (uint64_t)ue + 1;
+    return id;
+}
+
+// The SM frees the whole indication after encoding it, so nothing is shared
+static kpm_ind_msg_format_1_t fill_ue_msg(kpm_act_def_format_1_t const* ad, mock_kpi_e const* kpi, meas_record_lst_t const* val) {
+    kpm_ind_msg_format_1_t msg = {0};
+    size_t const n = ad->meas_info_lst_len;
+
+    msg.meas_data_lst_len = 1;
+    msg.meas_data_lst = calloc(1, sizeof(meas_data_lst_t));
+    assert(msg.meas_data_lst != NULL && "Memory exhausted");
+    msg.meas_data_lst[0].meas_record_len = n;
+    msg.meas_data_lst[0].meas_record_lst = calloc(n, sizeof(meas_record_lst_t));
+    assert(msg.meas_data_lst[0].meas_record_lst != NULL && "Memory exhausted");
+
+    msg.meas_info_lst_len = n;
+    msg.meas_info_lst = calloc(n, sizeof(meas_info_format_1_lst_t));
+    assert(msg.meas_info_lst != NULL && "Memory exhausted");
+
+    for (size_t i = 0; i < n; i++) {
+        msg.meas_data_lst[0].meas_record_lst[i] = val[kpi[i]];
+
+        meas_info_format_1_lst_t* info = &msg.meas_info_lst[i];
+        info->meas_type.type = NAME_MEAS_TYPE;
+        info->meas_type.name = copy_byte_array(ad->meas_info_lst[i].meas_type.name);
+        info->label_info_lst_len = 1;
+        info->label_info_lst = calloc(1, sizeof(label_info_lst_t));
+        assert(info->label_info_lst != NULL && "Memory exhausted");
+        info->label_info_lst[0].noLabel = malloc(sizeof(enum_value_e));
+        assert(info->label_info_lst[0].noLabel != NULL && "Memory exhausted");
+        *info->label_info_lst[0].noLabel = TRUE_ENUM_VALUE;
+    }
+    return msg;
+}
+
+static bool read_kpm_sm(void* data) {
+    assert(data != NULL);
+    kpm_rd_ind_data_t* kpm = data;
+    assert(kpm->act_def != NULL && "Cannot be NULL");
+    assert(kpm->act_def->type == FORMAT_4_ACTION_DEFINITION && "Only report style 4 is emulated");
+    kpm_act_def_format_1_t const* ad = &kpm->act_def->frm_4.action_def_format_1;
+
+    int64_t const now = time_now_us();
+    kpm->ind.hdr.type = FORMAT_1_INDICATION_HEADER;
+    kpm->ind.hdr.kpm_ric_ind_hdr_format_1.collectStartTime = now;
+
+    // Resolve the requested names once per indication, not per UE
+    mock_kpi_e* kpi = calloc(ad->meas_info_lst_len, sizeof(mock_kpi_e));
+    assert(kpi != NULL && "Memory exhausted");
+    for (size_t i = 0; i < ad->meas_info_lst_len; i++)
+        kpi[i] = kpi_from_name(ad->meas_info_lst[i].meas_type.name);
+
+    kpm->ind.msg.type = FORMAT_3_INDICATION_MESSAGE;
+    kpm_ind_msg_format_3_t* frm_3 = &kpm->ind.msg.frm_3;
+    frm_3->ue_meas_report_lst_len = (size_t)profile.num_ues;
+    frm_3->meas_report_per_ue = calloc(profile.num_ues, sizeof(meas_report_per_ue_t));
+    assert(frm_3->meas_report_per_ue != NULL && "Memory exhausted");
+
+    for (int ue = 0; ue < profile.num_ues; ue++) {
+        meas_record_lst_t val[KPI_END];
+        fill_ue_kpis(ue, now, ad->gran_period_ms, val);
+        frm_3->meas_report_per_ue[ue].ue_meas_report_lst = fill_ue_id(ue);
+        frm_3->meas_report_per_ue[ue].ind_msg_format_1 = fill_ue_msg(ad, kpi, val);
+    }
+    free(kpi);
+
+    atomic_fetch_add_explicit(&ind_cnt, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&ue_report_cnt, (uint_fast64_t)profile.num_ues, memory_order_relaxed);
+    return true;
+}
+
+static void read_kpm_setup_sm(void* data) {
+    assert(data != NULL);
+    kpm_e2_setup_t* kpm = data;
+    kpm_ran_function_def_t* def = &kpm->ran_func_def;
+    memset(def, 0, sizeof(*def));
+
+    def->name.short_name = ba_from_str("ORAN-E2SM-KPM");
+    def->name.service_model_oid = ba_from_str("1.3.6.1.4.1.53148.1.2.2.2");
+    def->name.description = ba_from_str("KPM Monitor");
+
+    def->sz_ric_event_trigger_style_list = 1;
+    def->ric_event_trigger_style_list = calloc(1, sizeof(ric_event_trigger_style_item_t));
+    assert(def->ric_event_trigger_style_list != NULL && "Memory exhausted");
+    def->ric_event_trigger_style_list[0].style_type = 1;
+    def->ric_event_trigger_style_list[0].style_name = ba_from_str("Periodic Report");
+    def->ric_event_trigger_style_list[0].format_type = FORMAT_1_RIC_EVENT_TRIGGER;
+
+    def->sz_ric_report_style_list = 1;
+    def->ric_report_style_list = calloc(1, sizeof(ric_report_style_item_t));
+    assert(def->ric_report_style_list != NULL && "Memory exhausted");
+    ric_report_style_item_t* style = &def->ric_report_style_list[0];
+    style->report_style_type = STYLE_4_RIC_SERVICE_REPORT;
+    style->report_style_name = ba_from_str("Common Condition-based, UE-level Measurement");
+    style->act_def_format_type = FORMAT_4_ACTION_DEFINITION;
+    style->meas_info_for_action_lst_len = KPI_UNKNOWN;
+    style->meas_info_for_action_lst = calloc(KPI_UNKNOWN, sizeof(meas_info_for_action_lst_t));
+    assert(style->meas_info_for_action_lst != NULL && "Memory exhausted");
+    for (int k = 0; k < KPI_UNKNOWN; k++)
+        style->meas_info_for_action_lst[k].name = ba_from_str(kpi_names[k]);
+    style->ind_hdr_format_type = FORMAT_1_INDICATION_HEADER;
+    style->ind_msg_format_type = FORMAT_3_INDICATION_MESSAGE;
+}
+
+/////////////////////////////
+// RC
+/////////////////////////////
+
+static void read_rc_setup_sm(void* data) {
+    assert(data != NULL);
+    rc_e2_setup_t* rc = data;
+    e2sm_rc_func_def_t* def = &rc->ran_func_def;
+    memset(def, 0, sizeof(*def));
+
+    def->name.short_name = ba_from_str("ORAN-E2SM-RC");
+    def->name.service_model_oid = ba_from_str("1.3.6.1.4.1.53148.1.1.2.3");
+    def->name.description = ba_from_str("RAN Control");
+
+    // Exactly what the xApps' gen_rc_ctrl_msg_for_ue() asserts on
+    seq_ctrl_act_2_t* act = calloc(1, sizeof(seq_ctrl_act_2_t));
+    assert(act != NULL && "Memory exhausted");
+    act->id = 2;
+    act->name = ba_from_str("QoS flow mapping configuration");
+    act->sz_seq_assoc_ran_param = 2;
+    act->assoc_ran_param = calloc(2, sizeof(seq_ran_param_3_t));
+    assert(act->assoc_ran_param != NULL && "Memory exhausted");
+    act->assoc_ran_param[0].id = 1;
+    act->assoc_ran_param[0].name = ba_from_str("DRB ID");
+    act->assoc_ran_param[1].id = 2;
+    act->assoc_ran_param[1].name = ba_from_str("List of QoS Flows to be modified in DRB");
+
+    def->ctrl = calloc(1, sizeof(ran_func_def_ctrl_t));
+    assert(def->ctrl != NULL && "Memory exhausted");
+    def->ctrl->sz_seq_ctrl_style = 1;
+    def->ctrl->seq_ctrl_style = calloc(1, sizeof(seq_ctrl_style_t));
+    assert(def->ctrl->seq_ctrl_style != NULL && "Memory exhausted");
+    seq_ctrl_style_t* style = &def->ctrl->seq_ctrl_style[0];
+    style->style_type = 1;
+    style->name = ba_from_str("Radio Bearer Control");
+    style->hdr = FORMAT_1_E2SM_RC_CTRL_HDR;
+    style->msg = FORMAT_1_E2SM_RC_CTRL_MSG;
+    style->sz_seq_ctrl_act = 1;
+    style->seq_ctrl_act = act;
+}
+
+static sm_ag_if_ans_t write_ctrl_rc_sm(void const* data) {
+    assert(data != NULL);
+    rc_ctrl_req_data_t const* ctrl = data;
+    assert(ctrl->hdr.format == FORMAT_1_E2SM_RC_CTRL_HDR && "Only control header format 1 is emulated");
+    assert(ctrl->msg.format == FORMAT_1_E2SM_RC_CTRL_MSG && "Only control message format 1 is emulated");
+
+    atomic_fetch_add_explicit(&ctrl_cnt, 1, memory_order_relaxed);
+    if (ctrl->hdr.frmt_1.ue_id.type == GNB_UE_ID_E2SM && ctrl->hdr.frmt_1.ue_id.gnb.ran_ue_id != NULL)
+        XLOG_DEBUG("[MOCK E2]: RC control for UE (RAN UE ID %lu), action %u\n", *ctrl->hdr.frmt_1.ue_id.gnb.ran_ue_id, ctrl->hdr.frmt_1.ctrl_act_id);
+
+    sm_ag_if_ans_t ans = {.type = CTRL_OUTCOME_SM_AG_IF_ANS_V0};
+    ans.ctrl_out.type = RAN_CTRL_V1_3_AGENT_IF_CTRL_ANS_V0;
+    return ans;
+}
+
+static sm_io_ag_ran_t init_io_ag(void) {
+    sm_io_ag_ran_t io = {0};
+    io.read_ind_tbl[KPM_STATS_V3_0] = read_kpm_sm;
+    io.read_setup_tbl[KPM_V3_0_AGENT_IF_E2_SETUP_ANS_V0] = read_kpm_setup_sm;
+    io.read_setup_tbl[RAN_CTRL_V1_3_AGENT_IF_E2_SETUP_ANS_V0] = read_rc_setup_sm;
+    io.write_ctrl_tbl[RAN_CONTROL_CTRL_V1_03] = write_ctrl_rc_sm;
+    return io;
+}
+
+/////////////////////////////
+// Main
+/////////////////////////////
+
+// Consumes our options and leaves FlexRIC's (-c, -p) in argv
+static int parse_mock_args(int argc, char* argv[]) {
+    int out = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--ues") == 0 && i + 1 < argc) {
+            profile.num_ues = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--stagger") == 0) {
+            profile.stagger = true;
+        } else if (strcmp(argv[i], "--prb-scale") == 0 && i + 1 < argc) {
+            profile.prb_scale = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--cycle") == 0 && i + 1 < argc) {
+            profile.cycle_s = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--burst") == 0 && i + 1 < argc) {
+            profile.burst_s = atoi(argv[++i]);
+        } else {
+            argv[out++] = argv[i];
+        }
+    }
+    argv[out] = NULL;
+    assert(profile.num_ues > 0 && profile.prb_scale > 0 && "Invalid mock E2 node options");
+    assert(profile.cycle_s > 0 && profile.burst_s >= 0 && profile.burst_s <= profile.cycle_s && "Invalid burst cycle");
+    return out;
+}
+
+int main(int argc, char* argv[]) {
+    xlog_start();
+
+    argc = parse_mock_args(argc, argv);
+    fr_args_t args = init_fr_args(argc, argv);
+
+    start_us = time_now_us();
+    XLOG_INFO("[MOCK E2]: %d UEs, URLLC %.0f/%.0f kbps with %d s bursts every %d s%s, mMTC %.0f kbps\n",
+              profile.num_ues, profile.urllc_base_kbps, profile.urllc_burst_kbps, profile.burst_s, profile.cycle_s,
+              profile.stagger ? " (staggered)" : "", profile.mmtc_kbps);
+
+    int const mcc = 505;
+    int const mnc = 1;
+    int const mnc_digit_len = 2;
+    int const nb_id = 1;
+    int const cu_du_id = 0;
+    sm_io_ag_ran_t io = init_io_ag();
+    init_agent_api(mcc, mnc, mnc_digit_len, nb_id, cu_du_id, ngran_gNB, io, &args);
+
+    uint64_t last_ctrl = 0;
+    for (;;) {
+        poll(NULL, 0, MOCK_STATS_PERIOD_S * 1000);
+        uint64_t const ctrl = atomic_load_explicit(&ctrl_cnt, memory_order_relaxed);
+        XLOG_INFO("[MOCK E2]: %lu indications, %lu UE reports, %lu RC controls (%.1f/s)\n",
+                  (unsigned long)atomic_load_explicit(&ind_cnt, memory_order_relaxed),
+                  (unsigned long)atomic_load_explicit(&ue_report_cnt, memory_order_relaxed),
+                  (unsigned long)ctrl,
+                  (double)(ctrl - last_ctrl) / MOCK_STATS_PERIOD_S);
+        last_ctrl = ctrl;
+    }
+
+    stop_agent_api();
+    xlog_stop();
+    return 0;
+}
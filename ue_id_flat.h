@@ -0,0 +1,144 @@
+#ifndef UE_ID_FLAT_H
+#define UE_ID_FLAT_H
+
+// Pointer-free copy of the E2SM UE ID fields OAI reports (see the UE ID
+// table in README.md). It can be stored by value in the UE table and in
+// snapshots, so no cp_ue_id_e2sm()/free_ue_id_e2sm() per UE per indication.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "xlog.h"
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    ue_id_e2sm_e type;
+    uint64_t amf_ue_ngap_id;
+    guami_t guami;
+    uint64_t ran_ue_id;
+    uint32_t f1ap_id;  // gNB-CU / gNB-DU UE F1AP ID
+    uint32_t e1ap_id;  // gNB-CU-CP UE E1AP ID
+    bool has_ran_ue_id;
+    bool has_f1ap_id;
+    bool has_e1ap_id;
+} ue_id_flat_t;
+
+static inline ue_id_flat_t ue_id_flat(ue_id_e2sm_t const* src) {
+    assert(src != NULL);
+    ue_id_flat_t dst = {.type = src->type};
+    switch (src->type) {
+        case GNB_UE_ID_E2SM:
+            dst.amf_ue_ngap_id = src->gnb.amf_ue_ngap_id;
+            dst.guami = src->gnb.guami;
+            if (src->gnb.gnb_cu_ue_f1ap_lst != NULL && src->gnb.gnb_cu_ue_f1ap_lst_len > 0) {
+                dst.f1ap_id = src->gnb.gnb_cu_ue_f1ap_lst[0];
+                dst.has_f1ap_id = true;
+            }
+            if (src->gnb.gnb_cu_cp_ue_e1ap_lst != NULL && src->gnb.gnb_cu_cp_ue_e1ap_lst_len > 0) {
+                dst.e1ap_id = src->gnb.gnb_cu_cp_ue_e1ap_lst[0];
+                dst.has_e1ap_id = true;
+            }
+            if (src->gnb.ran_ue_id != NULL) {
+                dst.ran_ue_id = *src->gnb.ran_ue_id;
+                dst.has_ran_ue_id = true;
+            }
+            break;
+        case GNB_DU_UE_ID_E2SM:
+            dst.f1ap_id = src->gnb_du.gnb_cu_ue_f1ap;
+            dst.has_f1ap_id = true;
+            if (src->gnb_du.ran_ue_id != NULL) {
+                dst.ran_ue_id = *src->gnb_du.ran_ue_id;
+                dst.has_ran_ue_id = true;
+            }
+            break;
+        case GNB_CU_UP_UE_ID_E2SM:
+            dst.e1ap_id = src->gnb_cu_up.gnb_cu_cp_ue_e1ap;
+            dst.has_e1ap_id = true;
+            if (src->gnb_cu_up.ran_ue_id != NULL) {
+                dst.ran_ue_id = *src->gnb_cu_up.ran_ue_id;
+                dst.has_ran_ue_id = true;
+            }
+            break;
+        default:
+            assert(false && "UE ID type not yet supported");
+    }
+    return dst;
+}
+
+// Borrowed ue_id_e2sm_t pointing into *flat. Valid as long as *flat is, and
+// must not be passed to free_ue_id_e2sm().
+static inline ue_id_e2sm_t ue_id_flat_view(ue_id_flat_t* flat) {
+    assert(flat != NULL);
+    ue_id_e2sm_t dst = {.type = flat->type};
+    switch (flat->type) {
+        case GNB_UE_ID_E2SM:
+            dst.gnb.amf_ue_ngap_id = flat->amf_ue_ngap_id;
+            dst.gnb.guami = flat->guami;
+            if (flat->has_f1ap_id) {
+                dst.gnb.gnb_cu_ue_f1ap_lst = &flat->f1ap_id;
+                dst.gnb.gnb_cu_ue_f1ap_lst_len = 1;
+            }
+            if (flat->has_e1ap_id) {
+                dst.gnb.gnb_cu_cp_ue_e1ap_lst = &flat->e1ap_id;
+                dst.gnb.gnb_cu_cp_ue_e1ap_lst_len = 1;
+            }
+            dst.gnb.ran_ue_id = flat->has_ran_ue_id ? &flat->ran_ue_id : NULL;
+            break;
+        case GNB_DU_UE_ID_E2SM:
+            dst.gnb_du.gnb_cu_ue_f1ap = flat->f1ap_id;
+            dst.gnb_du.ran_ue_id = flat->has_ran_ue_id ? &flat->ran_ue_id : NULL;
+            break;
+        case GNB_CU_UP_UE_ID_E2SM:
+            dst.gnb_cu_up.gnb_cu_cp_ue_e1ap = flat->e1ap_id;
+            dst.gnb_cu_up.ran_ue_id = flat->has_ran_ue_id ? &flat->ran_ue_id : NULL;
+            break;
+        default:
+            assert(false && "UE ID type not yet supported");
+    }
+    return dst;
+}
+
+// UE table key: RAN UE ID when reported, otherwise the node-local
+// NGAP/F1AP/E1AP ID
+static inline uint64_t ue_id_flat_key(ue_id_flat_t const* id) {
+    if (id->has_ran_ue_id)
+        return id->ran_ue_id;
+    switch (id->type) {
+        case GNB_UE_ID_E2SM:
+            return id->amf_ue_ngap_id;
+        case GNB_DU_UE_ID_E2SM:
+            return id->f1ap_id;
+        default:
+            return id->e1ap_id;
+    }
+}
+
+// Logs the IDs of a reported UE at trace level
+static inline void ue_id_e2sm_trace(ue_id_e2sm_t const* ue_id) {
+    switch (ue_id->type) {
+        case GNB_UE_ID_E2SM:
+            if (ue_id->gnb.gnb_cu_ue_f1ap_lst != NULL) {
+                for (size_t i = 0; i < ue_id->gnb.gnb_cu_ue_f1ap_lst_len; i++)
+                    XLOG_TRACE("UE ID type = gNB-CU, gnb_cu_ue_f1ap = %u\n", ue_id->gnb.gnb_cu_ue_f1ap_lst[i]);
+            } else {
+                XLOG_TRACE("UE ID type = gNB, amf_ue_ngap_id = %lu\n", ue_id->gnb.amf_ue_ngap_id);
+            }
+            if (ue_id->gnb.ran_ue_id != NULL)
+                XLOG_TRACE("ran_ue_id = %lx\n", *ue_id->gnb.ran_ue_id);
+            break;
+        case GNB_DU_UE_ID_E2SM:
+            XLOG_TRACE("UE ID type = gNB-DU, gnb_cu_ue_f1ap = %u\n", ue_id->gnb_du.gnb_cu_ue_f1ap);
+            if (ue_id->gnb_du.ran_ue_id != NULL)
+                XLOG_TRACE("ran_ue_id = %lx\n", *ue_id->gnb_du.ran_ue_id);
+            break;
+        case GNB_CU_UP_UE_ID_E2SM:
+            XLOG_TRACE("UE ID type = gNB-CU-UP, gnb_cu_cp_ue_e1ap = %u\n", ue_id->gnb_cu_up.gnb_cu_cp_ue_e1ap);
+            if (ue_id->gnb_cu_up.ran_ue_id != NULL)
+                XLOG_TRACE("ran_ue_id = %lx\n", *ue_id->gnb_cu_up.ran_ue_id);
+            break;
+        default:
+            break;
+    }
+}
+
+#endif
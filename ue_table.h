@@ -0,0 +1,249 @@
+#ifndef UE_TABLE_H
+#define UE_TABLE_H
+
+// Per-UE state table keyed by RAN UE ID (or AMF UE NGAP ID when the node does
+// not report one). Buckets are open-addressed with linear probing and only
+// hold the key plus a slab index. Records are packed at slab[0, len), so a
+// pass over every UE is a linear scan over contiguous memory. Removing a UE
+// moves the last record into the hole.
+//
+// Record pointers returned by ue_table_upsert() / ue_table_at() stay valid
+// until the next upsert or remove on the same table.
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define UE_TABLE_MIN_CAP 16
+#define UE_BUCKET_EMPTY UINT32_MAX
+#define UE_BUCKET_TOMBSTONE (UINT32_MAX - 1)
+
+typedef struct {
+    uint64_t key;
+    uint32_t slot;
+} ue_bucket_t;
+
+typedef struct {
+    ue_bucket_t* bkt;
+    size_t bkt_cap;       // power of two
+    size_t tombstones;
+
+    uint8_t* slab;
+    size_t rec_sz;
+    size_t slab_cap;
+    uint64_t* keys;       // keys[i] belongs to slab record i
+    uint32_t* last_seen;  // epoch in which record i was last upserted
+    size_t len;
+
+    uint32_t epoch;
+} ue_table_t;
+
+typedef void (*ue_table_detach_cb)(uint64_t key, void* rec, void* arg);
+
+static inline uint64_t ue_table_hash(uint64_t key) {
+    // splitmix64 finalizer, RAN UE IDs are small and sequential
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+    return key;
+}
+
+static inline size_t ue_table_pow2(size_t n) {
+    size_t cap = UE_TABLE_MIN_CAP;
+    while (cap < n)
+        cap <<= 1;
+    return cap;
+}
+
+static inline void ue_table_alloc_buckets(ue_table_t* t, size_t cap) {
+    t->bkt = malloc(cap * sizeof(ue_bucket_t));
+    assert(t->bkt != NULL && "Memory exhausted");
+    for (size_t i = 0; i < cap; i++)
+        t->bkt[i].slot = UE_BUCKET_EMPTY;
+    t->bkt_cap = cap;
+    t->tombstones = 0;
+}
+
+static inline void ue_table_init(ue_table_t* t, size_t rec_sz, size_t expected_ues) {
+    assert(t != NULL);
+    assert(rec_sz > 0);
+    memset(t, 0, sizeof(*t));
+    t->rec_sz = rec_sz;
+    t->slab_cap = ue_table_pow2(expected_ues);
+    t->slab = calloc(t->slab_cap, rec_sz);
+    t->keys = calloc(t->slab_cap, sizeof(uint64_t));
+    t->last_seen = calloc(t->slab_cap, sizeof(uint32_t));
+    assert(t->slab != NULL && t->keys != NULL && t->last_seen != NULL && "Memory exhausted");
+    // Keep the load factor under 1/2 at the expected size
+    ue_table_alloc_buckets(t, ue_table_pow2(2 * expected_ues));
+}
+
+static inline void ue_table_free(ue_table_t* t) {
+    free(t->bkt);
+    free(t->slab);
+    free(t->keys);
+    free(t->last_seen);
+    memset(t, 0, sizeof(*t));
+}
+
+static inline size_t ue_table_len(ue_table_t const* t) {
+    return t->len;
+}
+
+static inline void* ue_table_at(ue_table_t const* t, size_t i) {
+    assert(i < t->len);
+    return t->slab + i * t->rec_sz;
+}
+
+// Index of a record returned by ue_table_upsert() / ue_table_at()
+static inline size_t ue_table_slot(ue_table_t const* t, void const* rec) {
+    size_t const i = (size_t)((uint8_t const*)rec - t->slab) / t->rec_sz;
+    assert(i < t->len);
+    return i;
+}
+
+static inline uint64_t ue_table_key_at(ue_table_t const* t, size_t i) {
+    assert(i < t->len);
+    return t->keys[i];
+}
+
+// True if record i was reported in the current epoch (i.e. not in its
+// detach grace period)
+static inline bool ue_table_seen(ue_table_t const* t, size_t i) {
+    assert(i < t->len);
+    return t->last_seen[i] == t->epoch;
+}
+
+// Returns the bucket holding key, or SIZE_MAX
+static inline size_t ue_table_find_bkt(ue_table_t const* t, uint64_t key) {
+    size_t const mask = t->bkt_cap - 1;
+    size_t b = ue_table_hash(key) & mask;
+    for (size_t n = 0; n < t->bkt_cap; n++, b = (b + 1) & mask) {
+        uint32_t const slot = t->bkt[b].slot;
+        if (slot == UE_BUCKET_EMPTY)
+            return SIZE_MAX;
+        if (slot != UE_BUCKET_TOMBSTONE && t->bkt[b].key == key)
+            return b;
+    }
+    return SIZE_MAX;
+}
+
+static inline void* ue_table_find(ue_table_t const* t, uint64_t key) {
+    size_t const b = ue_table_find_bkt(t, key);
+    if (b == SIZE_MAX)
+        return NULL;
+    return t->slab + (size_t)t->bkt[b].slot * t->rec_sz;
+}
+
+static inline void ue_table_place(ue_table_t* t, uint64_t key, uint32_t slot) {
+    size_t const mask = t->bkt_cap - 1;
+    size_t b = ue_table_hash(key) & mask;
+    while (t->bkt[b].slot != UE_BUCKET_EMPTY && t->bkt[b].slot != UE_BUCKET_TOMBSTONE)
+        b = (b + 1) & mask;
+    if (t->bkt[b].slot == UE_BUCKET_TOMBSTONE)
+        t->tombstones--;
+    t->bkt[b].key = key;
+    t->bkt[b].slot = slot;
+}
+
+// Rebuilds the bucket array, dropping tombstones. Only runs when the UE
+// population outgrows the table, never in steady state.
+static inline void ue_table_rehash(ue_table_t* t, size_t cap) {
+    free(t->bkt);
+    ue_table_alloc_buckets(t, cap);
+    for (size_t i = 0; i < t->len; i++)
+        ue_table_place(t, t->keys[i], (uint32_t)i);
+}
+
+static inline void ue_table_grow_slab(ue_table_t* t) {
+    size_t const cap = 2 * t->slab_cap;
+    t->slab = realloc(t->slab, cap * t->rec_sz);
+    t->keys = realloc(t->keys, cap * sizeof(uint64_t));
+    t->last_seen = realloc(t->last_seen, cap * sizeof(uint32_t));
+    assert(t->slab != NULL && t->keys != NULL && t->last_seen != NULL && "Memory exhausted");
+    t->slab_cap = cap;
+}
+
+// Finds the record for key or appends a zeroed one. Either way the record is
+// marked as seen in the current epoch.
+static inline void* ue_table_upsert(ue_table_t* t, uint64_t key, bool* created) {
+    size_t const b = ue_table_find_bkt(t, key);
+    if (b != SIZE_MAX) {
+        uint32_t const slot = t->bkt[b].slot;
+        t->last_seen[slot] = t->epoch;
+        if (created)
+            *created = false;
+        return t->slab + (size_t)slot * t->rec_sz;
+    }
+
+    if (4 * (t->len + t->tombstones + 1) > 3 * t->bkt_cap) {
+        size_t const cap = (4 * (t->len + 1) > 2 * t->bkt_cap) ? 2 * t->bkt_cap : t->bkt_cap;
+        ue_table_rehash(t, cap);
+    }
+    if (t->len == t->slab_cap)
+        ue_table_grow_slab(t);
+
+    uint32_t const slot = (uint32_t)t->len++;
+    void* rec = t->slab + (size_t)slot * t->rec_sz;
+    memset(rec, 0, t->rec_sz);
+    t->keys[slot] = key;
+    t->last_seen[slot] = t->epoch;
+    ue_table_place(t, key, slot);
+    if (created)
+        *created = true;
+    return rec;
+}
+
+static inline bool ue_table_remove(ue_table_t* t, uint64_t key) {
+    size_t const b = ue_table_find_bkt(t, key);
+    if (b == SIZE_MAX)
+        return false;
+
+    uint32_t const slot = t->bkt[b].slot;
+    t->bkt[b].slot = UE_BUCKET_TOMBSTONE;
+    t->tombstones++;
+
+    uint32_t const last = (uint32_t)(t->len - 1);
+    if (slot != last) {
+        memcpy(t->slab + (size_t)slot * t->rec_sz, t->slab + (size_t)last * t->rec_sz, t->rec_sz);
+        t->keys[slot] = t->keys[last];
+        t->last_seen[slot] = t->last_seen[last];
+        size_t const moved = ue_table_find_bkt(t, t->keys[slot]);
+        assert(moved != SIZE_MAX);
+        t->bkt[moved].slot = slot;
+    }
+    t->len--;
+    return true;
+}
+
+// Call once per indication, before upserting the reported UEs
+static inline void ue_table_begin_epoch(ue_table_t* t) {
+    t->epoch++;
+}
+
+// Removes the UEs that were absent from more than `grace` consecutive
+// indications. cb (may be NULL) sees each record before it is dropped, so
+// the caller can release whatever the record owns.
+static inline size_t ue_table_sweep(ue_table_t* t, uint32_t grace, ue_table_detach_cb cb, void* arg) {
+    size_t removed = 0;
+    size_t i = 0;
+    while (i < t->len) {
+        if (t->epoch - t->last_seen[i] > grace) {
+            uint64_t const key = t->keys[i];
+            if (cb)
+                cb(key, ue_table_at(t, i), arg);
+            ue_table_remove(t, key);
+            removed++;
+            continue;  // slot i now holds the former last record
+        }
+        i++;
+    }
+    return removed;
+}
+
+#endif
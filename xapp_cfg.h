@@ -0,0 +1,442 @@
+#ifndef XAPP_CFG_H
+#define XAPP_CFG_H
+
+// Runtime configuration of the xApps: KPM report period and S-NSSAI
+// filter, decision policy, burst thresholds and the PRB pool.
+//
+// Each xApp starts from its own compiled-in defaults, then applies the
+// file named by --config (or XAPP_CONFIG), then the --key value options of
+// its command line. The file holds one `key = value` per line, `#` starts
+// a comment. Keys are the xapp_cfg_t field names; on the command line a
+// `_` may also be written `-`:
+//
+//   xapp_RC_KPM_Infinity --period-ms 100 --burst-enter-kbps 14000 -c ric.conf
+//
+// xapp_cfg_args() removes the options it handles from argv, what is left
+// goes to init_fr_args(). xapp_cfg_watch() calls back on SIGHUP, and
+// xapp_cfg_reload() rebuilds the configuration from the same sources, so
+// an edited file takes effect without a restart. Which keys the xApp can
+// apply while running is up to the xApp.
+
+#include "xlog.h"
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define XAPP_CFG_STR_LEN 256
+#define XAPP_CFG_MAX_ARGS 64
+// nssai_sd of an S-NSSAI without SD, only the SST is matched
+#define XAPP_CFG_NO_SD 0xffffff
+
+typedef struct {
+    // KPM subscription
+    uint32_t period_ms;       // Report period
+    uint32_t gran_period_ms;  // Granularity period, 0: the report period
+    uint32_t nssai_sst;
+    uint32_t nssai_sd;
+    char meas_base[XAPP_CFG_STR_LEN];  // Measurement file without extension, "": not written
+    char sink[16];                     // Its format: bin, csv or tsdb, "": bin, see meas_sink.h
+    uint32_t stats_period_ms;          // [LATENCY] per-stage summary, 0: none
+    uint32_t metrics_port;             // Prometheus /metrics endpoint, 0: none
+
+    // Decision policy: monitor, threshold, timed, drl, or the path of a plugin
+    // .so, see xapp_policy.h
+    char policy[XAPP_CFG_STR_LEN];
+
+    // Burst detection, see burst_detect.h and burst_forecast.h. CUSUM and
+    // dwell count indications at period_ms.
+    float burst_enter_kbps;
+    float burst_exit_kbps;
+    float burst_ewma_alpha;
+    float burst_cusum_kbps;
+    uint32_t burst_min_dwell;
+    uint32_t forecast_season_ms;
+    uint32_t forecast_lead_ms;
+
+    // Adaptive sampling: the report period drops to fast_period_ms while
+    // a UE is within fast_near_kbps of a burst, and returns to period_ms
+    // fast_hold_ms after the last one
+    uint32_t fast_period_ms;  // 0: fixed period_ms
+    float fast_near_kbps;
+    uint32_t fast_hold_ms;
+
+    // PRB allocation, see prb_alloc.h
+    char allocator[16];
+    uint32_t prb_pool;
+    uint32_t prb_min;
+    uint32_t prb_normal;
+    uint32_t prb_burst;
+    uint32_t prb_urllc_min;
+
+    // Network of the drl policy, see policy_drl.c. "": follow the burst
+    // detector.
+    char drl_model[XAPP_CFG_STR_LEN];
+    // Shared-memory ring its experience goes to for a trainer, see
+    // drl_exp.h. "": none.
+    char drl_exp_shm[XAPP_CFG_STR_LEN];
+    float drl_explore;  // Share of its decisions taken at random
+} xapp_cfg_t;
+
+typedef enum {
+    XAPP_CFG_U32,
+    XAPP_CFG_FLOAT,
+    XAPP_CFG_STR,
+} xapp_cfg_type_e;
+
+typedef struct {
+    char const* key;
+    xapp_cfg_type_e type;
+    size_t off;
+    double min;
+    double max;
+} xapp_cfg_key_t;
+
+#define XAPP_CFG_KEY(field, type, min, max) {#field, type, offsetof(xapp_cfg_t, field), min, max}
+
+static xapp_cfg_key_t const xapp_cfg_keys[] = {
+    XAPP_CFG_KEY(period_ms, XAPP_CFG_U32, 1, 60000),
+    XAPP_CFG_KEY(gran_period_ms, XAPP_CFG_U32, 0, 60000),
+    XAPP_CFG_KEY(nssai_sst, XAPP_CFG_U32, 0, 255),
+    XAPP_CFG_KEY(nssai_sd, XAPP_CFG_U32, 0, 0xffffff),
+    XAPP_CFG_KEY(meas_base, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(sink, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(stats_period_ms, XAPP_CFG_U32, 0, 86400000),
+    XAPP_CFG_KEY(metrics_port, XAPP_CFG_U32, 0, 65535),
+    XAPP_CFG_KEY(policy, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(burst_enter_kbps, XAPP_CFG_FLOAT, 0, 1e9),
+    XAPP_CFG_KEY(burst_exit_kbps, XAPP_CFG_FLOAT, 0, 1e9),
+    XAPP_CFG_KEY(burst_ewma_alpha, XAPP_CFG_FLOAT, 1e-6, 1),
+    XAPP_CFG_KEY(burst_cusum_kbps, XAPP_CFG_FLOAT, 0, 1e9),
+    XAPP_CFG_KEY(burst_min_dwell, XAPP_CFG_U32, 0, 1000000),
+    XAPP_CFG_KEY(forecast_season_ms, XAPP_CFG_U32, 1, 86400000),
+    XAPP_CFG_KEY(forecast_lead_ms, XAPP_CFG_U32, 1, 86400000),
+    XAPP_CFG_KEY(fast_period_ms, XAPP_CFG_U32, 0, 60000),
+    XAPP_CFG_KEY(fast_near_kbps, XAPP_CFG_FLOAT, 0, 1e9),
+    XAPP_CFG_KEY(fast_hold_ms, XAPP_CFG_U32, 0, 86400000),
+    XAPP_CFG_KEY(allocator, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(prb_pool, XAPP_CFG_U32, 1, 275),
+    XAPP_CFG_KEY(prb_min, XAPP_CFG_U32, 0, 275),
+    XAPP_CFG_KEY(prb_normal, XAPP_CFG_U32, 0, 275),
+    XAPP_CFG_KEY(prb_burst, XAPP_CFG_U32, 0, 275),
+    XAPP_CFG_KEY(prb_urllc_min, XAPP_CFG_U32, 0, 275),
+    XAPP_CFG_KEY(drl_model, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(drl_exp_shm, XAPP_CFG_STR, 0, 0),
+    XAPP_CFG_KEY(drl_explore, XAPP_CFG_FLOAT, 0, 1),
+};
+
+#define XAPP_CFG_NUM_KEYS (sizeof(xapp_cfg_keys) / sizeof(xapp_cfg_keys[0]))
+
+// Where the running configuration came from, for xapp_cfg_reload()
+typedef struct {
+    xapp_cfg_t defaults;
+    char const* path;  // NULL: no file
+    char const* key[XAPP_CFG_MAX_ARGS];
+    char const* val[XAPP_CFG_MAX_ARGS];
+    size_t num_args;
+} xapp_cfg_src_t;
+
+static xapp_cfg_src_t xapp_cfg_src;
+
+// `-` and `_` compare equal
+static inline bool xapp_cfg_key_eq(char const* a, char const* b, size_t len_b) {
+    size_t i = 0;
+    for (; i < len_b && a[i] != '\0'; i++) {
+        char const x = a[i] == '-' ? '_' : a[i];
+        char const y = b[i] == '-' ? '_' : b[i];
+        if (x != y)
+            return false;
+    }
+    return i == len_b && a[i] == '\0';
+}
+
+static inline xapp_cfg_key_t const* xapp_cfg_find(char const* key, size_t len) {
+    for (size_t i = 0; i < XAPP_CFG_NUM_KEYS; i++) {
+        if (xapp_cfg_key_eq(xapp_cfg_keys[i].key, key, len))
+            return &xapp_cfg_keys[i];
+    }
+    return NULL;
+}
+
+static inline bool xapp_cfg_set(xapp_cfg_t* c, char const* key, char const* val) {
+    xapp_cfg_key_t const* k = xapp_cfg_find(key, strlen(key));
+    if (k == NULL) {
+        XLOG_ERROR("[CONFIG]: Unknown key '%s'\n", key);
+        return false;
+    }
+    void* dst = (char*)c + k->off;
+    char* end = NULL;
+    errno = 0;
+    switch (k->type) {
+    case XAPP_CFG_U32: {
+        unsigned long long const v = strtoull(val, &end, 0);
+        if (errno != 0 || end == val || *end != '\0' || val[0] == '-' || v < k->min || v > k->max) {
+            XLOG_ERROR("[CONFIG]: %s = '%s', expected an integer in [%.0f, %.0f]\n", k->key, val, k->min, k->max);
+            return false;
+        }
+        *(uint32_t*)dst = (uint32_t)v;
+        return true;
+    }
+    case XAPP_CFG_FLOAT: {
+        double const v = strtod(val, &end);
+        if (errno != 0 || end == val || *end != '\0' || !(v >= k->min && v <= k->max)) {
+            XLOG_ERROR("[CONFIG]: %s = '%s', expected a number in [%g, %g]\n", k->key, val, k->min, k->max);
+            return false;
+        }
+        *(float*)dst = (float)v;
+        return true;
+    }
+    case XAPP_CFG_STR: {
+        size_t const cap = k->off == offsetof(xapp_cfg_t, allocator) ? sizeof(c->allocator)
+                           : k->off == offsetof(xapp_cfg_t, sink)    ? sizeof(c->sink)
+                                                                     : XAPP_CFG_STR_LEN;
+        if (strlen(val) >= cap) {
+            XLOG_ERROR("[CONFIG]: %s is longer than %zu characters\n", k->key, cap - 1);
+            return false;
+        }
+        memcpy(dst, val, strlen(val) + 1);
+        return true;
+    }
+    }
+    return false;
+}
+
+static inline char* xapp_cfg_trim(char* s) {
+    while (*s == ' ' || *s == '\t')
+        s++;
+    size_t n = strlen(s);
+    while (n > 0 && (s[n - 1] == ' ' || s[n - 1] == '\t' || s[n - 1] == '\r' || s[n - 1] == '\n'))
+        s[--n] = '\0';
+    return s;
+}
+
+// Applies every `key = value` line of path. Stops at the first bad line.
+static inline bool xapp_cfg_load(xapp_cfg_t* c, char const* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        XLOG_ERROR("[CONFIG]: Cannot open %s: %s\n", path, strerror(errno));
+        return false;
+    }
+    char line[2 * XAPP_CFG_STR_LEN];
+    size_t lineno = 0;
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f) != NULL) {
+        lineno++;
+        char* hash = strchr(line, '#');
+        if (hash != NULL)
+            *hash = '\0';
+        char* kv = xapp_cfg_trim(line);
+        if (*kv == '\0')
+            continue;
+        char* eq = strchr(kv, '=');
+        if (eq == NULL) {
+            XLOG_ERROR("[CONFIG]: %s:%zu: expected key = value\n", path, lineno);
+            ok = false;
+            break;
+        }
+        *eq = '\0';
+        ok = xapp_cfg_set(c, xapp_cfg_trim(kv), xapp_cfg_trim(eq + 1));
+        if (!ok)
+            XLOG_ERROR("[CONFIG]: in %s:%zu\n", path, lineno);
+    }
+    fclose(f);
+    return ok;
+}
+
+// Values that are fine one by one but not together. Keys an xApp has no
+// default for (zero, "") are not used by it and not checked.
+static inline bool xapp_cfg_validate(xapp_cfg_t const* c) {
+    bool ok = true;
+    if (c->gran_period_ms > c->period_ms) {
+        XLOG_ERROR("[CONFIG]: gran_period_ms %u exceeds period_ms %u\n", c->gran_period_ms, c->period_ms);
+        ok = false;
+    }
+    if (c->burst_exit_kbps > c->burst_enter_kbps) {
+        XLOG_ERROR("[CONFIG]: burst_exit_kbps %.0f exceeds burst_enter_kbps %.0f\n", c->burst_exit_kbps, c->burst_enter_kbps);
+        ok = false;
+    }
+    if (c->forecast_season_ms != 0
+        && (c->forecast_lead_ms < c->period_ms || c->forecast_lead_ms / c->period_ms >= c->forecast_season_ms / c->period_ms)) {
+        XLOG_ERROR("[CONFIG]: forecast_lead_ms %u must span at least one period_ms %u and less than forecast_season_ms %u\n",
+                   c->forecast_lead_ms, c->period_ms, c->forecast_season_ms);
+        ok = false;
+    }
+    if (c->fast_period_ms > c->period_ms) {
+        XLOG_ERROR("[CONFIG]: fast_period_ms %u exceeds period_ms %u\n", c->fast_period_ms, c->period_ms);
+        ok = false;
+    }
+    if (c->prb_min > c->prb_pool || c->prb_normal > c->prb_pool || c->prb_burst > c->prb_pool || c->prb_urllc_min > c->prb_pool) {
+        XLOG_ERROR("[CONFIG]: PRB values must not exceed prb_pool %u\n", c->prb_pool);
+        ok = false;
+    }
+    if (c->sink[0] != '\0' && strcmp(c->sink, "bin") != 0 && strcmp(c->sink, "csv") != 0 && strcmp(c->sink, "tsdb") != 0) {
+        XLOG_ERROR("[CONFIG]: sink '%s', expected bin, csv or tsdb\n", c->sink);
+        ok = false;
+    }
+    if (c->allocator[0] != '\0' && strcmp(c->allocator, "linear") != 0 && strcmp(c->allocator, "fixed") != 0 && strcmp(c->allocator, "pf") != 0) {
+        XLOG_ERROR("[CONFIG]: allocator '%s', expected linear, fixed or pf\n", c->allocator);
+        ok = false;
+    }
+    if (c->drl_exp_shm[0] != '\0' && (c->drl_exp_shm[0] != '/' || strchr(c->drl_exp_shm + 1, '/') != NULL)) {
+        XLOG_ERROR("[CONFIG]: drl_exp_shm '%s', expected /name\n", c->drl_exp_shm);
+        ok = false;
+    }
+    return ok;
+}
+
+// Defaults, then the file, then the command line
+static inline bool xapp_cfg_build(xapp_cfg_t* c, xapp_cfg_src_t const* src) {
+    *c = src->defaults;
+    if (src->path != NULL && !xapp_cfg_load(c, src->path))
+        return false;
+    for (size_t i = 0; i < src->num_args; i++) {
+        if (!xapp_cfg_set(c, src->key[i], src->val[i]))
+            return false;
+    }
+    return xapp_cfg_validate(c);
+}
+
+static inline void xapp_cfg_usage(char const* prog) {
+    fprintf(stderr, "Usage: %s [--config file] [--key value | --key=value]... [FlexRIC options]\nKeys:", prog);
+    for (size_t i = 0; i < XAPP_CFG_NUM_KEYS; i++)
+        fprintf(stderr, " %s", xapp_cfg_keys[i].key);
+    fprintf(stderr, "\n");
+}
+
+// *c holds the xApp's defaults on entry and the configuration on return.
+// Options handled here are removed from argv. False after an error was
+// reported.
+static inline bool xapp_cfg_args(xapp_cfg_t* c, int* argc, char** argv) {
+    xapp_cfg_src_t* src = &xapp_cfg_src;
+    memset(src, 0, sizeof(*src));
+    src->defaults = *c;
+    char const* env = getenv("XAPP_CONFIG");
+    if (env != NULL && *env != '\0')
+        src->path = env;
+
+    int kept = 1;
+    for (int i = 1; i < *argc; i++) {
+        char* a = argv[i];
+        if (strncmp(a, "--", 2) != 0 || a[2] == '\0') {
+            argv[kept++] = a;
+            continue;
+        }
+        char const* name = a + 2;
+        char const* eq = strchr(name, '=');
+        size_t const len = eq != NULL ? (size_t)(eq - name) : strlen(name);
+        bool const is_file = xapp_cfg_key_eq("config", name, len);
+        if (!is_file && xapp_cfg_find(name, len) == NULL) {
+            if (xapp_cfg_key_eq("help", name, len)) {
+                xapp_cfg_usage(argv[0]);
+                return false;
+            }
+            argv[kept++] = a;  // FlexRIC's
+            continue;
+        }
+        char const* val = eq != NULL ? eq + 1 : (i + 1 < *argc ? argv[++i] : NULL);
+        if (val == NULL) {
+            XLOG_ERROR("[CONFIG]: --%s needs a value\n", name);
+            return false;
+        }
+        if (is_file) {
+            src->path = val;
+            continue;
+        }
+        if (src->num_args == XAPP_CFG_MAX_ARGS) {
+            XLOG_ERROR("[CONFIG]: More than %d options\n", XAPP_CFG_MAX_ARGS);
+            return false;
+        }
+        // The key is kept with its `=value`, xapp_cfg_set() gets a copy
+        // cut at the `=`
+        if (eq != NULL)
+            *(char*)eq = '\0';
+        src->key[src->num_args] = name;
+        src->val[src->num_args++] = val;
+    }
+    argv[kept] = NULL;
+    *argc = kept;
+    return xapp_cfg_build(c, src);
+}
+
+// The configuration rebuilt from its sources, with the file read again.
+// False, and *c untouched, when it does not load or validate.
+static inline bool xapp_cfg_reload(xapp_cfg_t* c) {
+    xapp_cfg_t next;
+    if (!xapp_cfg_build(&next, &xapp_cfg_src))
+        return false;
+    *c = next;
+    return true;
+}
+
+// Granularity period of a subscription at period_ms
+static inline uint32_t xapp_cfg_gran_ms(xapp_cfg_t const* c, uint32_t period_ms) {
+    return c->gran_period_ms != 0 && c->gran_period_ms < period_ms ? c->gran_period_ms : period_ms;
+}
+
+static inline void xapp_cfg_log(xapp_cfg_t const* c) {
+    XLOG_INFO("[CONFIG]: %s%speriod %u ms, granularity %u ms, S-NSSAI (%u, 0x%06x)\n", xapp_cfg_src.path != NULL ? xapp_cfg_src.path : "",
+              xapp_cfg_src.path != NULL ? ": " : "", c->period_ms, xapp_cfg_gran_ms(c, c->period_ms), c->nssai_sst, c->nssai_sd);
+    if (c->policy[0] != '\0')
+        XLOG_INFO("[CONFIG]: policy %s\n", c->policy);
+    if (c->drl_model[0] != '\0')
+        XLOG_INFO("[CONFIG]: DRL model %s\n", c->drl_model);
+    if (c->drl_exp_shm[0] != '\0')
+        XLOG_INFO("[CONFIG]: DRL experience to %s, %.0f%% explored\n", c->drl_exp_shm, 100.0 * c->drl_explore);
+    if (c->stats_period_ms != 0)
+        XLOG_INFO("[CONFIG]: latency summary every %u ms\n", c->stats_period_ms);
+    if (c->metrics_port != 0)
+        XLOG_INFO("[CONFIG]: metrics on port %u\n", c->metrics_port);
+    // Only what the xApp has defaults for, as in xapp_cfg_validate()
+    if (c->burst_enter_kbps > 0)
+        XLOG_INFO("[CONFIG]: burst enter %.0f / exit %.0f kbps, EWMA %.2f, CUSUM %.0f kbps, dwell %u, forecast %u ms ahead over %u ms\n",
+                  c->burst_enter_kbps, c->burst_exit_kbps, c->burst_ewma_alpha, c->burst_cusum_kbps, c->burst_min_dwell,
+                  c->forecast_lead_ms, c->forecast_season_ms);
+    if (c->fast_period_ms != 0)
+        XLOG_INFO("[CONFIG]: adaptive period %u ms from %.0f kbps, held %u ms\n", c->fast_period_ms, c->fast_near_kbps, c->fast_hold_ms);
+    if (c->allocator[0] != '\0')
+        XLOG_INFO("[CONFIG]: %s allocator, pool %u, min %u, normal %u, burst %u, URLLC %u PRBs\n", c->allocator, c->prb_pool,
+                  c->prb_min, c->prb_normal, c->prb_burst, c->prb_urllc_min);
+}
+
+/////////////////////////////
+// SIGHUP
+/////////////////////////////
+
+static void (*xapp_cfg_on_hup)(void);
+
+static inline void* xapp_cfg_watch_thread(void* arg) {
+    sigset_t const* set = arg;
+    for (;;) {
+        int sig = 0;
+        if (sigwait(set, &sig) == 0 && sig == SIGHUP) {
+            XLOG_INFO("[CONFIG]: SIGHUP, reloading\n");
+            xapp_cfg_on_hup();
+        }
+    }
+    return NULL;
+}
+
+// Calls on_hup from a thread of its own on every SIGHUP. Call before any
+// other thread is started, they inherit SIGHUP blocked and leave it to
+// this one.
+static inline void xapp_cfg_watch(void (*on_hup)(void)) {
+    static sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGHUP);
+    int rc = pthread_sigmask(SIG_BLOCK, &set, NULL);
+    assert(rc == 0);
+    xapp_cfg_on_hup = on_hup;
+    pthread_t t;
+    rc = pthread_create(&t, NULL, xapp_cfg_watch_thread, &set);
+    assert(rc == 0);
+    rc = pthread_detach(t);
+    assert(rc == 0);
+}
+
+#endif
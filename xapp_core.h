@@ -0,0 +1,1502 @@
+#ifndef XAPP_CORE_H
+#define XAPP_CORE_H
+
+// The xApp daemon shared by xapp_kpm.c, xapp_RC_KPM_Infinity.c and
+// xapp_kpm_rc_setTime.c: one node shard per E2 node with its KPM
+// subscriptions, indication decode, UE table, burst detection and forecast,
+// PRB allocation and RC worker, and the measurement sink of all of them.
+// What the RC xApps differ in is their policy, see xapp_policy.h.
+//
+// The including xApp defines its defaults first, as
+//   static xapp_cfg_t cfg = {...};
+// with the policy key naming its policy, then calls xapp_core_start() and
+// xapp_core_stop() from its main(). tools/kpm_replay.c drives the same
+// functions on a recording.
+
+#include "../../../../src/xApp/e42_xapp_api.h"
+#include "../../../../src/util/time_now_us.h"
+#include "../../../../src/util/alg_ds/ds/lock_guard/lock_guard.h"
+#include "xlog.h"
+#include "ue_table.h"
+#include "ue_id_flat.h"
+#include "kpm_meas_map.h"
+#include "kpm_sub.h"
+#include "snapshot.h"
+#include "event_queue.h"
+#include "meas_sink.h"
+#include "lat_hist.h"
+#include "metrics_http.h"
+#include "node_shard.h"
+#include "rc_dispatch.h"
+#include "prb_alloc.h"
+#include "burst_detect.h"
+#include "burst_forecast.h"
+#include "xapp_cfg.h"
+#include "kpm_resub.h"
+#include "xapp_policy.h"
+#include "policy_monitor.c"
+#include "policy_threshold.c"
+#include "policy_timed.c"
+#include "policy_drl.c"
+#include <dlfcn.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+static pthread_mutex_t meas_mtx;  // Shards share the measurement writer
+static meas_writer_t meas_writer;
+static prb_alloc_t* prb_alloc;  // Stateless, shared by the shards, opened with the first RC policy
+// Subscriptions, the running configuration and policy: subscription
+// thread, main and SIGHUP
+static pthread_mutex_t sub_mtx = PTHREAD_MUTEX_INITIALIZER;
+// Wakes the subscription thread, a shard wants another report period or
+// finished a swap
+static pthread_cond_t sub_cond = PTHREAD_COND_INITIALIZER;
+static pthread_t sub_thread;
+static bool sub_stop;  // Under sub_mtx
+
+// Expected UEs per gNB, the table grows past this if needed
+#define UE_TABLE_INIT_CAP 1024
+// Indications a UE may be missing from before it is considered detached
+#define UE_DETACH_GRACE_IND 3
+
+// RC CONTROL requests in flight per E2 node, and what the node can take
+#define RC_CTRL_WINDOW 8
+#define RC_CTRL_RATE_PER_S 2000.0
+#define RC_CTRL_BURST 256
+
+// A new KPM subscription delivers within this, plus a few of its periods,
+// or the running one is kept
+#define SUB_SWAP_TIMEOUT_MS 2000
+#define SUB_POLL_MS 100
+
+// Reported UEs as of one indication. sm_cb_kpm publishes one per indication
+// and the RC thread reads the newest, without either side taking a lock.
+// The metrics thread gets its own copy the same way.
+typedef struct {
+    int64_t epoch;  // Indication counter, 0 before the first indication
+    int64_t latency_us;  // Of the indication, -1: unknown
+    uint32_t period_ms;
+    size_t len;
+    size_t cap;
+    ue_state_t* ue;
+} ue_snapshot_t;
+
+// RC thread private bookkeeping, keyed like ue_tbl
+typedef struct {
+    int64_t burst_detect_us;    // Pending burst transition, 0 when none
+    bool initial_control_sent;
+    // Last allocation sent to the node and not reported failed
+    bool applied;
+    int applied_drb_id;
+    int applied_qfi;
+    int applied_mapping_ind;
+} ue_ctrl_state_t;
+
+#define CTRL_QUEUE_LEN 4096
+
+typedef enum {
+    CTRL_EV_BURST_TRANSITION,
+    CTRL_EV_INITIAL_CONTROL,
+} ctrl_event_e;
+
+// sm_cb_kpm -> RC thread. The thread wakes on the eventfd as soon as the
+// indication that raised the event has published its snapshot.
+typedef struct {
+    ctrl_event_e type;
+    uint64_t ran_ue_id;
+    int64_t epoch;      // Snapshot the event belongs to
+    int64_t detect_us;  // Arrival time of the indication
+} ctrl_event_t;
+
+// RC thread -> sm_cb_kpm, for the burst_to_ctrl_us column
+typedef struct {
+    uint64_t ran_ue_id;
+    int64_t latency_us;
+} ctrl_done_t;
+
+// Timed stages of an indication, each recorded once per indication, and
+// the RC CONTROL send-to-answer time of each request
+typedef enum {
+    STAGE_DECODE,     // KPM measurement records of the reported UEs
+    STAGE_UE_LOOKUP,  // UE ID flattening, UE table upsert and sweep
+    STAGE_DETECT,     // Burst detection, forecast and report period
+    STAGE_POLICY,
+    STAGE_ALLOC,      // PRB allocation and snapshot publish
+    STAGE_SINK,       // Rows to the measurement writer
+    STAGE_INDICATION, // Whole callback, lock wait included
+    STAGE_RC_ACK,
+    STAGE_NUM,
+} stage_e;
+
+static char const* const stage_names[STAGE_NUM] = {"decode", "ue_lookup", "detect", "policy", "alloc", "sink", "indication", "rc_ack"};
+
+// What the indication path needs of cfg, copied under the shard lock so a
+// SIGHUP never lands in the middle of an indication
+typedef struct {
+    burst_detect_cfg_t burst;  // For indications every period_ms
+    uint32_t period_ms;
+    uint32_t season_ms;
+    uint32_t lead_ms;
+    uint32_t fast_period_ms;  // 0: adaptive sampling off
+    float fast_near_kbps;
+    uint32_t fast_hold_ms;
+} shard_tune_t;
+
+// Everything one E2 node's indications and controls touch. Nodes never see
+// each other's UEs, and a shard's RC controls only go to its own node.
+typedef struct {
+    size_t idx;
+    e2_node_connected_xapp_t* node;
+    ran_func_def_ctrl_t const* rc_ctrl;  // NULL: the node has no RC function
+    rc_dispatch_t dispatch;              // Sends to node, set up when rc_ctrl is
+    // STAGE_NUM, written under mtx, STAGE_RC_ACK under the dispatcher lock
+    lat_hist_t* stage;
+
+    pthread_mutex_t mtx;  // Serializes indications; the worker only reads snapshots
+    int counter;
+    ue_table_t ue_tbl;  // ue_state_t records, owned by sm_cb_kpm
+    kpm_meas_map_t kpm_map;
+    rc_allocation_t rc_alloc;
+    prb_alloc_batch_t prb_batch;
+    bool detect_on;             // burst and forecast set up, by the first RC policy
+    burst_detect_t burst;       // Indexed like ue_tbl
+    burst_forecast_t forecast;  // Indexed like ue_tbl
+    xapp_policy_t const* policy;  // Under mtx, swapped by policy_swap()
+    void* policy_st;
+
+    ue_snapshot_t snap_bufs[3];
+    snapshot_t ue_snap;
+    ue_snapshot_t metrics_bufs[3];
+    snapshot_t metrics_snap;  // Published while metrics_on
+    event_queue_t ctrl_events;
+    spsc_ring_t ctrl_done;
+    spsc_ring_t ctrl_failed;  // RAN UE IDs, dispatcher -> worker
+
+    kpm_ran_function_def_t const* kpm_rf;
+    kpm_resub_t resub;   // KPM subscriptions, slot state under mtx
+    shard_tune_t tune;   // Under mtx
+    uint32_t period_ms;  // Of the indications in use, under mtx
+    uint32_t calm_ms;    // Since a UE was last near a burst
+    atomic_bool want_fast;  // Set by sm_cb_kpm, read by the subscription thread
+
+    ue_table_t ctrl_tbl;  // Owned by the worker
+    // Written by the worker and the dispatcher, read by the metrics thread
+    _Atomic uint64_t ctrl_sent;
+    _Atomic uint64_t ctrl_suppressed;  // Allocation already applied
+    _Atomic uint64_t ctrl_acked;
+    _Atomic uint64_t ctrl_nacked;
+    pthread_t worker;
+    atomic_bool worker_stop;  // Set before waking the worker to exit
+} shard_t;
+
+static shard_t shards[NODE_SHARD_MAX];
+static size_t num_shards;
+
+/////////////////////////////
+// Policies
+/////////////////////////////
+
+typedef struct {
+    xapp_policy_t const* p;
+    void* so;  // dlopen() handle, NULL: built in
+} policy_ref_t;
+
+static xapp_policy_t const* const builtin_policies[] = {&policy_monitor, &policy_threshold, &policy_timed, &policy_drl};
+
+static policy_ref_t cur_policy;  // Under sub_mtx
+// RRU.PrbTot* arrive in subcarriers, XAPP_POLICY_PRB_SUBCARRIERS
+static atomic_bool prb_in_subcarriers;
+// The metrics thread runs, shards publish metrics_snap
+static atomic_bool metrics_on;
+
+static void policy_host_log(char const* msg) {
+    xlog_emit("%s", msg);
+}
+
+static xapp_policy_host_t const policy_host = {.abi = XAPP_POLICY_ABI, .log = policy_host_log};
+
+// A built-in policy by name, or the plugin at a path. False after an error
+// was reported.
+static bool policy_load(char const* name, xapp_cfg_t const* c, policy_ref_t* ref) {
+    memset(ref, 0, sizeof(*ref));
+    for (size_t i = 0; i < sizeof(builtin_policies) / sizeof(builtin_policies[0]); i++) {
+        if (strcmp(builtin_policies[i]->name, name) == 0)
+            ref->p = builtin_policies[i];
+    }
+    if (ref->p == NULL && strchr(name, '/') == NULL) {
+        XLOG_ERROR("[POLICY]: Unknown policy '%s', expected monitor, threshold, timed, drl or the path of a .so\n", name);
+        return false;
+    }
+    if (ref->p == NULL) {
+        ref->so = dlopen(name, RTLD_NOW | RTLD_LOCAL);
+        if (ref->so == NULL) {
+            XLOG_ERROR("[POLICY]: %s\n", dlerror());
+            return false;
+        }
+        xapp_policy_entry_fn const entry = (xapp_policy_entry_fn)dlsym(ref->so, XAPP_POLICY_SYMBOL);
+        ref->p = entry != NULL ? entry(&policy_host) : NULL;
+        if (ref->p == NULL || ref->p->abi != XAPP_POLICY_ABI) {
+            XLOG_ERROR("[POLICY]: %s exports no policy of ABI %d\n", name, XAPP_POLICY_ABI);
+            dlclose(ref->so);
+            return false;
+        }
+    }
+    if ((ref->p->flags & XAPP_POLICY_RC) && (c->burst_ewma_alpha <= 0 || c->forecast_season_ms == 0 || c->prb_pool == 0)) {
+        XLOG_ERROR("[POLICY]: %s needs the burst_*, forecast_* and prb_* keys\n", ref->p->name);
+        if (ref->so != NULL)
+            dlclose(ref->so);
+        return false;
+    }
+    return true;
+}
+
+/////////////////////////////
+// Indication path
+/////////////////////////////
+
+static shard_tune_t tune_of(xapp_cfg_t const* c) {
+    return (shard_tune_t){
+        .burst = {
+            .alpha = c->burst_ewma_alpha,
+            .enter_kbps = c->burst_enter_kbps,
+            .exit_kbps = c->burst_exit_kbps,
+            .cusum_ref_kbps = c->burst_exit_kbps,
+            .cusum_h = c->burst_cusum_kbps,
+            .min_dwell = c->burst_min_dwell,
+        },
+        .period_ms = c->period_ms,
+        .season_ms = c->forecast_season_ms,
+        .lead_ms = c->forecast_lead_ms,
+        .fast_period_ms = c->fast_period_ms,
+        .fast_near_kbps = c->fast_near_kbps,
+        .fast_hold_ms = c->fast_hold_ms,
+    };
+}
+
+static burst_forecast_cfg_t forecast_cfg_of(shard_tune_t const* t, uint32_t period_ms) {
+    return (burst_forecast_cfg_t){
+        .alpha = 0.2f,
+        .beta = 0.01f,
+        .gamma = 0.5f,
+        .season = t->season_ms / period_ms,
+        .lead = t->lead_ms / period_ms,
+        .period_ms = period_ms,
+        .enter_kbps = t->burst.enter_kbps,
+        .exit_kbps = t->burst.exit_kbps,
+    };
+}
+
+// Detector and forecast settings, and the RC batch budget, for indications
+// every period_ms. The detector keeps the time constants it has at the
+// configured period: dwell and CUSUM limit scale with the period ratio, the
+// EWMA weight to first order. Caller holds s->mtx.
+static void shard_retime(shard_t* s, uint32_t period_ms) {
+    s->period_ms = period_ms;
+    if (s->rc_ctrl != NULL)
+        rc_dispatch_set_budget(&s->dispatch, (int64_t)period_ms * 1000);
+    if (!s->detect_on)
+        return;
+    shard_tune_t const* t = &s->tune;
+    float const r = (float)period_ms / (float)t->period_ms;
+    burst_detect_cfg_t d = t->burst;
+    d.alpha = d.alpha * r / (1.0f - d.alpha + d.alpha * r);
+    d.cusum_h = d.cusum_h / r;
+    d.min_dwell = (uint32_t)((float)d.min_dwell / r + 0.5f);
+    s->burst.cfg = d;
+
+    burst_forecast_cfg_t const fc = forecast_cfg_of(t, period_ms);
+    burst_forecast_retime(&s->forecast, period_ms, fc.season, fc.lead, ue_table_len(&s->ue_tbl));
+    s->forecast.cfg.enter_kbps = fc.enter_kbps;
+    s->forecast.cfg.exit_kbps = fc.exit_kbps;
+}
+
+// Sets up burst detection and forecast for the UEs already tracked. Caller
+// holds s->mtx.
+static void shard_detect_open(shard_t* s) {
+    size_t const cap = ue_table_len(&s->ue_tbl) > UE_TABLE_INIT_CAP ? ue_table_len(&s->ue_tbl) : UE_TABLE_INIT_CAP;
+    burst_detect_init(&s->burst, &s->tune.burst, cap);
+    burst_forecast_cfg_t const forecast_cfg = forecast_cfg_of(&s->tune, s->tune.period_ms);
+    burst_forecast_init(&s->forecast, &forecast_cfg, cap);
+    for (size_t i = 0; i < ue_table_len(&s->ue_tbl); i++) {
+        burst_detect_reset(&s->burst, i);
+        burst_forecast_reset(&s->forecast, i);
+    }
+    s->detect_on = true;
+    if (s->period_ms != s->tune.period_ms)
+        shard_retime(s, s->period_ms);
+}
+
+// Function to calculate PRB dynamically
+static int calculate_prb(shard_t const* s, ue_state_t const* ue) {
+    if (s->policy->prb_demand != NULL)
+        return s->policy->prb_demand(s->policy_st, &cfg, ue);
+    int required_prb = xapp_policy_prb_need(ue);
+    int const pool = (int)cfg.prb_pool;
+    int const min_prb = (int)cfg.prb_min;
+    return (required_prb > pool) ? pool : (required_prb < min_prb ? min_prb : required_prb);
+}
+
+static void log_measurement(shard_t const* s, int64_t timestamp, int counter, int64_t latency, ue_state_t const* ue) {
+    meas_row_t const row = {
+        .timestamp = timestamp,
+        .indication_counter = counter,
+        .latency_us = latency,
+        .ue_ngap_id = ue->meas.ue_ngap_id,
+        .ue_ran_ue_id = ue->meas.ran_ue_id,
+        .ue_prb_dl = ue->meas.prb_tot_dl,
+        .ue_prb_ul = ue->meas.prb_tot_ul,
+        .ue_pdcp_dl_kb = ue->meas.pdcp_volume_dl,
+        .ue_pdcp_ul_kb = ue->meas.pdcp_volume_ul,
+        .ue_delay_us = ue->meas.rlc_delay_dl,
+        .ue_thp_dl_kbps = ue->meas.ue_thp_dl,
+        .ue_thp_ul_kbps = ue->meas.ue_thp_ul,
+        .ue_is_burst = ue->meas.is_burst,
+        .ue_prb_allocation = ue->alloc.prb_allocation,
+        .rc_drb_id = s->rc_alloc.drb_id,
+        .rc_qfi = s->rc_alloc.qfi,
+        .rc_mapping_ind = s->rc_alloc.mapping_ind,
+        .burst_to_ctrl_us = ue->burst_to_ctrl_us,
+        .report_period_ms = (int32_t)s->period_ms,
+    };
+    meas_writer_push(&meas_writer, &row);
+}
+
+static void on_ue_detach(uint64_t key, void* rec, void* arg) {
+    shard_t* s = arg;
+    // The table moves its last record into the hole, the detector follows
+    if (s->detect_on) {
+        size_t const slot = ue_table_slot(&s->ue_tbl, rec);
+        burst_detect_remove(&s->burst, slot, ue_table_len(&s->ue_tbl) - 1);
+        burst_forecast_remove(&s->forecast, slot, ue_table_len(&s->ue_tbl) - 1);
+    }
+    XLOG_INFO("[UE TABLE]: UE detached (RAN UE ID: %lu)\n", key);
+}
+
+// Reported PRB usage. Nodes behind the timed policy count subcarriers, 12
+// per PRB, and values above the pool there are bogus.
+static void kpm_store_prb(kpm_meas_slot_t const* slot, meas_record_lst_t const* rec, void* dst) {
+    if (!atomic_load_explicit(&prb_in_subcarriers, memory_order_relaxed)) {
+        kpm_store_int(slot, rec, dst);
+        return;
+    }
+    int value = (int)kpm_meas_value(rec) / 12;
+    if (value > (int)cfg.prb_pool) {
+        XLOG_WARN("Warning: %s = %d exceeds the PRB pool (%u), setting to 0\n", slot->name, value, cfg.prb_pool);
+        value = 0;
+    }
+    XLOG_TRACE("%s = %d [%s]\n", slot->name, value, slot->unit);
+    *(int*)dst = value;
+}
+
+// KPIs stored into ue_measurement_t, resolved per index at subscription time
+static kpm_meas_def_t const kpm_known_meas[] = {
+    {"RRU.PrbTotDl", "PRBs", kpm_store_prb, offsetof(ue_measurement_t, prb_tot_dl)},
+    {"RRU.PrbTotUl", "PRBs", kpm_store_prb, offsetof(ue_measurement_t, prb_tot_ul)},
+    {"DRB.PdcpSduVolumeDL", "kb", kpm_store_int, offsetof(ue_measurement_t, pdcp_volume_dl)},
+    {"DRB.PdcpSduVolumeUL", "kb", kpm_store_int, offsetof(ue_measurement_t, pdcp_volume_ul)},
+    {"DRB.RlcSduDelayDl", "μs", kpm_store_real, offsetof(ue_measurement_t, rlc_delay_dl)},
+    {"DRB.UEThpDl", "kbps", kpm_store_real, offsetof(ue_measurement_t, ue_thp_dl)},
+    {"DRB.UEThpUl", "kbps", kpm_store_real, offsetof(ue_measurement_t, ue_thp_ul)},
+};
+
+// The policy's view of one indication of s
+typedef struct {
+    xapp_policy_ctx_t ctx;  // First, policies get &ctx
+    shard_t* s;
+    int64_t epoch;
+    int64_t now;
+} policy_call_t;
+
+static void push_burst_event(xapp_policy_ctx_t* ctx, ue_state_t const* ue) {
+    policy_call_t const* call = (policy_call_t const*)ctx;
+    ctrl_event_t const ev = {
+        .type = CTRL_EV_BURST_TRANSITION,
+        .ran_ue_id = ue->meas.ran_ue_id,
+        .epoch = call->epoch,
+        .detect_us = call->now,
+    };
+    if (!event_queue_push(&call->s->ctrl_events, &ev))
+        XLOG_WARN("[RESOURCE MANAGER]: Control event queue full, dropping transition of UE (RAN UE ID: %lu)\n", ue->meas.ran_ue_id);
+}
+
+static void push_initial_control(xapp_policy_ctx_t* ctx) {
+    policy_call_t const* call = (policy_call_t const*)ctx;
+    ctrl_event_t const ev = {.type = CTRL_EV_INITIAL_CONTROL, .epoch = call->epoch, .detect_us = call->now};
+    event_queue_push(&call->s->ctrl_events, &ev);
+}
+
+// Slice shares for the pf allocator, indexed by slice_of_drb(). Set up by
+// prb_open(): mMTC (DRB 5) from 0, URLLC (DRB 6) from prb_urllc_min.
+static prb_slice_t prb_slices[2];
+
+static size_t slice_of_drb(int drb_id) {
+    return drb_id == 6 ? 1 : 0;
+}
+
+// Caller holds sub_mtx, before any shard runs an RC policy
+static void prb_open(void) {
+    if (prb_alloc != NULL)
+        return;
+    prb_slices[0] = (prb_slice_t){0, (int)cfg.prb_pool};
+    prb_slices[1] = (prb_slice_t){(int)cfg.prb_urllc_min, (int)cfg.prb_pool};
+    prb_alloc = prb_alloc_open(cfg.allocator[0] != '\0' ? cfg.allocator : "linear", (int)cfg.prb_pool, (int)cfg.prb_burst,
+                               (int)cfg.prb_normal, prb_slices, sizeof(prb_slices) / sizeof(prb_slices[0]));
+    assert(prb_alloc != NULL && "xapp_cfg_validate() lets only known allocators through");
+    XLOG_INFO("[PRB ALLOC]: Using the %s allocator, pool %u PRBs\n", prb_alloc->name, cfg.prb_pool);
+}
+
+// Splits the PRB pool across the reported UEs with the configured
+// allocator. QFIs are taken as 5QIs for the weights.
+static void allocate_prbs(shard_t* s) {
+    prb_alloc_batch_t* b = &s->prb_batch;
+    prb_alloc_batch_reset(b, (int)cfg.prb_pool);
+    for (size_t i = 0; i < ue_table_len(&s->ue_tbl); i++) {
+        if (!ue_table_seen(&s->ue_tbl, i))
+            continue;
+        ue_state_t const* ue = ue_table_at(&s->ue_tbl, i);
+        size_t const j = prb_alloc_batch_push(b, (float)calculate_prb(s, ue), ue->alloc.qfi, slice_of_drb(ue->alloc.drb_id),
+                                              ue->alloc.is_burst_mode);
+        b->min_prb[j] = (int)cfg.prb_min;
+    }
+    prb_alloc->run(prb_alloc, b);
+
+    size_t j = 0;
+    for (size_t i = 0; i < ue_table_len(&s->ue_tbl); i++) {
+        if (ue_table_seen(&s->ue_tbl, i))
+            ((ue_state_t*)ue_table_at(&s->ue_tbl, i))->alloc.prb_allocation = b->prb[j++];
+    }
+}
+
+// Copies the UEs reported in this indication into the back snapshot buffer
+// and hands it to the RC thread
+static void publish_ue_snapshot(shard_t* s, snapshot_t* dst, int64_t epoch, int64_t latency_us) {
+    ue_snapshot_t* snap = snapshot_back(dst);
+    size_t const n = ue_table_len(&s->ue_tbl);
+    if (snap->cap < n) {
+        snap->cap = 2 * n;
+        snap->ue = realloc(snap->ue, snap->cap * sizeof(ue_state_t));
+        assert(snap->ue != NULL && "Memory exhausted");
+    }
+    snap->len = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (ue_table_seen(&s->ue_tbl, i))
+            snap->ue[snap->len++] = *(ue_state_t const*)ue_table_at(&s->ue_tbl, i);
+    }
+    snap->epoch = epoch;
+    snap->latency_us = latency_us;
+    snap->period_ms = s->period_ms;
+    snapshot_publish(dst);
+}
+
+// Adaptive sampling: the shard wants the fast report period while a UE is
+// in, near or forecast to be in a burst, and for fast_hold_ms after. The
+// subscription thread does the swap. Caller holds s->mtx.
+static void adapt_report_period(shard_t* s, bool near) {
+    shard_tune_t const* t = &s->tune;
+    if (t->fast_period_ms == 0)
+        return;
+    if (near)
+        s->calm_ms = 0;
+    else if (s->calm_ms < t->fast_hold_ms)
+        s->calm_ms += s->period_ms;
+    bool const fast = near || s->calm_ms < t->fast_hold_ms;
+    if (fast == atomic_load(&s->want_fast))
+        return;
+    atomic_store(&s->want_fast, fast);
+    if (fast)
+        XLOG_INFO("[ADAPTIVE]: UE near a burst, shard %zu asks for a %u [ms] report period\n", s->idx, t->fast_period_ms);
+    else
+        XLOG_INFO("[ADAPTIVE]: No burst for %u [ms], shard %zu asks for a %u [ms] report period\n", s->calm_ms, s->idx, t->period_ms);
+    pthread_cond_signal(&sub_cond);
+}
+
+// Burst detection and forecast over the reported UEs. True when one of
+// them is near a burst. Caller holds s->mtx.
+static bool detect_bursts(shard_t* s) {
+    size_t const num_ues = ue_table_len(&s->ue_tbl);
+    for (size_t i = 0; i < num_ues; i++) {
+        ue_state_t const* ue = ue_table_at(&s->ue_tbl, i);
+        s->burst.x[i] = ue->meas.ue_thp_ul;
+        s->burst.valid[i] = ue_table_seen(&s->ue_tbl, i);
+    }
+    burst_detect_step(&s->burst, num_ues);
+    burst_forecast_step(&s->forecast, s->burst.x, s->burst.valid, num_ues);
+    bool near = false;
+    for (size_t i = 0; i < num_ues; i++) {
+        if (!ue_table_seen(&s->ue_tbl, i))
+            continue;
+        ue_state_t* ue = ue_table_at(&s->ue_tbl, i);
+        ue->meas.is_burst = s->burst.burst[i];
+        ue->predicted_burst = s->forecast.pred[i];
+        near = near || ue->meas.is_burst || ue->predicted_burst || s->burst.x[i] >= s->tune.fast_near_kbps
+               || s->burst.ewma[i] >= s->tune.fast_near_kbps;
+        int64_t const gain = burst_forecast_score(&s->forecast, i, ue->meas.is_burst);
+        if (gain > 0)
+            XLOG_INFO("[FORECAST]: Burst of UE (RAN UE ID %lu) predicted %ld [ms] before detection\n", ue->meas.ran_ue_id, gain);
+        else if (gain == 0)
+            XLOG_INFO("[FORECAST]: Burst of UE (RAN UE ID %lu) not predicted\n", ue->meas.ran_ue_id);
+        if (ue->meas.is_burst)
+            XLOG_DEBUG("\n[BURST DETECTION]: UE (RAN UE ID %lu) - Thp UL: %.2f kbps, EWMA %.2f kbps\n",
+                   ue->meas.ran_ue_id, ue->meas.ue_thp_ul, s->burst.ewma[i]);
+    }
+    // Once per cycle
+    if (s->forecast.phase == 0)
+        burst_forecast_log(&s->forecast, s->idx, num_ues);
+    return near;
+}
+
+// Unset or more than this off, the latency column is -1
+#define COLLECT_MAX_LATENCY_US 3600000000LL
+
+// Indication latency from the header's collectStartTime. Its unit is the
+// node's: μs from FlexRIC agents, s from OAI's 4-octet TimeStamp, which
+// subtracted from a μs clock gave the 1.76E+15 latencies of the recorded
+// CSVs. Seconds and milliseconds are told apart from μs by magnitude.
+static int64_t collect_latency_us(uint64_t collect_start, int64_t now) {
+    if (collect_start == 0)
+        return -1;
+    int64_t start = (int64_t)collect_start;
+    if (collect_start < UINT64_C(100000000000))
+        start *= 1000000;
+    else if (collect_start < UINT64_C(100000000000000))
+        start *= 1000;
+    int64_t const latency = now - start;
+    return latency > COLLECT_MAX_LATENCY_US || latency < -COLLECT_MAX_LATENCY_US ? -1 : latency;
+}
+
+static void sm_cb_kpm(size_t shard, size_t slot, sm_ag_if_rd_t const* rd) {
+    int64_t const t_in = lat_hist_now_ns();
+    assert(rd != NULL);
+    assert(shard < num_shards);
+    assert(rd->type == INDICATION_MSG_AGENT_IF_ANS_V0);
+    assert(rd->ind.type == KPM_STATS_V3_0);
+
+    kpm_ind_data_t const* ind = &rd->ind.kpm.ind;
+    kpm_ric_ind_hdr_format_1_t const* hdr_frm_1 = &ind->hdr.kpm_ric_ind_hdr_format_1;
+    kpm_ind_msg_format_3_t const* msg_frm_3 = &ind->msg.frm_3;
+
+    shard_t* s = &shards[shard];
+    int64_t const now = time_now_us();
+    {
+        lock_guard(&s->mtx);
+        kpm_resub_e const sub = kpm_resub_accept(&s->resub, slot);
+        if (sub == KPM_RESUB_DROP)
+            return;
+        if (sub == KPM_RESUB_SWITCH) {
+            kpm_meas_map_recheck(&s->kpm_map);
+            uint32_t const period_ms = s->resub.slot[slot].period_ms;
+            if (period_ms != s->period_ms) {
+                XLOG_INFO("[ADAPTIVE]: Shard %zu report period %u -> %u [ms]\n", s->idx, s->period_ms, period_ms);
+                shard_retime(s, period_ms);
+            }
+            // The replaced subscription goes on the subscription thread
+            pthread_cond_signal(&sub_cond);
+        }
+        int const counter = s->counter;
+        xapp_policy_t const* policy = s->policy;
+        bool const rc = (policy->flags & XAPP_POLICY_RC) != 0;
+
+        int64_t const latency = collect_latency_us(hdr_frm_1->collectStartTime, now);
+        XLOG_DEBUG("\n%7d KPM ind_msg latency = %ld [μs]\n", counter, latency);
+
+        ctrl_done_t done;
+        while (spsc_ring_pop_into(&s->ctrl_done, &done)) {
+            ue_state_t* ue = ue_table_find(&s->ue_tbl, done.ran_ue_id);
+            if (ue != NULL)
+                ue->burst_to_ctrl_us = done.latency_us;
+        }
+
+        ue_table_begin_epoch(&s->ue_tbl);
+
+        int64_t lookup_ns = 0;
+        int64_t decode_ns = 0;
+        int64_t t = lat_hist_now_ns();
+        for (size_t i = 0; i < msg_frm_3->ue_meas_report_lst_len; i++) {
+            ue_id_e2sm_t const* ue_id_e2sm = &msg_frm_3->meas_report_per_ue[i].ue_meas_report_lst;
+            ue_id_flat_t const id = ue_id_flat(ue_id_e2sm);
+            uint64_t const key = ue_id_flat_key(&id);
+
+            bool created = false;
+            ue_state_t* ue = ue_table_upsert(&s->ue_tbl, key, &created);
+            if (created) {
+                ue->alloc = (dynamic_allocation_t){.prb_allocation = (int)cfg.prb_min};
+                if (policy->ue_new != NULL)
+                    policy->ue_new(s->policy_st, ue);
+                if (s->detect_on) {
+                    burst_detect_reset(&s->burst, ue_table_slot(&s->ue_tbl, ue));
+                    burst_forecast_reset(&s->forecast, ue_table_slot(&s->ue_tbl, ue));
+                }
+                XLOG_INFO("[UE TABLE]: UE attached (RAN UE ID: %lu), %zu UEs tracked\n", key, ue_table_len(&s->ue_tbl));
+            }
+            ue->ue_id = id;
+            int64_t const t_found = lat_hist_now_ns();
+            lookup_ns += t_found - t;
+
+            memset(&ue->meas, 0, sizeof(ue->meas));
+            ue->meas.ran_ue_id = key;
+            ue->meas.ue_ngap_id = id.amf_ue_ngap_id;
+
+            if (XLOG_LEVEL >= XLOG_LVL_TRACE)
+                ue_id_e2sm_trace(ue_id_e2sm);
+
+            kpm_meas_map_decode(&s->kpm_map, &msg_frm_3->meas_report_per_ue[i].ind_msg_format_1, &ue->meas);
+            t = lat_hist_now_ns();
+            decode_ns += t - t_found;
+        }
+
+        ue_table_sweep(&s->ue_tbl, UE_DETACH_GRACE_IND, on_ue_detach, s);
+        int64_t t_next = lat_hist_now_ns();
+        lat_hist_record(&s->stage[STAGE_UE_LOOKUP], lookup_ns + t_next - t);
+        lat_hist_record(&s->stage[STAGE_DECODE], decode_ns);
+
+        if (rc) {
+            adapt_report_period(s, detect_bursts(s));
+            t = t_next;
+            t_next = lat_hist_now_ns();
+            lat_hist_record(&s->stage[STAGE_DETECT], t_next - t);
+        }
+
+        policy_call_t call = {
+            .ctx = {
+                .ue_tbl = &s->ue_tbl,
+                .cfg = &cfg,
+                .rc_alloc = &s->rc_alloc,
+                .transition = push_burst_event,
+                .initial_control = push_initial_control,
+            },
+            .s = s,
+            .epoch = counter,
+            .now = now,
+        };
+        bool const reallocation_needed = policy->decide != NULL && policy->decide(s->policy_st, &call.ctx);
+        t = t_next;
+        t_next = lat_hist_now_ns();
+        lat_hist_record(&s->stage[STAGE_POLICY], t_next - t);
+
+        if (rc) {
+            allocate_prbs(s);
+            publish_ue_snapshot(s, &s->ue_snap, counter, latency);
+            if (reallocation_needed)
+                event_queue_notify(&s->ctrl_events);
+            t = t_next;
+            t_next = lat_hist_now_ns();
+            lat_hist_record(&s->stage[STAGE_ALLOC], t_next - t);
+        }
+
+        if (atomic_load_explicit(&metrics_on, memory_order_relaxed))
+            publish_ue_snapshot(s, &s->metrics_snap, counter, latency);
+        {
+            lock_guard(&meas_mtx);
+            for (size_t i = 0; i < ue_table_len(&s->ue_tbl); i++) {
+                if (!ue_table_seen(&s->ue_tbl, i))
+                    continue;
+                ue_state_t* ue = ue_table_at(&s->ue_tbl, i);
+                log_measurement(s, now, counter, latency, ue);
+                ue->burst_to_ctrl_us = 0;
+            }
+            meas_writer_commit(&meas_writer);
+        }
+        s->counter++;
+        int64_t const t_out = lat_hist_now_ns();
+        lat_hist_record(&s->stage[STAGE_SINK], t_out - t_next);
+        lat_hist_record(&s->stage[STAGE_INDICATION], t_out - t_in);
+    }
+}
+
+NODE_SHARD_CALLBACKS(sm_cb_kpm)
+
+/////////////////////////////
+// RC worker
+/////////////////////////////
+
+// Queues the UE's control on the shard's dispatcher, unless the node
+// already has this allocation. The pending burst detection time goes with
+// the job so the ack can report the latency.
+static bool send_rc_control(shard_t* s, ue_state_t const* ue) {
+    int const mapping_ind = 1;
+    ue_ctrl_state_t* st = ue_table_upsert(&s->ctrl_tbl, ue->meas.ran_ue_id, NULL);
+    if (st->applied && st->applied_drb_id == ue->alloc.drb_id && st->applied_qfi == ue->alloc.qfi
+        && st->applied_mapping_ind == mapping_ind) {
+        st->burst_detect_us = 0;
+        atomic_fetch_add_explicit(&s->ctrl_suppressed, 1, memory_order_relaxed);
+        return false;
+    }
+
+    XLOG_DEBUG("[RC CONTROL]: Sending control for UE (RAN UE ID %lu) - DRB:%d, QFI:%d, PRB:%d\n",
+           ue->meas.ran_ue_id,
+           ue->alloc.drb_id,
+           ue->alloc.qfi,
+           ue->alloc.prb_allocation);
+
+    rc_ctrl_job_t const job = {
+        .ue_id = ue->ue_id,
+        .ran_ue_id = ue->meas.ran_ue_id,
+        .drb_id = ue->alloc.drb_id,
+        .qfi = ue->alloc.qfi,
+        .mapping_ind = mapping_ind,
+        .detect_us = st->burst_detect_us,
+    };
+    st->burst_detect_us = 0;
+    st->applied = true;
+    st->applied_drb_id = job.drb_id;
+    st->applied_qfi = job.qfi;
+    st->applied_mapping_ind = job.mapping_ind;
+    rc_dispatch_submit(&s->dispatch, &job);
+    atomic_fetch_add_explicit(&s->ctrl_sent, 1, memory_order_relaxed);
+    return true;
+}
+
+static void send_initial_control_messages(shard_t* s, ue_snapshot_t* snap) {
+    XLOG_INFO("\n[INITIAL CONTROL]: Starting to send initial control messages\n");
+
+    for (size_t i = 0; i < snap->len; i++) {
+        ue_state_t* ue = &snap->ue[i];
+
+        // Skip if PRB values are invalid
+        if (xapp_policy_invalid_prb(&cfg, ue)) {
+            XLOG_WARN("[INITIAL CONTROL]: UE (RAN UE ID %lu) has invalid PRB values, skipping\n", ue->meas.ran_ue_id);
+            continue;
+        }
+
+        send_rc_control(s, ue);
+
+        ue_ctrl_state_t* st = ue_table_upsert(&s->ctrl_tbl, ue->meas.ran_ue_id, NULL);
+        st->initial_control_sent = true;
+    }
+
+    XLOG_INFO("[INITIAL CONTROL]: Initial control messages queued\n");
+}
+
+// Keeps the worker's table in step with the reported UEs
+static void sync_ctrl_tbl(shard_t* s, ue_snapshot_t const* snap) {
+    ue_table_begin_epoch(&s->ctrl_tbl);
+    for (size_t i = 0; i < snap->len; i++)
+        ue_table_upsert(&s->ctrl_tbl, snap->ue[i].meas.ran_ue_id, NULL);
+    ue_table_sweep(&s->ctrl_tbl, UE_DETACH_GRACE_IND, NULL, NULL);
+}
+
+// Dispatcher completion, serialized by its lock. Times the request, reports
+// the burst-to-RC-CONTROL latency once the node acknowledged the control, and
+// failed controls back to the worker.
+static void on_ctrl_done(void* arg, rc_ctrl_job_t const* job, bool acked, int64_t now, int64_t rtt_ns) {
+    shard_t* s = arg;
+    lat_hist_record(&s->stage[STAGE_RC_ACK], rtt_ns);
+    atomic_fetch_add_explicit(acked ? &s->ctrl_acked : &s->ctrl_nacked, 1, memory_order_relaxed);
+    if (!acked) {
+        // Sent again on the next reallocation
+        spsc_ring_push(&s->ctrl_failed, &job->ran_ue_id);
+        return;
+    }
+    if (job->detect_us == 0)
+        return;
+    ctrl_done_t const done = {.ran_ue_id = job->ran_ue_id, .latency_us = now - job->detect_us};
+    XLOG_INFO("[RC CONTROL]: Burst-to-control latency for UE (RAN UE ID %lu) = %ld [μs]\n", job->ran_ue_id, done.latency_us);
+    spsc_ring_push(&s->ctrl_done, &done);
+}
+
+// One per shard, pinned. Sends the shard's RC controls to its own node only.
+static void* rc_control_thread(void* arg) {
+    shard_t* s = arg;
+    node_shard_pin_self(s->idx);
+
+    while (1) {
+        event_queue_wait(&s->ctrl_events, -1);
+        if (atomic_load_explicit(&s->worker_stop, memory_order_acquire))
+            break;
+
+        ue_snapshot_t* snap = snapshot_acquire(&s->ue_snap);
+        sync_ctrl_tbl(s, snap);
+
+        uint64_t failed_ue;
+        while (spsc_ring_pop_into(&s->ctrl_failed, &failed_ue)) {
+            ue_ctrl_state_t* st = ue_table_find(&s->ctrl_tbl, failed_ue);
+            if (st != NULL)
+                st->applied = false;
+        }
+        uint64_t const sent = atomic_load_explicit(&s->ctrl_sent, memory_order_relaxed);
+        uint64_t const suppressed = atomic_load_explicit(&s->ctrl_suppressed, memory_order_relaxed);
+
+        bool initial = false;
+        bool burst_changed = false;
+        ctrl_event_t const* ev;
+        // Events of an indication whose snapshot is not out yet stay queued,
+        // its notify follows the publish
+        while ((ev = event_queue_peek(&s->ctrl_events)) != NULL && ev->epoch <= snap->epoch) {
+            if (ev->type == CTRL_EV_INITIAL_CONTROL) {
+                initial = true;
+            } else {
+                ue_ctrl_state_t* st = ue_table_upsert(&s->ctrl_tbl, ev->ran_ue_id, NULL);
+                st->burst_detect_us = ev->detect_us;
+                burst_changed = true;
+            }
+            event_queue_pop(&s->ctrl_events);
+        }
+
+        if (s->rc_ctrl == NULL)
+            continue;
+
+        if (initial)
+            send_initial_control_messages(s, snap);
+
+        if (burst_changed) {
+            XLOG_INFO("\n[RC CONTROL THREAD]: Burst state changed, sending RC controls (shard %zu)\n", s->idx);
+
+            for (size_t i = 0; i < snap->len; i++) {
+                ue_state_t* ue = &snap->ue[i];
+                // Skip if PRB values are invalid
+                if (xapp_policy_invalid_prb(&cfg, ue)) {
+                    XLOG_WARN("[RC CONTROL]: Skipping UE (RAN UE ID %lu) due to invalid PRB values\n", ue->meas.ran_ue_id);
+                    continue;
+                }
+
+                send_rc_control(s, ue);
+            }
+        }
+
+        uint64_t const sent_now = atomic_load_explicit(&s->ctrl_sent, memory_order_relaxed);
+        uint64_t const suppressed_now = atomic_load_explicit(&s->ctrl_suppressed, memory_order_relaxed);
+        if (sent_now != sent || suppressed_now != suppressed)
+            XLOG_INFO("[RC CONTROL]: %lu sent, %lu unchanged suppressed (shard %zu, %lu / %lu in total)\n",
+                   sent_now - sent, suppressed_now - suppressed, s->idx, sent_now, suppressed_now);
+    }
+
+    return NULL;
+}
+
+/////////////////////////////
+// Shards
+/////////////////////////////
+
+// Shared state of all shards and the policy of cfg, for main and
+// tools/kpm_replay.c. A NULL meas_base disables measurement logging. False
+// when the policy does not load.
+static bool xapp_init(char const* meas_base) {
+    lock_guard(&sub_mtx);
+    if (!policy_load(cfg.policy, &cfg, &cur_policy))
+        return false;
+    atomic_store(&prb_in_subcarriers, (cur_policy.p->flags & XAPP_POLICY_PRB_SUBCARRIERS) != 0);
+    if (cur_policy.p->flags & XAPP_POLICY_RC)
+        prb_open();
+    XLOG_INFO("[POLICY]: %s\n", cur_policy.p->name);
+
+    pthread_mutexattr_t attr = {0};
+    int const rc = pthread_mutex_init(&meas_mtx, &attr);
+    assert(rc == 0);
+
+    // A CSV gets the policy's columns, the binary file all of them
+    meas_writer_start(&meas_writer, meas_base != NULL ? meas_sink_open(meas_base, cfg.sink, cur_policy.p->meas_cols) : NULL);
+    return true;
+}
+
+// Puts policy p on s, between two of its indications. Caller holds s->mtx.
+static void shard_set_policy(shard_t* s, xapp_policy_t const* p) {
+    if ((p->flags & XAPP_POLICY_RC) && !s->detect_on)
+        shard_detect_open(s);
+    if (s->policy != NULL && s->policy->close != NULL)
+        s->policy->close(s->policy_st);
+    s->policy = p;
+    s->policy_st = p->open != NULL ? p->open(s->idx) : NULL;
+}
+
+// Sets up the shard of node n and starts its worker. The subscription
+// thread starts its indications, see subscriptions_start(). Caller holds
+// sub_mtx.
+static shard_t* shard_open(e2_node_connected_xapp_t* n, kpm_ran_function_def_t const* kpm_rf) {
+    const int RC_ran_function = 3;
+    assert(num_shards < NODE_SHARD_MAX && "Too many E2 nodes, raise NODE_SHARD_MAX");
+    shard_t* s = &shards[num_shards];
+    s->idx = num_shards++;
+    s->node = n;
+    s->kpm_rf = kpm_rf;
+    s->stage = calloc(STAGE_NUM, sizeof(lat_hist_t));
+    assert(s->stage != NULL && "Memory exhausted");
+    s->rc_ctrl = NULL;
+    for (size_t i = 0; i < n->len_rf; i++) {
+        if (n->rf[i].id == RC_ran_function && n->rf[i].defn.type == RC_RAN_FUNC_DEF_E)
+            s->rc_ctrl = n->rf[i].defn.rc.ctrl;
+    }
+    if (s->rc_ctrl != NULL) {
+        rc_dispatch_init(&s->dispatch, s->idx, &n->id, s->rc_ctrl, RC_CTRL_WINDOW, RC_CTRL_RATE_PER_S, RC_CTRL_BURST,
+                         CTRL_QUEUE_LEN, (int64_t)cfg.period_ms * 1000);
+        rc_dispatch_on_done(&s->dispatch, on_ctrl_done, s);
+    } else {
+        XLOG_WARN("[SHARD %zu]: E2 node has no RC control function, monitoring only\n", s->idx);
+    }
+
+    pthread_mutexattr_t attr = {0};
+    int rc = pthread_mutex_init(&s->mtx, &attr);
+    assert(rc == 0);
+    s->counter = 1;
+    ue_table_init(&s->ue_tbl, sizeof(ue_state_t), UE_TABLE_INIT_CAP);
+    prb_alloc_batch_init(&s->prb_batch, UE_TABLE_INIT_CAP);
+    s->tune = tune_of(&cfg);
+    s->period_ms = cfg.period_ms;
+    s->calm_ms = cfg.fast_hold_ms;
+    atomic_store(&s->want_fast, false);
+    s->detect_on = false;
+    s->policy = NULL;
+    shard_set_policy(s, cur_policy.p);
+    kpm_meas_map_init(&s->kpm_map, kpm_known_meas, sizeof(kpm_known_meas) / sizeof(kpm_known_meas[0]), offsetof(ue_measurement_t, extra));
+    kpm_sub_data_t kpm_sub = kpm_sub_gen(kpm_rf, cfg.period_ms, xapp_cfg_gran_ms(&cfg, cfg.period_ms), cfg.nssai_sst, cfg.nssai_sd);
+    kpm_meas_map_bind(&s->kpm_map, &kpm_sub.ad[0].frm_4.action_def_format_1);
+    free_kpm_sub_data(&kpm_sub);
+    kpm_resub_init(&s->resub, s->idx, &n->id, sm_cb_kpm_by_shard[s->idx], &s->mtx);
+    ue_table_init(&s->ctrl_tbl, sizeof(ue_ctrl_state_t), UE_TABLE_INIT_CAP);
+    snapshot_init(&s->ue_snap, &s->snap_bufs[0], &s->snap_bufs[1], &s->snap_bufs[2]);
+    snapshot_init(&s->metrics_snap, &s->metrics_bufs[0], &s->metrics_bufs[1], &s->metrics_bufs[2]);
+    event_queue_init(&s->ctrl_events, sizeof(ctrl_event_t), CTRL_QUEUE_LEN);
+    spsc_ring_init(&s->ctrl_done, sizeof(ctrl_done_t), CTRL_QUEUE_LEN);
+    spsc_ring_init(&s->ctrl_failed, sizeof(uint64_t), CTRL_QUEUE_LEN);
+
+    atomic_init(&s->worker_stop, false);
+    rc = pthread_create(&s->worker, NULL, rc_control_thread, s);
+    assert(rc == 0);
+    return s;
+}
+
+// Wakes the worker to exit and joins it. Pending controls are dropped.
+static void shard_stop_worker(shard_t* s) {
+    atomic_store_explicit(&s->worker_stop, true, memory_order_release);
+    event_queue_notify(&s->ctrl_events);
+    int const rc = pthread_join(s->worker, NULL);
+    assert(rc == 0);
+}
+
+// Swaps the running policy for ref's on every shard, one at a time between
+// two of its indications. Subscriptions, UE tables and detectors stay.
+// Caller holds sub_mtx.
+static void policy_swap(policy_ref_t const* ref) {
+    if (ref->p->flags & XAPP_POLICY_RC)
+        prb_open();
+    atomic_store(&prb_in_subcarriers, (ref->p->flags & XAPP_POLICY_PRB_SUBCARRIERS) != 0);
+    for (size_t k = 0; k < num_shards; k++) {
+        shard_t* s = &shards[k];
+        lock_guard(&s->mtx);
+        shard_set_policy(s, ref->p);
+    }
+    XLOG_INFO("[POLICY]: %s -> %s\n", cur_policy.p->name, ref->p->name);
+    // No shard runs the old code anymore
+    if (cur_policy.so != NULL)
+        dlclose(cur_policy.so);
+    cur_policy = *ref;
+}
+
+/////////////////////////////
+// Latency summary
+/////////////////////////////
+
+// Counts of all shards at the last summary, under sub_mtx
+static lat_hist_counts_t stage_prev[STAGE_NUM];
+static int64_t stage_prev_us;
+static int64_t stage_start_us;
+
+// p50/p99/p999/max of every stage over all shards, since the last summary
+// or, with since_start, since the shards opened. Caller holds sub_mtx.
+static void stage_summary(bool since_start) {
+    int64_t const now = time_now_us();
+    int64_t const from_us = since_start ? stage_start_us : stage_prev_us;
+    XLOG_INFO("[LATENCY]: %-10s %8s %9s %9s %9s %9s  [μs] over %.1f s, %zu shard(s)\n", "stage", "count", "p50", "p99", "p999",
+              "max", (now - from_us) / 1e6, num_shards);
+    for (size_t st = 0; st < STAGE_NUM; st++) {
+        lat_hist_counts_t cur = {0};
+        for (size_t k = 0; k < num_shards; k++)
+            lat_hist_add_to(&cur, &shards[k].stage[st]);
+        lat_hist_summary_t const sum = lat_hist_summarize(&cur, since_start ? NULL : &stage_prev[st]);
+        stage_prev[st] = cur;
+        if (sum.n == 0)
+            continue;
+        XLOG_INFO("[LATENCY]: %-10s %8lu %9.1f %9.1f %9.1f %9.1f\n", stage_names[st], sum.n, sum.p50_ns / 1e3, sum.p99_ns / 1e3,
+                  sum.p999_ns / 1e3, sum.max_ns / 1e3);
+    }
+    stage_prev_us = now;
+}
+
+/////////////////////////////
+// Metrics
+/////////////////////////////
+
+static metrics_http_t metrics_http;
+
+typedef enum {
+    UE_GAUGE_INT,
+    UE_GAUGE_FLOAT,
+    UE_GAUGE_BOOL,
+} ue_gauge_type_e;
+
+typedef struct {
+    char const* name;
+    char const* help;
+    size_t off;
+    ue_gauge_type_e type;
+} ue_gauge_t;
+
+#define UE_GAUGE(name, field, type, help) {name, help, offsetof(ue_state_t, field), type}
+
+static ue_gauge_t const ue_gauges[] = {
+    UE_GAUGE("xapp_ue_thp_dl_kbps", meas.ue_thp_dl, UE_GAUGE_FLOAT, "DL throughput of the UE"),
+    UE_GAUGE("xapp_ue_thp_ul_kbps", meas.ue_thp_ul, UE_GAUGE_FLOAT, "UL throughput of the UE"),
+    UE_GAUGE("xapp_ue_prb_dl", meas.prb_tot_dl, UE_GAUGE_INT, "DL PRBs the UE used"),
+    UE_GAUGE("xapp_ue_prb_ul", meas.prb_tot_ul, UE_GAUGE_INT, "UL PRBs the UE used"),
+    UE_GAUGE("xapp_ue_pdcp_volume_dl_kb", meas.pdcp_volume_dl, UE_GAUGE_INT, "DL PDCP volume of the UE"),
+    UE_GAUGE("xapp_ue_pdcp_volume_ul_kb", meas.pdcp_volume_ul, UE_GAUGE_INT, "UL PDCP volume of the UE"),
+    UE_GAUGE("xapp_ue_rlc_delay_dl_us", meas.rlc_delay_dl, UE_GAUGE_FLOAT, "DL RLC SDU delay of the UE"),
+    UE_GAUGE("xapp_ue_burst", meas.is_burst, UE_GAUGE_INT, "1 while the UE is in a burst"),
+    UE_GAUGE("xapp_ue_predicted_burst", predicted_burst, UE_GAUGE_BOOL, "1 while a burst of the UE is forecast"),
+    UE_GAUGE("xapp_ue_prb_allocation", alloc.prb_allocation, UE_GAUGE_INT, "PRBs allocated to the UE"),
+    UE_GAUGE("xapp_ue_drb_id", alloc.drb_id, UE_GAUGE_INT, "DRB the policy put the UE on"),
+    UE_GAUGE("xapp_ue_qfi", alloc.qfi, UE_GAUGE_INT, "QFI the policy put the UE on"),
+};
+
+// Upper bounds of the stage histogram buckets [s]
+static double const metrics_le_s[] = {1e-6, 2.5e-6, 5e-6, 1e-5, 2.5e-5, 5e-5, 1e-4, 2.5e-4, 5e-4, 1e-3, 2.5e-3, 5e-3, 1e-2, 2.5e-2, 5e-2, 0.1, 0.25, 0.5, 1.0};
+
+static double ue_gauge_value(ue_gauge_t const* g, ue_state_t const* ue) {
+    void const* p = (char const*)ue + g->off;
+    switch (g->type) {
+        case UE_GAUGE_INT:
+            return *(int const*)p;
+        case UE_GAUGE_FLOAT:
+            return *(float const*)p;
+        case UE_GAUGE_BOOL:
+            return *(bool const*)p;
+    }
+    return 0;
+}
+
+static void metrics_family(metrics_buf_t* b, char const* name, char const* type, char const* help) {
+    metrics_buf_printf(b, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Runs on the metrics thread. Reads the shards' newest metrics snapshot and
+// their counters and histograms, never their locks.
+static void render_metrics(metrics_buf_t* b, void* arg) {
+    (void)arg;
+    size_t const n = num_shards;
+    ue_snapshot_t const* snap[NODE_SHARD_MAX];
+    for (size_t k = 0; k < n; k++)
+        snap[k] = snapshot_acquire(&shards[k].metrics_snap);
+
+    for (size_t g = 0; g < sizeof(ue_gauges) / sizeof(ue_gauges[0]); g++) {
+        metrics_family(b, ue_gauges[g].name, "gauge", ue_gauges[g].help);
+        for (size_t k = 0; k < n; k++) {
+            for (size_t i = 0; i < snap[k]->len; i++) {
+                ue_state_t const* ue = &snap[k]->ue[i];
+                metrics_buf_printf(b, "%s{shard=\"%zu\",ran_ue_id=\"%lu\"} %g\n", ue_gauges[g].name, k, ue->meas.ran_ue_id,
+                                   ue_gauge_value(&ue_gauges[g], ue));
+            }
+        }
+    }
+
+    metrics_family(b, "xapp_ues", "gauge", "UEs in the last indication of the node");
+    for (size_t k = 0; k < n; k++)
+        metrics_buf_printf(b, "xapp_ues{shard=\"%zu\"} %zu\n", k, snap[k]->len);
+    metrics_family(b, "xapp_indications_total", "counter", "KPM indications of the node");
+    for (size_t k = 0; k < n; k++)
+        metrics_buf_printf(b, "xapp_indications_total{shard=\"%zu\"} %ld\n", k, snap[k]->epoch);
+    metrics_family(b, "xapp_report_period_seconds", "gauge", "KPM report period of the node");
+    for (size_t k = 0; k < n; k++)
+        metrics_buf_printf(b, "xapp_report_period_seconds{shard=\"%zu\"} %g\n", k, snap[k]->period_ms / 1e3);
+    metrics_family(b, "xapp_indication_latency_seconds", "gauge", "collectStartTime to arrival of the last indication");
+    for (size_t k = 0; k < n; k++) {
+        if (snap[k]->latency_us >= 0)
+            metrics_buf_printf(b, "xapp_indication_latency_seconds{shard=\"%zu\"} %g\n", k, snap[k]->latency_us / 1e6);
+    }
+
+    metrics_family(b, "xapp_rc_controls_total", "counter", "RC CONTROLs queued, or left out as already applied");
+    for (size_t k = 0; k < n; k++) {
+        shard_t* s = &shards[k];
+        metrics_buf_printf(b, "xapp_rc_controls_total{shard=\"%zu\",result=\"sent\"} %lu\n", k,
+                           atomic_load_explicit(&s->ctrl_sent, memory_order_relaxed));
+        metrics_buf_printf(b, "xapp_rc_controls_total{shard=\"%zu\",result=\"unchanged\"} %lu\n", k,
+                           atomic_load_explicit(&s->ctrl_suppressed, memory_order_relaxed));
+    }
+    metrics_family(b, "xapp_rc_answers_total", "counter", "RC CONTROL answers of the node");
+    for (size_t k = 0; k < n; k++) {
+        shard_t* s = &shards[k];
+        metrics_buf_printf(b, "xapp_rc_answers_total{shard=\"%zu\",result=\"acked\"} %lu\n", k,
+                           atomic_load_explicit(&s->ctrl_acked, memory_order_relaxed));
+        metrics_buf_printf(b, "xapp_rc_answers_total{shard=\"%zu\",result=\"failed\"} %lu\n", k,
+                           atomic_load_explicit(&s->ctrl_nacked, memory_order_relaxed));
+    }
+
+    metrics_family(b, "xapp_stage_duration_seconds", "histogram", "Indication stages and RC CONTROL send-to-answer time");
+    for (size_t k = 0; k < n; k++) {
+        for (size_t st = 0; st < STAGE_NUM; st++) {
+            lat_hist_counts_t cur = {0};
+            lat_hist_add_to(&cur, &shards[k].stage[st]);
+            size_t i = 0;
+            uint64_t acc = 0;
+            for (size_t j = 0; j < sizeof(metrics_le_s) / sizeof(metrics_le_s[0]); j++) {
+                uint64_t const le = lat_hist_count_le(&cur, (int64_t)(metrics_le_s[j] * 1e9), &i, &acc);
+                metrics_buf_printf(b, "xapp_stage_duration_seconds_bucket{shard=\"%zu\",stage=\"%s\",le=\"%g\"} %lu\n", k,
+                                   stage_names[st], metrics_le_s[j], le);
+            }
+            uint64_t const total = lat_hist_count_le(&cur, INT64_MAX, &i, &acc);
+            metrics_buf_printf(b, "xapp_stage_duration_seconds_bucket{shard=\"%zu\",stage=\"%s\",le=\"+Inf\"} %lu\n", k, stage_names[st], total);
+            metrics_buf_printf(b, "xapp_stage_duration_seconds_sum{shard=\"%zu\",stage=\"%s\"} %g\n", k, stage_names[st], cur.sum_ns / 1e9);
+            metrics_buf_printf(b, "xapp_stage_duration_seconds_count{shard=\"%zu\",stage=\"%s\"} %lu\n", k, stage_names[st], total);
+        }
+    }
+}
+
+// Serves /metrics on cfg.metrics_port, once the shards are open
+static void metrics_start(void) {
+    if (cfg.metrics_port == 0)
+        return;
+    atomic_store(&metrics_on, true);
+    if (!metrics_http_start(&metrics_http, (uint16_t)cfg.metrics_port, render_metrics, NULL))
+        atomic_store(&metrics_on, false);
+}
+
+static void metrics_stop(void) {
+    metrics_http_stop(&metrics_http);
+    atomic_store(&metrics_on, false);
+}
+
+/////////////////////////////
+// Subscriptions
+/////////////////////////////
+
+// Report period the shard should have now. Caller holds sub_mtx.
+static uint32_t shard_want_period(shard_t* s) {
+    if (cfg.fast_period_ms != 0 && atomic_load(&s->want_fast))
+        return cfg.fast_period_ms;
+    return cfg.period_ms;
+}
+
+// Moves the shard's subscription towards the period it wants, one
+// make-before-break swap at a time. Caller holds sub_mtx.
+static void shard_sub_poll(shard_t* s) {
+    int64_t const now = time_now_us();
+    uint32_t const period_ms = shard_want_period(s);
+    uint32_t const gran_ms = xapp_cfg_gran_ms(&cfg, period_ms);
+    int64_t const timeout_us = (SUB_SWAP_TIMEOUT_MS + 3 * (int64_t)period_ms) * 1000;
+    if (kpm_resub_poll(&s->resub, now, timeout_us))
+        return;
+    uint32_t cur_period_ms = 0;
+    uint32_t cur_gran_ms = 0;
+    if (kpm_resub_target(&s->resub, &cur_period_ms, &cur_gran_ms) && cur_period_ms == period_ms && cur_gran_ms == gran_ms)
+        return;
+    kpm_sub_data_t kpm_sub = kpm_sub_gen(s->kpm_rf, period_ms, gran_ms, cfg.nssai_sst, cfg.nssai_sd);
+    kpm_resub_start(&s->resub, &kpm_sub, period_ms, gran_ms, now);
+    free_kpm_sub_data(&kpm_sub);
+}
+
+// drl_model's file as last loaded, under sub_mtx
+static char drl_model_path[XAPP_CFG_STR_LEN];
+static ino_t drl_model_ino;
+static off_t drl_model_size;
+static struct timespec drl_model_mtime;
+
+// Loads path when it is new or its file was rewritten. True with the model
+// to publish, NULL when there is none or it does not load.
+static bool drl_model_poll(char const* path, drl_net_t** out) {
+    struct stat sb;
+    bool const rewritten = path[0] != '\0' && stat(path, &sb) == 0
+                           && (sb.st_ino != drl_model_ino || sb.st_size != drl_model_size
+                               || sb.st_mtim.tv_sec != drl_model_mtime.tv_sec || sb.st_mtim.tv_nsec != drl_model_mtime.tv_nsec);
+    if (strcmp(drl_model_path, path) == 0 && !rewritten)
+        return false;
+    if (rewritten) {
+        drl_model_ino = sb.st_ino;
+        drl_model_size = sb.st_size;
+        drl_model_mtime = sb.st_mtim;
+    }
+    memcpy(drl_model_path, path, sizeof(drl_model_path));
+    *out = NULL;
+    if (path[0] == '\0') {
+        XLOG_WARN("[DRL]: No drl_model, following the burst detector\n");
+        return true;
+    }
+    drl_net_t* net = malloc(sizeof(drl_net_t));
+    assert(net != NULL && "Memory exhausted");
+    if (!drl_net_load(net, path)) {
+        free(net);
+        XLOG_WARN("[DRL]: Following the burst detector\n");
+        return true;
+    }
+    if (net->inputs > DRL_NUM_FEAT || net->outputs < 2) {
+        XLOG_ERROR("[DRL]: %s has %u inputs and %u outputs, expected up to %d and 2 or more\n", path, net->inputs,
+                   net->outputs, DRL_NUM_FEAT);
+        drl_net_free(net);
+        free(net);
+        XLOG_WARN("[DRL]: Following the burst detector\n");
+        return true;
+    }
+    XLOG_INFO("[DRL]: %s: %u inputs, %u layers, %u outputs\n", path, net->inputs, net->num_layers, net->outputs);
+    *out = net;
+    return true;
+}
+
+static void drl_model_free(drl_net_t* net) {
+    if (net == NULL)
+        return;
+    drl_net_free(net);
+    free(net);
+}
+
+// Loads a new or rewritten drl_model here, off the indication path, and
+// hands it to the drl policies with every shard lock held. They only use
+// the old model again after taking up the new one. Under sub_mtx.
+static void drl_model_sync(void) {
+    drl_net_t* net;
+    if (!drl_model_poll(cfg.drl_model, &net))
+        return;
+    for (size_t k = 0; k < num_shards; k++)
+        pthread_mutex_lock(&shards[k].mtx);
+    drl_net_t* const old = drl_model_net;
+    drl_model_net = net;
+    drl_model_gen++;
+    for (size_t k = 0; k < num_shards; k++)
+        pthread_mutex_unlock(&shards[k].mtx);
+    drl_model_free(old);
+}
+
+// After the last indication, a next start loads drl_model afresh
+static void drl_model_drop(void) {
+    drl_model_free(drl_model_net);
+    drl_model_net = NULL;
+    drl_model_path[0] = '\0';
+    drl_model_ino = 0;
+    drl_model_size = 0;
+    drl_model_mtime = (struct timespec){0};
+}
+
+// After the last indication: removes the drl experience ring, which an
+// attached trainer sees as the xApp gone
+static void drl_exp_remove(void) {
+    lock_guard(&drl_exp_mtx);
+    if (drl_exp_ring.hdr != NULL) {
+        drl_exp_close(&drl_exp_ring);
+        shm_unlink(drl_exp_name);
+    }
+    drl_exp_tried = false;
+}
+
+static void* subscription_thread(void* arg) {
+    (void)arg;
+    lock_guard(&sub_mtx);
+    if (stage_start_us == 0)
+        stage_start_us = stage_prev_us = time_now_us();
+    while (!sub_stop) {
+        for (size_t k = 0; k < num_shards; k++)
+            shard_sub_poll(&shards[k]);
+        drl_model_sync();
+        if (cfg.stats_period_ms != 0 && time_now_us() - stage_prev_us >= (int64_t)cfg.stats_period_ms * 1000)
+            stage_summary(false);
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_nsec += SUB_POLL_MS * 1000000L;
+        ts.tv_sec += ts.tv_nsec / 1000000000L;
+        ts.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&sub_cond, &sub_mtx, &ts);
+    }
+    return NULL;
+}
+
+// Subscribes the open shards, then leaves their subscriptions to the
+// subscription thread
+static void subscriptions_start(void) {
+    lock_guard(&sub_mtx);
+    for (size_t k = 0; k < num_shards; k++)
+        shard_sub_poll(&shards[k]);
+    drl_model_sync();
+    sub_stop = false;
+    int const rc = pthread_create(&sub_thread, NULL, subscription_thread, NULL);
+    assert(rc == 0);
+}
+
+static void subscriptions_stop(void) {
+    {
+        lock_guard(&sub_mtx);
+        sub_stop = true;
+        pthread_cond_signal(&sub_cond);
+    }
+    int const rc = pthread_join(sub_thread, NULL);
+    assert(rc == 0);
+    lock_guard(&sub_mtx);
+    for (size_t k = 0; k < num_shards; k++)
+        kpm_resub_stop(&shards[k].resub);
+}
+
+// SIGHUP. The report periods, granularity, burst settings, summary period,
+// the policy, its DRL model and exploration apply right away, the rest on
+// the next start.
+static void on_config_reload(void) {
+    lock_guard(&sub_mtx);
+    xapp_cfg_t next;
+    if (!xapp_cfg_reload(&next)) {
+        XLOG_WARN("[CONFIG]: Keeping the running configuration\n");
+        return;
+    }
+    if (next.nssai_sst != cfg.nssai_sst || next.nssai_sd != cfg.nssai_sd || strcmp(next.meas_base, cfg.meas_base) != 0
+        || strcmp(next.sink, cfg.sink) != 0 || strcmp(next.allocator, cfg.allocator) != 0 || next.prb_pool != cfg.prb_pool
+        || next.prb_min != cfg.prb_min || next.prb_normal != cfg.prb_normal || next.prb_burst != cfg.prb_burst
+        || next.prb_urllc_min != cfg.prb_urllc_min
+        || next.metrics_port != cfg.metrics_port || strcmp(next.drl_exp_shm, cfg.drl_exp_shm) != 0)
+        XLOG_WARN("[CONFIG]: S-NSSAI, measurement file, PRB, metrics port and drl_exp_shm changes take effect on restart\n");
+
+    // Other threads read the rest of cfg, only these fields are written
+    cfg.period_ms = next.period_ms;
+    cfg.gran_period_ms = next.gran_period_ms;
+    cfg.burst_enter_kbps = next.burst_enter_kbps;
+    cfg.burst_exit_kbps = next.burst_exit_kbps;
+    cfg.burst_ewma_alpha = next.burst_ewma_alpha;
+    cfg.burst_cusum_kbps = next.burst_cusum_kbps;
+    cfg.burst_min_dwell = next.burst_min_dwell;
+    cfg.forecast_season_ms = next.forecast_season_ms;
+    cfg.forecast_lead_ms = next.forecast_lead_ms;
+    cfg.fast_period_ms = next.fast_period_ms;
+    cfg.fast_near_kbps = next.fast_near_kbps;
+    cfg.fast_hold_ms = next.fast_hold_ms;
+    cfg.stats_period_ms = next.stats_period_ms;
+
+    for (size_t k = 0; k < num_shards; k++) {
+        shard_t* s = &shards[k];
+        lock_guard(&s->mtx);
+        s->tune = tune_of(&cfg);
+        shard_retime(s, s->period_ms);
+    }
+    // Policies read it under their shard's lock
+    if (next.drl_explore != cfg.drl_explore) {
+        for (size_t k = 0; k < num_shards; k++)
+            pthread_mutex_lock(&shards[k].mtx);
+        cfg.drl_explore = next.drl_explore;
+        for (size_t k = 0; k < num_shards; k++)
+            pthread_mutex_unlock(&shards[k].mtx);
+    }
+    memcpy(cfg.drl_model, next.drl_model, sizeof(cfg.drl_model));
+    drl_model_sync();
+
+    if (strcmp(next.policy, cfg.policy) != 0) {
+        policy_ref_t ref;
+        if (policy_load(next.policy, &cfg, &ref)) {
+            policy_swap(&ref);
+            memcpy(cfg.policy, next.policy, sizeof(cfg.policy));
+        } else {
+            XLOG_WARN("[CONFIG]: Keeping the %s policy\n", cur_policy.p->name);
+        }
+    }
+    // New periods are swapped in by the subscription thread
+    pthread_cond_signal(&sub_cond);
+    xapp_cfg_log(&cfg);
+}
+
+// After the last indication: the workers are joined before their shard's
+// state is freed
+static void xapp_free(void) {
+    metrics_stop();
+    meas_writer_stop(&meas_writer);
+
+    for (size_t k = 0; k < num_shards; k++) {
+        shard_t* s = &shards[k];
+        shard_stop_worker(s);
+        if (s->policy->close != NULL)
+            s->policy->close(s->policy_st);
+        ue_table_free(&s->ue_tbl);
+        prb_alloc_batch_free(&s->prb_batch);
+        if (s->detect_on) {
+            burst_detect_free(&s->burst);
+            burst_forecast_free(&s->forecast);
+        }
+        kpm_meas_map_free(&s->kpm_map);
+        ue_table_free(&s->ctrl_tbl);
+        for (size_t i = 0; i < 3; i++) {
+            free(s->snap_bufs[i].ue);
+            free(s->metrics_bufs[i].ue);
+        }
+        event_queue_free(&s->ctrl_events);
+        spsc_ring_free(&s->ctrl_done);
+        spsc_ring_free(&s->ctrl_failed);
+        rc_dispatch_free(&s->dispatch);
+        free(s->stage);
+        int const rc = pthread_mutex_destroy(&s->mtx);
+        assert(rc == 0);
+    }
+    num_shards = 0;
+    prb_alloc_free(prb_alloc);
+    prb_alloc = NULL;
+    if (cur_policy.so != NULL)
+        dlclose(cur_policy.so);
+    cur_policy = (policy_ref_t){0};
+    drl_model_drop();
+    drl_exp_remove();
+
+    int const rc = pthread_mutex_destroy(&meas_mtx);
+    assert(rc == 0);
+}
+
+/////////////////////////////
+// Daemon
+/////////////////////////////
+
+// tools/kpm_replay.c builds the core with XAPP_NO_MAIN and drives it itself
+#ifndef XAPP_NO_MAIN
+
+static e2_node_arr_xapp_t xapp_nodes;
+
+// Configuration, RIC connection, one shard per E2 node with KPM, and their
+// subscriptions. False when the configuration or policy is bad.
+static bool xapp_core_start(int* argc, char** argv) {
+    if (!xapp_cfg_args(&cfg, argc, argv))
+        return false;
+    // First, so every later thread leaves SIGHUP to the watcher
+    xapp_cfg_watch(on_config_reload);
+    xlog_start();
+
+    fr_args_t args = init_fr_args(*argc, argv);
+    init_xapp_api(&args);
+    sleep(1);
+
+    xapp_nodes = e2_nodes_xapp_api();
+    assert(xapp_nodes.len > 0);
+
+    XLOG_INFO("[MAIN]: Connected E2 nodes = %d\n", xapp_nodes.len);
+    xapp_cfg_log(&cfg);
+
+    if (!xapp_init(cfg.meas_base[0] != '\0' ? cfg.meas_base : NULL)) {
+        xlog_stop();
+        return false;
+    }
+
+    int const KPM_ran_function = 2;
+
+    {
+        lock_guard(&sub_mtx);
+        for (size_t i = 0; i < xapp_nodes.len; ++i) {
+            e2_node_connected_xapp_t* n = &xapp_nodes.n[i];
+            size_t const idx = kpm_sub_find_rf(n->rf, n->len_rf, KPM_ran_function);
+            assert(n->rf[idx].defn.type == KPM_RAN_FUNC_DEF_E && "KPM is not the received RAN Function");
+            if (n->rf[idx].defn.kpm.ric_report_style_list != NULL)
+                shard_open(n, &n->rf[idx].defn.kpm);
+        }
+    }
+    subscriptions_start();
+    metrics_start();
+
+    XLOG_INFO("[MAIN]: %zu node shard(s) started\n", num_shards);
+    return true;
+}
+
+// Once xapp_wait_end_api() returned
+static void xapp_core_stop(void) {
+    subscriptions_stop();
+
+    while (try_stop_xapp_api() == false)
+        usleep(1000);
+
+    xapp_free();
+
+    free_e2_node_arr_xapp(&xapp_nodes);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,145 @@
+#ifndef XAPP_POLICY_H
+#define XAPP_POLICY_H
+
+// Decision policies of the xApp daemon (xapp_core.h).
+//
+// The core owns everything up to the UE table: subscriptions, indication
+// decode, burst detection and forecast, the PRB allocator, the RC workers
+// and the measurement sink. A policy only decides, once per indication of
+// a node, which DRB and QFI each reported UE gets and whether the node's
+// RC controls go out.
+//
+// Built in: monitor (no RC), threshold (xapp_RC_KPM_Infinity.c), timed
+// (xapp_kpm_rc_setTime.c) and drl (a trained network, policy_drl.c). Any
+// other policy is a shared object built from a source like
+// policy_threshold.c:
+//
+//   gcc -shared -fPIC -DXAPP_POLICY_SO -o my_policy.so my_policy.c
+//
+// It exports XAPP_POLICY_SYMBOL through XAPP_POLICY_EXPORT(). Naming the
+// .so in the policy key and sending SIGHUP swaps it in between two
+// indications: the subscriptions, the UE table and the detector state stay.
+
+#include "ue_table.h"
+#include "ue_id_flat.h"
+#include "kpm_meas_map.h"
+#include "meas_row.h"
+#include "xapp_cfg.h"
+#include "xlog.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bumped whenever a struct below changes
+#define XAPP_POLICY_ABI 1
+
+typedef struct {
+    uint64_t ue_ngap_id;
+    uint64_t ran_ue_id;
+    int prb_tot_dl;
+    int prb_tot_ul;
+    int pdcp_volume_dl;
+    int pdcp_volume_ul;
+    float rlc_delay_dl;
+    float ue_thp_dl;
+    float ue_thp_ul;
+    int is_burst;
+    float extra[KPM_MEAS_MAX_EXTRA];  // KPIs registered at runtime
+} ue_measurement_t;
+
+typedef struct {
+    int drb_id;
+    int qfi;
+    int prb_allocation;
+    bool is_burst_mode;
+} dynamic_allocation_t;
+
+typedef struct {
+    ue_measurement_t meas;
+    dynamic_allocation_t alloc;
+    ue_id_flat_t ue_id;
+    int64_t burst_to_ctrl_us;  // Burst-to-RC-CONTROL latency, reset once logged
+    bool predicted_burst;      // Forecast burst within forecast_lead_ms
+} ue_state_t;
+
+typedef struct {
+    int drb_id;
+    int qfi;
+    int mapping_ind;
+} rc_allocation_t;
+
+// One indication of one node, as the policy sees it
+typedef struct xapp_policy_ctx_s xapp_policy_ctx_t;
+struct xapp_policy_ctx_s {
+    ue_table_t* ue_tbl;  // ue_state_t records, reported ones ue_table_seen()
+    xapp_cfg_t const* cfg;
+    rc_allocation_t* rc_alloc;  // Logged with every row of the node
+    // RC controls for ue's new mode, once the indication is through
+    void (*transition)(xapp_policy_ctx_t* ctx, ue_state_t const* ue);
+    // RC controls for every reported UE, once the indication is through
+    void (*initial_control)(xapp_policy_ctx_t* ctx);
+};
+
+// UL throughput one PRB carries, and the margin allocated on top
+#define XAPP_POLICY_KBPS_PER_PRB 100.0
+#define XAPP_POLICY_PRB_HEADROOM 1.2
+
+// Needs the burst_*, forecast_* and prb_* keys, controls the node
+#define XAPP_POLICY_RC 1u
+// The node reports RRU.PrbTot* in subcarriers, 12 per PRB
+#define XAPP_POLICY_PRB_SUBCARRIERS 2u
+
+typedef struct {
+    uint32_t abi;  // XAPP_POLICY_ABI
+    char const* name;
+    uint32_t flags;    // XAPP_POLICY_*
+    size_t meas_cols;  // Leading meas_row.h columns worth writing
+
+    // Per node state, NULL is fine. Called with the node's lock held, as
+    // are the functions below.
+    void* (*open)(size_t shard);
+    void (*close)(void* st);
+    // A UE was attached, its allocation is still zero. Optional.
+    void (*ue_new)(void* st, ue_state_t* ue);
+    // Sets the reported UEs' drb_id, qfi and is_burst_mode. True when the
+    // node's RC controls must go out. Optional.
+    bool (*decide)(void* st, xapp_policy_ctx_t* ctx);
+    // PRBs ue can use, from its UL throughput. Optional, the core clamps
+    // to [prb_min, prb_pool] without it.
+    int (*prb_demand)(void* st, xapp_cfg_t const* cfg, ue_state_t const* ue);
+} xapp_policy_t;
+
+// What the daemon hands a plugin
+typedef struct {
+    uint32_t abi;
+    void (*log)(char const* msg);  // Into the daemon's log
+} xapp_policy_host_t;
+
+#define XAPP_POLICY_SYMBOL "xapp_policy_entry"
+
+typedef xapp_policy_t const* (*xapp_policy_entry_fn)(xapp_policy_host_t const* host);
+
+#ifdef XAPP_POLICY_SO
+#define XAPP_POLICY_EXPORT(policy)                                                                           \
+    __attribute__((visibility("default"))) xapp_policy_t const* xapp_policy_entry(xapp_policy_host_t const* host); \
+    xapp_policy_t const* xapp_policy_entry(xapp_policy_host_t const* host) {                                \
+        if (host->abi != XAPP_POLICY_ABI)                                                                    \
+            return NULL;                                                                                     \
+        xlog_forward = host->log;                                                                            \
+        return &(policy);                                                                                    \
+    }
+#else
+#define XAPP_POLICY_EXPORT(policy)
+#endif
+
+// PRBs the UE's UL throughput needs, before clamping to the pool
+static inline int xapp_policy_prb_need(ue_state_t const* ue) {
+    return (int)((ue->meas.ue_thp_ul / XAPP_POLICY_KBPS_PER_PRB) * XAPP_POLICY_PRB_HEADROOM);
+}
+
+// A UE whose reported PRB usage exceeds the pool, its values are bogus
+static inline bool xapp_policy_invalid_prb(xapp_cfg_t const* cfg, ue_state_t const* ue) {
+    return ue->meas.prb_tot_dl > (int)cfg->prb_pool || ue->meas.prb_tot_ul > (int)cfg->prb_pool;
+}
+
+#endif
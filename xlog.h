@@ -0,0 +1,174 @@
+#ifndef XLOG_H
+#define XLOG_H
+
+// Leveled logging that never blocks the caller.
+//
+// Messages below XLOG_LEVEL are compiled out entirely: the arguments are
+// still type-checked but no code is emitted. Build with
+// -DXLOG_LEVEL=XLOG_LVL_TRACE to get the per-record output back.
+//
+// Enabled messages are formatted straight into a slot of a bounded MPSC
+// ring. A background thread writes the ring to stdout in batches. When the
+// ring is full the message is dropped and counted, the caller never waits.
+// Before xlog_start() and after xlog_stop() messages go to stdout directly.
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define XLOG_LVL_ERROR 0
+#define XLOG_LVL_WARN 1
+#define XLOG_LVL_INFO 2
+#define XLOG_LVL_DEBUG 3
+#define XLOG_LVL_TRACE 4
+
+#ifndef XLOG_LEVEL
+#define XLOG_LEVEL XLOG_LVL_INFO
+#endif
+
+#define XLOG_RING_LEN 4096
+#define XLOG_MSG_LEN 256
+#define XLOG_FLUSH_MS 50
+
+typedef struct {
+    _Atomic size_t seq;
+    char msg[XLOG_MSG_LEN];
+} xlog_cell_t;
+
+typedef struct {
+    _Alignas(64) _Atomic size_t head;  // Next slot to claim, shared by producers
+    _Alignas(64) size_t tail;          // Owned by the flush thread
+    _Alignas(64) xlog_cell_t* cell;
+    atomic_size_t dropped;
+    atomic_bool running;
+    atomic_bool stop;
+    pthread_t thread;
+} xlog_t;
+
+static xlog_t xlog_ring;
+// Set in a policy plugin (xapp_policy.h), whose copy of this file has no
+// ring of its own: messages go to the daemon's ring through it
+static void (*xlog_forward)(char const* msg);
+
+__attribute__((format(printf, 1, 2)))
+static void xlog_emit(char const* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    if (xlog_forward != NULL) {
+        char msg[XLOG_MSG_LEN];
+        vsnprintf(msg, sizeof(msg), fmt, ap);
+        va_end(ap);
+        xlog_forward(msg);
+        return;
+    }
+    if (!atomic_load_explicit(&xlog_ring.running, memory_order_acquire)) {
+        vprintf(fmt, ap);
+        va_end(ap);
+        return;
+    }
+
+    // Bounded MPMC ring with per-slot sequence numbers, used with a single consumer
+    size_t pos = atomic_load_explicit(&xlog_ring.head, memory_order_relaxed);
+    xlog_cell_t* c;
+    for (;;) {
+        c = &xlog_ring.cell[pos & (XLOG_RING_LEN - 1)];
+        size_t const seq = atomic_load_explicit(&c->seq, memory_order_acquire);
+        intptr_t const diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&xlog_ring.head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            atomic_fetch_add_explicit(&xlog_ring.dropped, 1, memory_order_relaxed);
+            va_end(ap);
+            return;
+        } else {
+            pos = atomic_load_explicit(&xlog_ring.head, memory_order_relaxed);
+        }
+    }
+    vsnprintf(c->msg, XLOG_MSG_LEN, fmt, ap);
+    va_end(ap);
+    atomic_store_explicit(&c->seq, pos + 1, memory_order_release);
+}
+
+#define XLOG_AT(lvl, ...)              \
+    do {                               \
+        if ((lvl) <= XLOG_LEVEL)       \
+            xlog_emit(__VA_ARGS__);    \
+    } while (0)
+
+#define XLOG_ERROR(...) XLOG_AT(XLOG_LVL_ERROR, __VA_ARGS__)
+#define XLOG_WARN(...) XLOG_AT(XLOG_LVL_WARN, __VA_ARGS__)
+#define XLOG_INFO(...) XLOG_AT(XLOG_LVL_INFO, __VA_ARGS__)
+#define XLOG_DEBUG(...) XLOG_AT(XLOG_LVL_DEBUG, __VA_ARGS__)
+#define XLOG_TRACE(...) XLOG_AT(XLOG_LVL_TRACE, __VA_ARGS__)
+
+static size_t xlog_drain(void) {
+    size_t n = 0;
+    for (;;) {
+        xlog_cell_t* c = &xlog_ring.cell[xlog_ring.tail & (XLOG_RING_LEN - 1)];
+        if (atomic_load_explicit(&c->seq, memory_order_acquire) != xlog_ring.tail + 1)
+            break;
+        fputs(c->msg, stdout);
+        atomic_store_explicit(&c->seq, xlog_ring.tail + XLOG_RING_LEN, memory_order_release);
+        xlog_ring.tail++;
+        n++;
+    }
+    return n;
+}
+
+static void* xlog_thread(void* arg) {
+    (void)arg;
+    struct timespec const nap = {.tv_sec = 0, .tv_nsec = XLOG_FLUSH_MS * 1000000L};
+    size_t reported_drops = 0;
+    for (;;) {
+        bool const stopping = atomic_load(&xlog_ring.stop);
+        size_t const n = xlog_drain();
+        size_t const drops = atomic_load_explicit(&xlog_ring.dropped, memory_order_relaxed);
+        if (drops != reported_drops) {
+            printf("[LOG]: %zu messages dropped\n", drops - reported_drops);
+            reported_drops = drops;
+        }
+        if (n > 0)
+            fflush(stdout);
+        if (stopping)
+            break;
+        nanosleep(&nap, NULL);
+    }
+    return NULL;
+}
+
+static inline void xlog_start(void) {
+    _Static_assert((XLOG_RING_LEN & (XLOG_RING_LEN - 1)) == 0, "XLOG_RING_LEN must be a power of two");
+    xlog_ring.cell = calloc(XLOG_RING_LEN, sizeof(xlog_cell_t));
+    assert(xlog_ring.cell != NULL && "Memory exhausted");
+    for (size_t i = 0; i < XLOG_RING_LEN; i++)
+        atomic_init(&xlog_ring.cell[i].seq, i);
+    atomic_init(&xlog_ring.head, 0);
+    xlog_ring.tail = 0;
+    atomic_init(&xlog_ring.dropped, 0);
+    atomic_init(&xlog_ring.stop, false);
+    int const rc = pthread_create(&xlog_ring.thread, NULL, xlog_thread, NULL);
+    assert(rc == 0);
+    atomic_store_explicit(&xlog_ring.running, true, memory_order_release);
+}
+
+// Flushes what is queued. Only call it once no other thread logs anymore.
+static inline void xlog_stop(void) {
+    if (!atomic_load(&xlog_ring.running))
+        return;
+    atomic_store_explicit(&xlog_ring.running, false, memory_order_release);
+    atomic_store(&xlog_ring.stop, true);
+    pthread_join(xlog_ring.thread, NULL);
+    free(xlog_ring.cell);
+    xlog_ring.cell = NULL;
+    fflush(stdout);
+}
+
+#endif